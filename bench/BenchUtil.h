@@ -0,0 +1,51 @@
+/**
+ * @file BenchUtil.h
+ * @date 26/10/17
+ * @brief ベンチマーク用の共通ユーティリティ
+ * @details 計測用のストップウォッチと、最適化による計算の除去を防ぐ関数を提供します。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef BENCHUTIL_H
+#define BENCHUTIL_H
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+
+
+class Stopwatch {
+public:
+    Stopwatch() : _start(std::chrono::steady_clock::now()) {}
+
+    [[nodiscard]] double seconds() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point _start;
+};
+
+/**
+ * @brief 値を使用済みとして扱わせ、計測対象の処理が最適化で取り除かれないようにします。
+ */
+template <typename T>
+void doNotOptimize(const T& value_) { asm volatile("" : : "r,m"(value_) : "memory"); }
+
+/**
+ * @brief シード固定の乱数でsizeバイトのデータを生成します。
+ */
+inline std::string makeRandomBytes(const size_t size_, const uint32_t seed_ = 1)
+{
+    std::mt19937 engine(seed_);
+    std::string result(size_, '\0');
+    for (auto& c : result) c = static_cast<char>(engine());
+    return result;
+}
+
+inline double toMegaBytes(const double bytes_) { return bytes_ / (1024.0 * 1024.0); }
+
+
+#endif //BENCHUTIL_H
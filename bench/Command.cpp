@@ -0,0 +1,55 @@
+/**
+ * @file Command.cpp
+ * @date 26/10/17
+ * @brief ベンチマークから外部コマンド(コンパイラ)を実行する処理
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "Command.h"
+
+#include <cstdlib>
+#include <sstream>
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "BenchUtil.h"
+
+extern char** environ;
+
+CommandResult runCommand(const std::vector<std::string>& args_)
+{
+    std::vector<char*> argv;
+    for (const auto& arg : args_) argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    CommandResult result;
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 2, "/dev/null", O_WRONLY, 0);
+    const Stopwatch sw;
+    pid_t pid;
+    if (posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ) != 0) {
+        posix_spawn_file_actions_destroy(&actions);
+        return result;
+    }
+    int status = 0;
+    rusage usage{};
+    wait4(pid, &status, 0, &usage);
+    result.seconds = sw.seconds();
+    result.max_rss = usage.ru_maxrss;
+    result.success = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    posix_spawn_file_actions_destroy(&actions);
+    return result;
+}
+
+std::vector<std::string> benchCompilers(const char* default_)
+{
+    const char* env = std::getenv("FILE_BUNDLER_BENCH_CC");
+    std::istringstream iss(env ? env : default_);
+    std::vector<std::string> result;
+    for (std::string cc; iss >> cc;) result.push_back(cc);
+    return result;
+}
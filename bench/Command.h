@@ -0,0 +1,34 @@
+/**
+ * @file Command.h
+ * @date 26/10/17
+ * @brief ベンチマークから外部コマンド(コンパイラ)を実行する処理
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef COMMAND_H
+#define COMMAND_H
+#include <string>
+#include <vector>
+
+
+struct CommandResult {
+    bool success = false;
+    double seconds = 0;
+    /// ピークRSS (KiB)
+    long max_rss = 0;
+};
+
+/**
+ * @brief コマンドを実行し、終了までの時間と子プロセスのピークRSSを計測します。
+ * @details コマンドの標準エラー出力は、計測結果の表示を妨げるため捨てます。
+ */
+CommandResult runCommand(const std::vector<std::string>& args_);
+
+/**
+ * @brief 環境変数FILE_BUNDLER_BENCH_CC(空白区切り)で指定されたコンパイラの一覧を返します。
+ * @param default_ 環境変数が設定されていない場合の値
+ */
+std::vector<std::string> benchCompilers(const char* default_);
+
+
+#endif //COMMAND_H
@@ -0,0 +1,77 @@
+/**
+ * @file Corpus.cpp
+ * @date 26/10/17
+ * @brief ベンチマーク用の合成コーパスの生成
+ * @details シード固定の乱数で生成するため、同じ指定からは常に同じ内容のファイル群が生成されます。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "Corpus.h"
+
+#include <format>
+#include <fstream>
+#include <random>
+
+namespace fs = std::filesystem;
+
+namespace {
+    std::string makeText(std::mt19937& engine_, const size_t size_)
+    {
+        static constexpr const char* words[] = {
+            "resource", "bundle", "texture", "font", "shader", "vertex", "fragment", "uniform", "color", "alpha",
+            "{", "}", "\"name\":", "\"value\":", "0.5,", "1024,", "true,", "null", "//", "/*", "*/", "return"
+        };
+        std::uniform_int_distribution<size_t> word(0, std::size(words) - 1);
+        std::uniform_int_distribution<int> line_break(0, 11);
+        std::string result;
+        result.reserve(size_ + 16);
+        while (result.size() < size_) {
+            result += words[word(engine_)];
+            result += line_break(engine_) == 0 ? '\n' : ' ';
+        }
+        result.resize(size_);
+        return result;
+    }
+
+    std::string makeRandom(std::mt19937& engine_, const size_t size_)
+    {
+        std::string result(size_, '\0');
+        for (auto& c : result) c = static_cast<char>(engine_());
+        return result;
+    }
+}
+
+uintmax_t writeCorpus(const fs::path& dir_, const CorpusSpec& spec_, const uint32_t seed_)
+{
+    fs::create_directories(dir_);
+    std::mt19937 engine(seed_);
+    uintmax_t total = 0;
+    for (size_t i = 0; i < spec_.file_count; ++i) {
+        const std::string data = spec_.kind == CorpusSpec::Kind::TEXT
+                                     ? makeText(engine, spec_.file_size)
+                                     : makeRandom(engine, spec_.file_size);
+        const char* extension = spec_.kind == CorpusSpec::Kind::TEXT ? "txt" : "bin";
+        std::ofstream ofs(dir_ / std::format("{}{}.{}", spec_.prefix, i, extension), std::ios::binary);
+        ofs.write(data.data(), static_cast<std::streamsize>(data.size()));
+        total += data.size();
+    }
+    return total;
+}
+
+std::vector<NamedCorpus> standardCorpora(const size_t size_)
+{
+    return {
+        {"tiny", {{"tiny", 20000, 256, CorpusSpec::Kind::TEXT}}},
+        {"huge", {{"huge", 2, size_ / 2, CorpusSpec::Kind::RANDOM}}},
+        {"incompressible", {{"random", 32, size_ / 32, CorpusSpec::Kind::RANDOM}}},
+        {"compressible", {{"text", 32, size_ / 32, CorpusSpec::Kind::TEXT}}},
+    };
+}
+
+uintmax_t writeNamedCorpus(const fs::path& dir_, const NamedCorpus& corpus_)
+{
+    uintmax_t total = 0;
+    uint32_t seed = 1;
+    for (const auto& spec : corpus_.specs) total += writeCorpus(dir_ / corpus_.name, spec, seed++);
+    return total;
+}
@@ -0,0 +1,59 @@
+/**
+ * @file Corpus.h
+ * @date 26/10/17
+ * @brief ベンチマーク用の合成コーパスの生成
+ * @details シード固定の乱数で生成するため、同じ指定からは常に同じ内容のファイル群が生成されます。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef CORPUS_H
+#define CORPUS_H
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+
+struct CorpusSpec {
+    enum class Kind {
+        /// 英単語風の文字列と改行からなるテキスト (圧縮しやすい)
+        TEXT,
+        /// 一様乱数のバイナリ (圧縮できない)
+        RANDOM
+    };
+
+    /// ファイル名の接頭辞
+    std::string prefix;
+    size_t file_count = 1;
+    size_t file_size = 0;
+    Kind kind = Kind::RANDOM;
+};
+
+/**
+ * @brief specに従ってdirにファイルを生成します。
+ * @return 生成したファイルの合計サイズ
+ */
+uintmax_t writeCorpus(const std::filesystem::path& dir_, const CorpusSpec& spec_, uint32_t seed_ = 1);
+
+/// 1つのディレクトリに生成する、名前の付いたコーパス
+struct NamedCorpus {
+    std::string name;
+    std::vector<CorpusSpec> specs;
+};
+
+/**
+ * @brief ベンチマークで共通に用いるコーパスの一覧を返します。
+ * @details 多数の小さなファイル、少数の巨大なバイナリ、圧縮できないデータ、圧縮しやすいデータの4種類です。
+ *          小さなファイルのコーパス以外は、合計がおよそsizeバイトになります。
+ */
+std::vector<NamedCorpus> standardCorpora(size_t size_);
+
+/**
+ * @brief corpusをdir/{name}に生成します。
+ * @return 生成したファイルの合計サイズ
+ */
+uintmax_t writeNamedCorpus(const std::filesystem::path& dir_, const NamedCorpus& corpus_);
+
+
+#endif //CORPUS_H
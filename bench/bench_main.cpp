@@ -0,0 +1,54 @@
+/**
+ * @file bench_main.cpp
+ * @date 26/10/17
+ * @brief file_bundler_benchのエントリポイント
+ * @details 第1引数で実行するベンチマークを選択します。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+int runEncoderBench(size_t size_);
+int runFormatBench(size_t size_);
+int runCompressionBench(size_t size_);
+int runPipelineBench(size_t size_);
+int runJobsBench(size_t size_);
+int runPrefetchBench(size_t size_);
+int runRegistrationBench(size_t size_);
+int runTransformBench(size_t size_);
+int runCorpusCommand(const std::filesystem::path& dir_, size_t size_);
+
+int main(const int argc_, char* argv_[])
+{
+    const std::string name = argc_ > 1 ? argv_[1] : "";
+    // corpusは第2引数に出力先、第3引数にサイズ(MB)を取る。
+    if (name == "corpus" && argc_ > 2)
+        return runCorpusCommand(argv_[2], (argc_ > 3 ? std::strtoull(argv_[3], nullptr, 10) : 64) * 1024 * 1024);
+    // 第2引数は入力サイズ(MB)
+    const size_t size = (argc_ > 2 ? std::strtoull(argv_[2], nullptr, 10) : 64) * 1024 * 1024;
+    if (name == "encoder") return runEncoderBench(size);
+    if (name == "formats") return runFormatBench(size);
+    if (name == "compression") return runCompressionBench(size);
+    if (name == "pipeline") return runPipelineBench(size);
+    if (name == "jobs") return runJobsBench(size);
+    if (name == "prefetch") return runPrefetchBench(size);
+    if (name == "registration") return runRegistrationBench(size);
+    if (name == "transform") return runTransformBench(size);
+    std::cout << "usage: file_bundler_bench <benchmark> [size_mb]\n"
+        "       file_bundler_bench corpus <output_dir> [size_mb]\n"
+        "\tbenchmarks:\n"
+        "\t\tencoder  ByteEncoderと従来の変換処理の比較\n"
+        "\t\tformats  データ部分の形式ごとの出力サイズとコンパイル時間・ピークメモリの比較\n"
+        "\t\tcompression  --compressの圧縮率と圧縮・展開のスループット\n"
+        "\t\tpipeline  bundleの処理段階ごとの時間とMB/s・files/s (タブ区切り)\n"
+        "\t\t\tFILE_BUNDLER_BENCH_CCを指定した場合は、生成したresource.cのコンパイル時間も計測します。\n"
+        "\t\tjobs  同じコーパスを入力とする複数の出力を、独立して行う場合と--jobs-fileのキャッシュを共有する場合の比較\n"
+        "\t\tprefetch  多数の小さなファイルを入力とする場合の、--input-engineの方式ごとのfiles/sの比較\n"
+        "\t\tregistration  100万行のファイルリストによる登録の、従来の処理との比較 (size_mbは使用しません。)\n"
+        "\t\ttransform  テキスト変換の種類ごとのMB/sと、コメント・文字列の判定を誤りやすい入力の変換結果の確認\n"
+        "\tcorpus: pipelineと同じコーパス(tiny, huge, incompressible, compressible)をoutput_dirに生成します。" << std::endl;
+    return name.empty() ? 0 : 1;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file compression_bench.cpp
+ * @date 26/10/17
+ * @brief --compressで用いるLZ4の圧縮率と圧縮・展開の速度の計測
+ * @details 合成コーパスをFileBundlerと同じく1MiBのブロックごとに圧縮し、種類ごとの圧縮率と
+ *          圧縮せずに格納されるファイル数、圧縮・展開のスループットを表示します。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "Corpus.h"
+#include "Lz4.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    /// FileBundlerのセグメントの大きさ (ブロックはセグメントごとに独立して圧縮される。)
+    constexpr size_t block_size = 1024 * 1024;
+    /// 展開の計測の繰り返し回数 (最も速い結果を採用する。)
+    constexpr int decode_repeat = 5;
+
+    std::string readFile(const fs::path& path_)
+    {
+        std::ifstream ifs(path_, std::ios::binary);
+        return {std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()};
+    }
+
+    std::string compressFile(const std::string& data_)
+    {
+        std::string stream;
+        for (size_t offset = 0; offset < data_.size(); offset += block_size)
+            Lz4::appendBlock(stream, data_.data() + offset, std::min(block_size, data_.size() - offset));
+        return stream;
+    }
+
+    void measure(const char* name_, const fs::path& dir_)
+    {
+        std::vector<std::string> files;
+        for (const auto& entry : fs::directory_iterator(dir_)) files.push_back(readFile(entry.path()));
+
+        size_t input = 0;
+        size_t stored = 0;
+        size_t raw_files = 0;
+        std::vector<std::string> streams;
+        const Stopwatch compress_sw;
+        for (const auto& data : files) streams.push_back(compressFile(data));
+        const double compress_seconds = compress_sw.seconds();
+
+        // 圧縮して格納されるファイルの添字
+        std::vector<size_t> decode_targets;
+        for (size_t i = 0; i < files.size(); ++i) {
+            input += files[i].size();
+            // FileBundlerと同じく、圧縮後のサイズが元の7/8以上となるファイルは圧縮せずに格納する。
+            if (streams[i].size() < files[i].size() - files[i].size() / 8) {
+                stored += streams[i].size();
+                decode_targets.push_back(i);
+            }
+            else {
+                stored += files[i].size();
+                ++raw_files;
+            }
+        }
+
+        // 展開は圧縮して格納されるファイルのみを対象とし、展開後のサイズあたりのスループットを求める。
+        size_t decoded = 0;
+        double decode_seconds = 0;
+        bool verified = true;
+        for (int repeat = 0; repeat < decode_repeat; ++repeat) {
+            decoded = 0;
+            const Stopwatch decode_sw;
+            for (const size_t i : decode_targets) {
+                std::string output(files[i].size(), '\0');
+                verified = Lz4::decompressStream(streams[i].data(), streams[i].size(), output.data(), output.size())
+                    && verified;
+                doNotOptimize(output.data());
+                decoded += output.size();
+            }
+            const double seconds = decode_sw.seconds();
+            if (repeat == 0 || seconds < decode_seconds) decode_seconds = seconds;
+        }
+
+        std::cout << name_ << '\t' << files.size() << '\t' << input << '\t' << stored << '\t'
+            << static_cast<double>(stored) / static_cast<double>(input) << '\t' << raw_files << '\t'
+            << toMegaBytes(static_cast<double>(input)) / compress_seconds << '\t';
+        if (decoded > 0) std::cout << toMegaBytes(static_cast<double>(decoded)) / decode_seconds;
+        else std::cout << '-';
+        std::cout << '\t' << (verified ? "ok" : "NG") << std::endl;
+    }
+}
+
+int runCompressionBench(const size_t size_)
+{
+    const fs::path work_dir = fs::temp_directory_path() / "file_bundler_compression_bench";
+    fs::remove_all(work_dir);
+    writeCorpus(work_dir / "text", {"text", 8, size_ / 16, CorpusSpec::Kind::TEXT});
+    writeCorpus(work_dir / "random", {"random", 8, size_ / 16, CorpusSpec::Kind::RANDOM}, 2);
+
+    std::cout << "corpus\tfiles\tinput_bytes\tstored_bytes\tratio\traw_files\tcompress_mb_s\tdecode_mb_s\tverify"
+        << std::endl;
+    measure("text", work_dir / "text");
+    measure("random", work_dir / "random");
+    fs::remove_all(work_dir);
+    return 0;
+}
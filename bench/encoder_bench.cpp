@@ -0,0 +1,69 @@
+/**
+ * @file encoder_bench.cpp
+ * @date 26/10/17
+ * @brief ByteEncoderと従来のostream_iteratorによる変換の比較
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "ByteEncoder.h"
+
+namespace {
+    constexpr size_t chunk_size = 10000;
+
+    /// 変更前のFileBundler::bundleと同じ変換処理
+    size_t encodeLegacy(const std::string& data_)
+    {
+        std::ostringstream output;
+        for (size_t offset = 0; offset < data_.size(); offset += chunk_size) {
+            const size_t count = std::min(chunk_size, data_.size() - offset);
+            std::vector buff_vec(data_.data() + offset, data_.data() + offset + count);
+            std::ranges::copy(buff_vec, std::ostream_iterator<int>(output, ", "));
+        }
+        return output.str().size();
+    }
+
+    size_t encodeTable(const std::string& data_, std::string& output_)
+    {
+        ByteEncoder encoder;
+        output_.clear();
+        for (size_t offset = 0; offset < data_.size(); offset += chunk_size) {
+            const size_t count = std::min(chunk_size, data_.size() - offset);
+            output_.append(encoder.encode(data_.data() + offset, count, offset != 0));
+        }
+        return output_.size();
+    }
+
+    void report(const char* name_, const double seconds_, const size_t in_, const size_t out_)
+    {
+        std::cout << name_ << ": " << seconds_ * 1000 << " ms, in " << toMegaBytes(in_) / seconds_
+            << " MB/s, out " << toMegaBytes(out_) / seconds_ << " MB/s" << std::endl;
+    }
+}
+
+int runEncoderBench(const size_t size_)
+{
+    const std::string data = makeRandomBytes(size_);
+    std::string output;
+    output.reserve(ByteEncoder::requiredBufferSize(size_));
+
+    {
+        const Stopwatch sw;
+        const size_t out = encodeLegacy(data);
+        report("legacy (ostream_iterator<int>)", sw.seconds(), size_, out);
+    }
+    {
+        encodeTable(data, output); // ウォームアップ
+        const Stopwatch sw;
+        const size_t out = encodeTable(data, output);
+        doNotOptimize(output.data());
+        report("ByteEncoder", sw.seconds(), size_, out);
+    }
+    return 0;
+}
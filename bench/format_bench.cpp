@@ -0,0 +1,65 @@
+/**
+ * @file format_bench.cpp
+ * @date 26/10/17
+ * @brief データ部分の形式ごとの生成ファイルサイズとコンパイル時間・ピークメモリの比較
+ * @details 合成コーパスを各形式でresource.cに出力し、環境変数FILE_BUNDLER_BENCH_CC(空白区切り、既定値は"gcc clang")で
+ *          指定したコンパイラでコンパイルします。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include <iostream>
+#include <string>
+
+#include "BenchUtil.h"
+#include "Command.h"
+#include "Corpus.h"
+#include "FileBundler.h"
+
+namespace fs = std::filesystem;
+
+int runFormatBench(const size_t size_)
+{
+    const fs::path work_dir = fs::temp_directory_path() / "file_bundler_format_bench";
+    fs::remove_all(work_dir);
+    const fs::path corpus_dir = work_dir / "corpus";
+    // テキストとバイナリを半分ずつ含むコーパス
+    uintmax_t total = writeCorpus(corpus_dir, {"text", 8, size_ / 16, CorpusSpec::Kind::TEXT});
+    total += writeCorpus(corpus_dir, {"random", 8, size_ / 16, CorpusSpec::Kind::RANDOM}, 2);
+    std::cout << "corpus: " << toMegaBytes(static_cast<double>(total)) << " MB\n"
+        << "format\tgenerate_s\toutput_bytes\tcompiler\tcompile_s\tmax_rss_mb" << std::endl;
+
+    const std::pair<const char*, FileBundler::Format> formats[] = {
+        {"decimal", FileBundler::Format::DECIMAL},
+        {"hex", FileBundler::Format::HEX},
+        {"string", FileBundler::Format::STRING},
+        {"embed", FileBundler::Format::EMBED},
+    };
+    for (const auto& [name, format] : formats) {
+        const fs::path output_dir = work_dir / name;
+        FileBundler::Parameters parameters;
+        parameters.format = format;
+        const FileBundler bundler{
+            corpus_dir.string(), output_dir.string(), "", FileBundler::Options::ALL_YES, parameters
+        };
+        const Stopwatch sw;
+        if (bundler.bundle() != 0) {
+            std::cout << name << "\tfailed" << std::endl;
+            continue;
+        }
+        const double generate_seconds = sw.seconds();
+        const fs::path source = output_dir / "resource.c";
+        const auto output_size = fs::file_size(source);
+
+        for (const auto& cc : benchCompilers("gcc clang")) {
+            const CommandResult result = runCommand({
+                cc, "-std=c2x", "-c", source.string(), "-o", (output_dir / (cc + ".o")).string()
+            });
+            std::cout << name << '\t' << generate_seconds << '\t' << output_size << '\t' << cc << '\t';
+            if (result.success) std::cout << result.seconds << '\t' << static_cast<double>(result.max_rss) / 1024;
+            else std::cout << "failed\t-";
+            std::cout << std::endl;
+        }
+    }
+    fs::remove_all(work_dir);
+    return 0;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file jobs_bench.cpp
+ * @date 26/10/17
+ * @brief --jobs-fileによる共有キャッシュの効果の計測
+ * @details 共通のコーパス(standardCorpora)を入力とする複数の出力(モジュール)を、出力ごとに独立して行う場合と、
+ *          BundleCacheを共有して行う場合の合計時間をタブ区切りで出力します。
+ *          前者はモジュールごとにfile-bundlerを起動する従来の運用に相当します。(プロセスの起動時間は含みません。)
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "BundleCache.h"
+#include "Corpus.h"
+#include "FileBundler.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    /// 各コーパスの計測の繰り返し回数 (最も短い結果を採用する。)
+    constexpr int repeat = 3;
+    /// 同じコーパスを入力とする出力の数
+    constexpr size_t module_count = 8;
+
+    /**
+     * @brief module_count個の出力を順に行い、所要時間を返します。失敗した場合は負の値を返します。
+     * @param shared_ trueの場合、BundleCacheを共有する。
+     */
+    double runModules(const fs::path& corpus_dir_, const fs::path& output_dir_, const unsigned jobs_,
+                      const bool shared_)
+    {
+        // 出力の比較による更新の省略が働かないよう、毎回出力先を空にする。
+        fs::remove_all(output_dir_);
+        const Stopwatch sw;
+        std::unique_ptr<BundleCache> cache = shared_ ? std::make_unique<BundleCache>(jobs_) : nullptr;
+        FileBundler::Parameters parameters;
+        parameters.jobs = jobs_;
+        parameters.cache = cache.get();
+        std::vector<std::unique_ptr<FileBundler>> bundlers;
+        for (size_t i = 0; i < module_count; ++i) {
+            bundlers.push_back(std::make_unique<FileBundler>(
+                corpus_dir_.string(), (output_dir_ / std::to_string(i)).string(), "", FileBundler::Options::ALL_YES,
+                parameters));
+        }
+        std::vector<std::vector<fs::path>> inputs;
+        if (cache) {
+            for (const auto& bundler : bundlers) {
+                inputs.push_back(bundler->inputPaths());
+                for (const auto& path : inputs.back()) cache->retain(path);
+            }
+        }
+        for (size_t i = 0; i < bundlers.size(); ++i) {
+            if (bundlers[i]->bundle() != 0) return -1;
+            if (cache) for (const auto& path : inputs[i]) cache->release(path);
+        }
+        return sw.seconds();
+    }
+}
+
+int runJobsBench(const size_t size_)
+{
+    const fs::path work_dir = fs::temp_directory_path() / "file_bundler_jobs_bench";
+    fs::remove_all(work_dir);
+    const unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+
+    std::cout << "corpus\tmodules\tinput_bytes\tjobs\tseparate_s\tshared_s\tspeedup" << std::endl;
+    for (const auto& corpus : standardCorpora(size_)) {
+        const uintmax_t input_bytes = writeNamedCorpus(work_dir / "corpus", corpus);
+        const fs::path corpus_dir = work_dir / "corpus" / corpus.name;
+        const fs::path output_dir = work_dir / "output" / corpus.name;
+        double separate = 0;
+        double shared = 0;
+        for (int i = 0; i < repeat && separate >= 0 && shared >= 0; ++i) {
+            const double separate_run = runModules(corpus_dir, output_dir, jobs, false);
+            const double shared_run = runModules(corpus_dir, output_dir, jobs, true);
+            separate = i == 0 || separate_run < 0 ? separate_run : std::min(separate, separate_run);
+            shared = i == 0 || shared_run < 0 ? shared_run : std::min(shared, shared_run);
+        }
+        std::cout << corpus.name << '\t' << module_count << '\t' << input_bytes << '\t' << jobs << '\t';
+        if (separate < 0 || shared < 0) std::cout << "failed";
+        else std::cout << separate << '\t' << shared << '\t' << separate / shared;
+        std::cout << std::endl;
+        fs::remove_all(work_dir);
+    }
+    fs::remove_all(work_dir);
+    return 0;
+}
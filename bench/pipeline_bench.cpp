@@ -0,0 +1,127 @@
+/**
+ * @file pipeline_bench.cpp
+ * @date 26/10/17
+ * @brief FileBundler::bundleの処理段階ごとの所要時間とスループットの計測
+ * @details 共通のコーパス(standardCorpora)をresource.cに出力し、段階ごとの時間とMB/s、files/sを
+ *          タブ区切りで出力します。列と行の順序は固定のため、コミット間の結果をそのまま比較できます。
+ *          memory_sink_sは、同じ入力をライブラリとしてMemorySinkに出力した場合の所要時間です。
+ *          MemorySinkは繰り返しの間で再利用するため、領域の確保を除いた定常状態の値となります。
+ *          環境変数FILE_BUNDLER_BENCH_CCでコンパイラが指定された場合は、生成したresource.cのコンパイル時間も計測します。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "BenchUtil.h"
+#include "BundleSink.h"
+#include "Command.h"
+#include "Corpus.h"
+#include "FileBundler.h"
+#include "PhaseTimer.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    /// 各コーパスの計測の繰り返し回数 (合計時間が最も短い結果を採用する。)
+    constexpr int repeat = 3;
+
+    constexpr std::array phases = {
+        PhaseTimer::Phase::REGISTRATION, PhaseTimer::Phase::TRANSFORM, PhaseTimer::Phase::SIZE_QUERY, PhaseTimer::Phase::HASH,
+        PhaseTimer::Phase::ENCODE, PhaseTimer::Phase::WRITE
+    };
+
+    struct RunResult {
+        double total = 0;
+        std::array<double, phases.size()> phase_seconds{};
+    };
+}
+
+int runPipelineBench(const size_t size_)
+{
+    const fs::path work_dir = fs::temp_directory_path() / "file_bundler_pipeline_bench";
+    fs::remove_all(work_dir);
+    const unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+    const std::vector<std::string> compilers = benchCompilers("");
+
+    std::cout << "corpus\tfiles\tinput_bytes\toutput_bytes\tjobs\ttotal_s";
+    for (const auto phase : phases) std::cout << '\t' << PhaseTimer::name(phase) << "_s";
+    std::cout << "\tmb_s\tfiles_s\tmemory_sink_s";
+    for (const auto& cc : compilers) std::cout << "\tcompile_" << cc << "_s";
+    std::cout << std::endl;
+
+    for (const auto& corpus : standardCorpora(size_)) {
+        const uintmax_t input_bytes = writeNamedCorpus(work_dir / "corpus", corpus);
+        const fs::path corpus_dir = work_dir / "corpus" / corpus.name;
+        const fs::path output_dir = work_dir / "output" / corpus.name;
+        size_t files = 0;
+        for (const auto& spec : corpus.specs) files += spec.file_count;
+
+        FileBundler::Parameters parameters;
+        parameters.jobs = jobs;
+        const FileBundler bundler{
+            corpus_dir.string(), output_dir.string(), "", FileBundler::Options::ALL_YES, parameters
+        };
+        RunResult best;
+        bool failed = false;
+        for (int i = 0; i < repeat && !failed; ++i) {
+            // 出力の比較による更新の省略が働かないよう、毎回出力先を空にする。
+            fs::remove_all(output_dir);
+            FileSink file_sink(output_dir);
+            const Stopwatch sw;
+            const FileBundler::Result result = bundler.bundle({}, file_sink);
+            failed = result.code != 0;
+            RunResult run{sw.seconds()};
+            for (size_t p = 0; p < phases.size(); ++p)
+                run.phase_seconds[p] = result.phase_seconds[static_cast<size_t>(phases[p])];
+            if (i == 0 || run.total < best.total) best = run;
+        }
+        if (failed) {
+            std::cout << corpus.name << "\tfailed" << std::endl;
+            continue;
+        }
+        // 出力ファイルの書き込みと比較を行わない場合の所要時間
+        const FileBundler memory_bundler{corpus_dir.string(), "", "", 0, parameters};
+        double memory_sink_seconds = 0;
+        MemorySink sink;
+        for (int i = 0; i < repeat; ++i) {
+            const Stopwatch sw;
+            failed = memory_bundler.bundle({}, sink).code != 0;
+            const double seconds = sw.seconds();
+            if (i == 0 || seconds < memory_sink_seconds) memory_sink_seconds = seconds;
+        }
+
+        const fs::path source = output_dir / "resource.c";
+        std::cout << corpus.name << '\t' << files << '\t' << input_bytes << '\t' << fs::file_size(source) << '\t' << jobs
+            << '\t' << best.total;
+        for (const double seconds : best.phase_seconds) std::cout << '\t' << seconds;
+        std::cout << '\t' << toMegaBytes(static_cast<double>(input_bytes)) / best.total << '\t'
+            << static_cast<double>(files) / best.total << '\t';
+        if (failed) std::cout << "failed";
+        else std::cout << memory_sink_seconds;
+        for (const auto& cc : compilers) {
+            const CommandResult result = runCommand({
+                cc, "-c", source.string(), "-o", (output_dir / (cc + ".o")).string()
+            });
+            std::cout << '\t';
+            if (result.success) std::cout << result.seconds;
+            else std::cout << "failed";
+        }
+        std::cout << std::endl;
+        fs::remove_all(work_dir);
+    }
+    fs::remove_all(work_dir);
+    return 0;
+}
+
+int runCorpusCommand(const fs::path& dir_, const size_t size_)
+{
+    for (const auto& corpus : standardCorpora(size_)) {
+        const uintmax_t total = writeNamedCorpus(dir_, corpus);
+        std::cout << (dir_ / corpus.name).generic_string() << '\t' << total << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+/**
+ * @file prefetch_bench.cpp
+ * @date 26/10/17
+ * @brief 多数の小さなファイルを入力とする場合の、入力の読み込み方式(--input-engine)ごとのスループットの計測
+ * @details ファイルサイズの異なる小さなファイルのコーパスをresource.cに出力し、方式(sync, threads, auto)ごとの
+ *          files/sと入力のシステムコール数、syncに対する速度比をタブ区切りで出力します。
+ *          コーパスは生成した直後に計測するため、入力はページキャッシュに載った状態となります。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "BundleSink.h"
+#include "Corpus.h"
+#include "FileBundler.h"
+#include "IoStats.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    /// 各方式の計測の繰り返し回数 (最も短い結果を採用する。)
+    constexpr int repeat = 3;
+    /// 1つのコーパスのファイル数の上限
+    constexpr size_t max_file_count = 100000;
+
+    constexpr std::array engines = {
+        FileBundler::InputEngine::SYNC, FileBundler::InputEngine::THREADS, FileBundler::InputEngine::AUTO
+    };
+    constexpr std::array engine_names = {"sync", "threads", "auto"};
+
+    struct RunResult {
+        double seconds = -1;
+        uint64_t input_syscalls = 0;
+    };
+
+    /**
+     * @brief 小さなファイルのコーパスの一覧を返します。
+     * @details 256バイトのファイルは常に最大数を、それ以外はsizeバイトを上限として生成します。
+     */
+    std::vector<NamedCorpus> smallFileCorpora(const size_t size_)
+    {
+        std::vector<NamedCorpus> corpora;
+        for (const size_t file_size : {size_t{256}, size_t{4096}, size_t{16384}, size_t{32768}}) {
+            const size_t file_count = file_size == 256
+                                          ? max_file_count
+                                          : std::clamp<size_t>(size_ / file_size, 1, max_file_count);
+            corpora.push_back({
+                "small" + std::to_string(file_size),
+                {{"f", file_count, file_size, CorpusSpec::Kind::TEXT}}
+            });
+        }
+        return corpora;
+    }
+
+    RunResult runEngine(const fs::path& corpus_dir_, const fs::path& output_dir_, const unsigned jobs_,
+                        const FileBundler::InputEngine engine_)
+    {
+        FileBundler::Parameters parameters;
+        parameters.jobs = jobs_;
+        parameters.input_engine = engine_;
+        const FileBundler bundler{
+            corpus_dir_.string(), output_dir_.string(), "", FileBundler::Options::ALL_YES, parameters
+        };
+        RunResult best;
+        for (int i = 0; i < repeat; ++i) {
+            // 出力の比較による更新の省略が働かないよう、毎回出力先を空にする。
+            fs::remove_all(output_dir_);
+            FileSink sink(output_dir_);
+            const Stopwatch sw;
+            const FileBundler::Result result = bundler.bundle({}, sink);
+            if (result.code != 0) return {};
+            const double seconds = sw.seconds();
+            const uint64_t syscalls = result.io_counters[static_cast<size_t>(IoStats::Counter::INPUT_SYSCALLS)];
+            if (i == 0 || seconds < best.seconds) best = {seconds, syscalls};
+        }
+        return best;
+    }
+}
+
+int runPrefetchBench(const size_t size_)
+{
+    const fs::path work_dir = fs::temp_directory_path() / "file_bundler_prefetch_bench";
+    fs::remove_all(work_dir);
+    const unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+
+    std::cout << "corpus\tfiles\tinput_bytes\tjobs";
+    for (const auto* name : engine_names) std::cout << '\t' << name << "_files_s\t" << name << "_input_syscalls";
+    for (size_t i = 1; i < engine_names.size(); ++i) std::cout << '\t' << engine_names[i] << "_speedup";
+    std::cout << std::endl;
+
+    for (const auto& corpus : smallFileCorpora(size_)) {
+        const uintmax_t input_bytes = writeNamedCorpus(work_dir / "corpus", corpus);
+        const fs::path corpus_dir = work_dir / "corpus" / corpus.name;
+        const fs::path output_dir = work_dir / "output" / corpus.name;
+        const size_t files = corpus.specs.front().file_count;
+        std::array<RunResult, engines.size()> results;
+        for (size_t i = 0; i < engines.size(); ++i) results[i] = runEngine(corpus_dir, output_dir, jobs, engines[i]);
+
+        std::cout << corpus.name << '\t' << files << '\t' << input_bytes << '\t' << jobs;
+        for (const auto& result : results) {
+            if (result.seconds < 0) std::cout << "\tfailed\t-";
+            else std::cout << '\t' << static_cast<double>(files) / result.seconds << '\t' << result.input_syscalls;
+        }
+        for (size_t i = 1; i < results.size(); ++i) {
+            std::cout << '\t';
+            if (results[0].seconds < 0 || results[i].seconds < 0) std::cout << "failed";
+            else std::cout << results[0].seconds / results[i].seconds;
+        }
+        std::cout << std::endl;
+        fs::remove_all(work_dir);
+    }
+    fs::remove_all(work_dir);
+    return 0;
+}
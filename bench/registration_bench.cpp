@@ -0,0 +1,138 @@
+/**
+ * @file registration_bench.cpp
+ * @date 26/10/17
+ * @brief 100万行のファイルリストによるファイルの登録の計測
+ * @details 100万個の空のファイルと、それらを列挙したファイルリスト(行の半数はCRLF)を生成し、
+ *          従来の登録処理(std::getlineと正規表現による改行の除去・定数名の生成と、ファイルごとの状態の確認)と、
+ *          FileBundler::inputPaths()による登録(--input-engineのsync, auto)の時間と行/sをタブ区切りで出力します。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include <algorithm>
+#include <array>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BenchUtil.h"
+#include "FileBundler.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    /// ファイルリストの行数
+    constexpr size_t entry_count = 1000000;
+    /// 1つのディレクトリに生成するファイルの数
+    constexpr size_t files_per_directory = 1000;
+
+    constexpr std::array engines = {FileBundler::InputEngine::SYNC, FileBundler::InputEngine::AUTO};
+    constexpr std::array engine_names = {"sync", "auto"};
+
+    /**
+     * @brief dirにファイルを生成し、それらを列挙したファイルリストのパスを返します。
+     */
+    fs::path writeFileList(const fs::path& dir_)
+    {
+        const fs::path filelist_path = dir_ / "filelist.txt";
+        fs::create_directories(dir_);
+        std::ofstream filelist(filelist_path, std::ios::binary);
+        for (size_t i = 0; i < entry_count; ++i) {
+            const fs::path directory = dir_ / "files" / std::format("d{:04}", i / files_per_directory);
+            if (i % files_per_directory == 0) fs::create_directories(directory);
+            const fs::path path = directory / std::format("file {}.bin", i);
+            std::ofstream{path, std::ios::binary};
+            filelist << path.generic_string() << (i % 2 == 0 ? "\n" : "\r\n");
+        }
+        return filelist_path;
+    }
+
+    /// 変更前のFileBundler::registerFilesと同じ、ファイルリストからの登録
+    size_t registerLegacy(const fs::path& filelist_path_)
+    {
+        const std::regex sign_replace_pattern("[^A-Z0-9_]");
+        const std::regex space_replace_pattern(" ");
+        const std::regex line_separator_pattern(R"((\r\n?)|\n)");
+        std::map<std::string, fs::path> files;
+        std::vector<fs::path> listed_directories;
+        std::vector<fs::path> listed_files;
+        std::ifstream ifs(filelist_path_);
+        while (!ifs.eof()) {
+            std::string line;
+            std::getline(ifs, line);
+            line = std::regex_replace(line, line_separator_pattern, "");
+            if (line.empty()) continue;
+            listed_files.emplace_back(line);
+        }
+        for (const auto& file_path : listed_files) {
+            if (!is_regular_file(file_path)) continue;
+            std::string filename = std::format("{}_{}", file_path.stem().generic_string(),
+                                               file_path.extension().generic_string());
+            std::ranges::transform(filename, filename.begin(), toupper);
+            filename = std::regex_replace(filename, space_replace_pattern, "_");
+            filename = std::regex_replace(filename, sign_replace_pattern, "");
+            if (files.contains(filename)) continue;
+            files.try_emplace(filename, file_path);
+            listed_directories.push_back(file_path.parent_path());
+        }
+        return files.size();
+    }
+
+    /**
+     * @brief FileBundler::inputPaths()で登録し、所要時間を返します。すべての行を登録できなかった場合は負の値を返します。
+     */
+    double registerFileList(const fs::path& filelist_path_, const unsigned jobs_,
+                            const FileBundler::InputEngine engine_)
+    {
+        FileBundler::Parameters parameters;
+        parameters.jobs = jobs_;
+        parameters.input_engine = engine_;
+        const FileBundler bundler{"", "", filelist_path_.string(), FileBundler::Options::ALL_YES, parameters};
+        const Stopwatch sw;
+        const size_t registered = bundler.inputPaths().size();
+        const double seconds = sw.seconds();
+        return registered == entry_count ? seconds : -1;
+    }
+}
+
+int runRegistrationBench(size_t)
+{
+    const fs::path work_dir = fs::temp_directory_path() / "file_bundler_registration_bench";
+    fs::remove_all(work_dir);
+    const unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+    const fs::path filelist_path = writeFileList(work_dir);
+
+    std::cout << "entries\tjobs\tlegacy_s";
+    for (const auto* name : engine_names) std::cout << '\t' << name << "_s\t" << name << "_entries_s";
+    for (const auto* name : engine_names) std::cout << '\t' << name << "_speedup";
+    std::cout << std::endl;
+
+    double legacy;
+    {
+        const Stopwatch sw;
+        const size_t registered = registerLegacy(filelist_path);
+        legacy = registered == entry_count ? sw.seconds() : -1;
+    }
+    std::array<double, engines.size()> results{};
+    for (size_t i = 0; i < engines.size(); ++i) results[i] = registerFileList(filelist_path, jobs, engines[i]);
+
+    std::cout << entry_count << '\t' << jobs << '\t';
+    if (legacy < 0) std::cout << "failed";
+    else std::cout << legacy;
+    for (const double seconds : results) {
+        if (seconds < 0) std::cout << "\tfailed\t-";
+        else std::cout << '\t' << seconds << '\t' << static_cast<double>(entry_count) / seconds;
+    }
+    for (const double seconds : results) {
+        std::cout << '\t';
+        if (legacy < 0 || seconds < 0) std::cout << "failed";
+        else std::cout << legacy / seconds;
+    }
+    std::cout << std::endl;
+    fs::remove_all(work_dir);
+    return 0;
+}
@@ -0,0 +1,112 @@
+/**
+ * @file transform_bench.cpp
+ * @date 26/10/17
+ * @brief テキスト変換(--transform)のスループットと変換結果の確認
+ * @details ソースコード風の合成テキストを64KiBのチャンクに区切って変換の種類ごとに処理し、MB/sを表示します。
+ *          続けて、コメントと文字列の判定を誤りやすい入力の変換結果を期待値と比較し、
+ *          1バイトずつ区切って渡した場合も同じ結果となるかを確認します。一致しない場合は終了コード1を返します。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include <array>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "BenchUtil.h"
+#include "Transform.h"
+
+namespace {
+    /// FileBundlerがテキスト変換に渡すチャンクの大きさ
+    constexpr size_t chunk_size = 64 * 1024;
+
+    struct KindName {
+        Transform::Kind kind;
+        const char* name;
+    };
+
+    constexpr std::array kinds = {
+        KindName{Transform::Kind::BLOCK_COMMENT, "block-comment"},
+        KindName{Transform::Kind::COMMENTS, "comments"},
+        KindName{Transform::Kind::JSON, "json"},
+        KindName{Transform::Kind::GLSL, "glsl"},
+    };
+
+    /// 変換結果の確認に用いる入力と期待値
+    struct Case {
+        const char* name;
+        Transform::Kind kind;
+        std::string_view input;
+        std::string_view expected;
+    };
+
+    constexpr std::array cases = {
+        Case{"block_comment", Transform::Kind::BLOCK_COMMENT, "int a; /* note */\nint b;\n", "int a; \nint b;\n"},
+        Case{"block_comment_in_string", Transform::Kind::BLOCK_COMMENT, "s = \"/* x */\"; /* y */\n",
+             "s = \"/* x */\"; \n"},
+        // 行コメント内の"/*"からブロックコメントとして扱うと、次の"*/"までの行が失われる。
+        Case{"block_comment_opener_in_line_comment", Transform::Kind::BLOCK_COMMENT,
+             "int a; // see dir/*.c\nint b = 1; /* note */\nint c;\n", "int a; // see dir/*.c\nint b = 1; \nint c;\n"},
+        Case{"line_comment", Transform::Kind::COMMENTS, "int a; // x /* y\nint b; /* z */\n", "int a; \nint b;  \n"},
+        Case{"line_comment_in_string", Transform::Kind::COMMENTS, "u = 'http://x';\n", "u = 'http://x';\n"},
+        // テンプレートリテラルは改行を含み得る。
+        Case{"template_literal", Transform::Kind::COMMENTS, "u = `http://x/\n${a}//b`; // c\n",
+             "u = `http://x/\n${a}//b`; \n"},
+        Case{"css_url", Transform::Kind::BLOCK_COMMENT, "a{background:url(x/y.png)} /* c */ b{}\n",
+             "a{background:url(x/y.png)}  b{}\n"},
+        Case{"json", Transform::Kind::JSON, "{ \"a b\" : [1, \"\\\" c\"] }\n", "{\"a b\":[1,\"\\\" c\"]}"},
+        Case{"glsl", Transform::Kind::GLSL, "#version 330\n// x\nvoid main() {\n  /* y */ gl_Position = v;\n}\n",
+             "#version 330\nvoid main() { gl_Position = v; }"},
+    };
+
+    std::string transform(const Transform::Kind kind_, const std::string_view input_, const size_t chunk_size_)
+    {
+        const auto transform = Transform::create(kind_);
+        std::string output;
+        for (size_t offset = 0; offset < input_.size(); offset += chunk_size_)
+            transform->process(input_.substr(offset, chunk_size_), output);
+        transform->finish(output);
+        return output;
+    }
+
+    /**
+     * @brief コメント・文字列・空白を含むソースコード風のテキストを、sizeバイト程度生成します。
+     */
+    std::string makeSourceText(const size_t size_)
+    {
+        constexpr std::string_view snippet =
+            "/* ブロックコメント\n * 複数行 */\n"
+            "static const char* url = \"http://example.com/*.png\"; // 行コメント\n"
+            "const t = `line1\n  line2 ${value}`;\n"
+            "int main(void) {\n    return value / 2; /* 除算 */\n}\n"
+            "{ \"key\" : [ 1, 2, \"value\" ], \"nested\" : { \"a\" : true } }\n";
+        std::string result;
+        result.reserve(size_ + snippet.size());
+        while (result.size() < size_) result += snippet;
+        return result;
+    }
+}
+
+int runTransformBench(const size_t size_)
+{
+    const std::string text = makeSourceText(size_);
+    std::cout << "kind\tinput_bytes\toutput_bytes\tmb_s" << std::endl;
+    for (const auto& [kind, name] : kinds) {
+        const Stopwatch sw;
+        const std::string output = transform(kind, text, chunk_size);
+        const double seconds = sw.seconds();
+        doNotOptimize(output.data());
+        std::cout << name << '\t' << text.size() << '\t' << output.size() << '\t'
+            << toMegaBytes(static_cast<double>(text.size())) / seconds << std::endl;
+    }
+
+    std::cout << "\ncase\tverify" << std::endl;
+    bool verified = true;
+    for (const auto& [name, kind, input, expected] : cases) {
+        // チャンクの境界をまたぐ状態の引き継ぎも確認するため、1バイトずつ渡した結果も比較する。
+        const bool ok = transform(kind, input, chunk_size) == expected && transform(kind, input, 1) == expected;
+        std::cout << name << '\t' << (ok ? "ok" : "NG") << std::endl;
+        verified = verified && ok;
+    }
+    return verified ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+/**
+ * @file AssemblyBackend.cpp
+ * @date 26/10/17
+ * @brief .incbinを用いたアセンブリソースの生成
+ * @details ファイルの内容を配列初期化子に変換する代わりに、アセンブラの.incbin指示子で直接取り込むソースを生成します。
+ *          Cコンパイラによる巨大な初期化子の解析が不要になります。
+ *          生成するシンボルはresource.hで宣言されるF_～およびSIZE_～と同一です。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "AssemblyBackend.h"
+
+#include <format>
+
+namespace fs = std::filesystem;
+
+namespace {
+    /// .incbinに渡す文字列リテラルとしてエスケープする。
+    std::string quote(const std::string& str_)
+    {
+        std::string result = "\"";
+        for (const char c : str_) {
+            if (c == '"' || c == '\\') result += '\\';
+            result += c;
+        }
+        result += '"';
+        return result;
+    }
+}
+
+std::string AssemblyBackend::prologue()
+{
+    return "// シンボル名の接頭辞(Mach-Oや32bit Windowsでは\"_\")はコンパイラの定義に従う。\n"
+        "#define FB_CONCAT_(a, b) a##b\n"
+        "#define FB_CONCAT(a, b) FB_CONCAT_(a, b)\n"
+        "#ifdef __USER_LABEL_PREFIX__\n"
+        "#define FB_SYMBOL(name) FB_CONCAT(__USER_LABEL_PREFIX__, name)\n"
+        "#else\n"
+        "#define FB_SYMBOL(name) name\n"
+        "#endif\n"
+        "\n"
+        "#if defined(__APPLE__)\n"
+        "#define FB_SECTION(name) .section __TEXT,__const\n"
+        "#define FB_TYPE(name)\n"
+        "#define FB_SIZE(name)\n"
+        "#elif defined(_WIN32)\n"
+        "#define FB_SECTION(name) .section .rdata,\"dr\"\n"
+        "#define FB_TYPE(name)\n"
+        "#define FB_SIZE(name)\n"
+        "#else\n"
+        "// リンカが未使用のデータを取り除けるよう、シンボルごとにセクションを分ける。\n"
+        "#define FB_SECTION(name) .section .rodata.name,\"a\"\n"
+        "#define FB_TYPE(name) .type FB_SYMBOL(name), %object\n"
+        "#define FB_SIZE(name) .size FB_SYMBOL(name), . - FB_SYMBOL(name)\n"
+        "#endif\n\n";
+}
+
+std::string AssemblyBackend::definition(const std::string& name_, const fs::path& path_, const uintmax_t size_,
+                                        const uint64_t hash_)
+{
+    const std::string data_symbol = "F_" + name_;
+    const std::string size_symbol = "SIZE_" + name_;
+    // 空のファイルは、C言語の出力と同様に要素を1つ持たせる。
+    const std::string data = size_ == 0
+                                 ? "    .byte 0\n"
+                                 : std::format("    .incbin {}\n", quote(fs::absolute(path_).generic_string()));
+    return std::format("// {} (xxh64: {:016x})\n", path_.filename().generic_string(), hash_) +
+        std::format("FB_SECTION({})\n", data_symbol) +
+        std::format("    .globl FB_SYMBOL({})\n", data_symbol) +
+        std::format("    FB_TYPE({})\n", data_symbol) +
+        std::format("    .balign {}\n", DATA_ALIGNMENT) +
+        std::format("FB_SYMBOL({}):\n", data_symbol) +
+        data +
+        std::format("    FB_SIZE({})\n", data_symbol) +
+        std::format("FB_SECTION({})\n", size_symbol) +
+        std::format("    .globl FB_SYMBOL({})\n", size_symbol) +
+        std::format("    FB_TYPE({})\n", size_symbol) +
+        "    .balign 8\n" +
+        std::format("FB_SYMBOL({}):\n", size_symbol) +
+        std::format("    .quad {}\n", size_) +
+        std::format("    FB_SIZE({})\n\n\n", size_symbol);
+}
+
+std::string AssemblyBackend::packedBegin(const unsigned alignment_)
+{
+    return "FB_SECTION(file_bundler_blob)\n"
+        "    .globl FB_SYMBOL(file_bundler_blob)\n"
+        "    FB_TYPE(file_bundler_blob)\n" +
+        std::format("    .balign {}\n", alignment_) +
+        "FB_SYMBOL(file_bundler_blob):\n";
+}
+
+std::string AssemblyBackend::packedData(const fs::path& path_, const uintmax_t size_, const uint64_t hash_,
+                                        const uintmax_t padding_)
+{
+    std::string result = std::format("// {} (xxh64: {:016x})\n", path_.filename().generic_string(), hash_);
+    if (padding_ > 0) result += std::format("    .space {}\n", padding_);
+    if (size_ > 0) result += std::format("    .incbin {}\n", quote(fs::absolute(path_).generic_string()));
+    return result;
+}
+
+std::string AssemblyBackend::packedEnd(const uintmax_t padding_, const bool empty_,
+                                       const std::vector<PackedLayout::TableEntry>& entries_)
+{
+    std::string result;
+    if (padding_ > 0) result += std::format("    .space {}\n", padding_);
+    if (empty_) result += "    .byte 0\n";
+    result += "    FB_SIZE(file_bundler_blob)\n\n\n";
+    if (entries_.empty()) return result;
+    result += "FB_SECTION(file_bundler_pack_table)\n"
+        "    .globl FB_SYMBOL(file_bundler_pack_table)\n"
+        "    FB_TYPE(file_bundler_pack_table)\n"
+        "    .balign 8\n"
+        "FB_SYMBOL(file_bundler_pack_table):\n";
+    for (const auto& [offset, size] : entries_) result += std::format("    .quad {}, {}\n", offset, size);
+    return result + "    FB_SIZE(file_bundler_pack_table)\n\n\n";
+}
+
+std::string AssemblyBackend::epilogue()
+{
+    return "#if defined(__ELF__)\n"
+        "// スタックを実行可能にする必要がないことをリンカに伝える。\n"
+        "    .section .note.GNU-stack,\"\",%progbits\n"
+        "#endif\n";
+}
@@ -0,0 +1,69 @@
+/**
+ * @file AssemblyBackend.h
+ * @date 26/10/17
+ * @brief .incbinを用いたアセンブリソースの生成
+ * @details ファイルの内容を配列初期化子に変換する代わりに、アセンブラの.incbin指示子で直接取り込むソースを生成します。
+ *          Cコンパイラによる巨大な初期化子の解析が不要になります。
+ *          生成するシンボルはresource.hで宣言されるF_～およびSIZE_～と同一です。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef ASSEMBLYBACKEND_H
+#define ASSEMBLYBACKEND_H
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "PackedLayout.h"
+
+
+class AssemblyBackend {
+public:
+    /// F_～を配置する境界
+    static constexpr unsigned DATA_ALIGNMENT = 16;
+
+    /**
+     * @brief ファイルの先頭に書き込む、プラットフォームごとの差異を吸収するマクロ定義を返します。
+     * @details 生成されるファイルはCプリプロセッサを通す前提(拡張子.S)です。ELF、Mach-O、COFFに対応します。
+     */
+    static std::string prologue();
+
+    /**
+     * @brief 1ファイル分のF_～とSIZE_～の定義を返します。
+     * @param name_ 定数名
+     * @param path_ 取り込むファイル。アセンブラの作業ディレクトリに依存しないよう絶対パスに変換されます。
+     * @param size_ ファイルサイズ
+     * @param hash_ ファイルの内容ハッシュ。
+     *              内容が変化した場合にこのソースも変化させ、ビルドシステムに再アセンブルさせるためにコメントとして埋め込みます。
+     */
+    static std::string definition(const std::string& name_, const std::filesystem::path& path_, uintmax_t size_,
+                                  uint64_t hash_);
+
+    /**
+     * @brief --packで、すべてのファイルを連結したfile_bundler_blobの開始を返します。
+     */
+    static std::string packedBegin(unsigned alignment_);
+
+    /**
+     * @brief --packで、file_bundler_blobに取り込む1ファイル分のデータを返します。
+     * @param padding_ ファイルの前に置く、境界に揃えるための0の数
+     */
+    static std::string packedData(const std::filesystem::path& path_, uintmax_t size_, uint64_t hash_,
+                                  uintmax_t padding_);
+
+    /**
+     * @brief --packで、file_bundler_blobを閉じ、file_bundler_pack_tableを定義します。
+     * @param padding_ 末尾の余白
+     * @param empty_ 連結したデータが空の場合はtrue (C言語の出力と同様に要素を1つ持たせます。)
+     */
+    static std::string packedEnd(uintmax_t padding_, bool empty_, const std::vector<PackedLayout::TableEntry>& entries_);
+
+    /**
+     * @brief ファイルの末尾に書き込む内容を返します。
+     */
+    static std::string epilogue();
+};
+
+
+#endif //ASSEMBLYBACKEND_H
@@ -0,0 +1,165 @@
+/**
+ * @file BundleCache.cpp
+ * @date 26/10/17
+ * @brief 複数の出力で共有するキャッシュ
+ * @details --jobs-fileで1つのプロセスから複数の出力を行う場合に、スレッドプールと、入力ディレクトリの走査結果、
+ *          入力ファイルの状態・内容ハッシュ、セグメントの処理結果(エンコード・圧縮)を出力の間で共有します。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "BundleCache.h"
+
+#include <cstring>
+#include <ranges>
+
+namespace fs = std::filesystem;
+
+BundleCache::BundleCache(const unsigned jobs_, const uintmax_t max_bytes_)
+    : _pool(jobs_), _max_bytes(max_bytes_)
+{
+    std::error_code ec;
+    _base = fs::current_path(ec);
+}
+
+const DirectoryScanner::Result& BundleCache::scan(const fs::path& root_, const DirectoryScanner::Options& options_)
+{
+    ScanKey scan_key{key(root_), options_.recursive, options_.include, options_.exclude};
+    {
+        std::lock_guard lock(_mutex);
+        if (const auto it = _scans.find(scan_key); it != _scans.end()) {
+            ++_stats.scan_hits;
+            return it->second;
+        }
+    }
+    // 走査はpoolで行うため、ロックを保持せずに行う。
+    DirectoryScanner::Result result = DirectoryScanner(root_, options_).scan(_pool);
+    std::lock_guard lock(_mutex);
+    ++_stats.scans;
+    return _scans.try_emplace(std::move(scan_key), std::move(result)).first->second;
+}
+
+void BundleCache::retain(const fs::path& path_)
+{
+    std::lock_guard lock(_mutex);
+    ++_files[key(path_)].users;
+}
+
+void BundleCache::release(const fs::path& path_)
+{
+    std::lock_guard lock(_mutex);
+    const auto it = _files.find(key(path_));
+    if (it == _files.end() || it->second.users == 0) return;
+    if (--it->second.users > 0) return;
+    for (const auto& segment : it->second.segments | std::views::values) _bytes -= segment.text.size();
+    it->second.segments.clear();
+}
+
+std::optional<BundleCache::FileStatus> BundleCache::findStatus(const fs::path& path_)
+{
+    std::lock_guard lock(_mutex);
+    const auto it = _files.find(key(path_));
+    if (it == _files.end() || !it->second.status) return std::nullopt;
+    ++_stats.status_hits;
+    return it->second.status;
+}
+
+void BundleCache::storeStatus(const fs::path& path_, const FileStatus status_)
+{
+    std::lock_guard lock(_mutex);
+    _files[key(path_)].status = status_;
+}
+
+std::optional<uint64_t> BundleCache::findHash(const fs::path& path_)
+{
+    std::lock_guard lock(_mutex);
+    const auto it = _files.find(key(path_));
+    if (it == _files.end() || !it->second.hash) return std::nullopt;
+    ++_stats.hash_hits;
+    return it->second.hash;
+}
+
+void BundleCache::storeHash(const fs::path& path_, const uint64_t hash_)
+{
+    std::lock_guard lock(_mutex);
+    _files[key(path_)].hash = hash_;
+}
+
+std::optional<BundleCache::Segment> BundleCache::findSegment(const fs::path& path_, const uintmax_t offset_,
+                                                             const int kind_)
+{
+    std::lock_guard lock(_mutex);
+    const auto file = _files.find(key(path_));
+    if (file == _files.end()) return std::nullopt;
+    const auto it = file->second.segments.find({offset_, kind_});
+    if (it == file->second.segments.end()) return std::nullopt;
+    ++_stats.segment_hits;
+    return it->second;
+}
+
+void BundleCache::storeSegment(const fs::path& path_, const uintmax_t offset_, const int kind_,
+                               const std::string_view text_, const uint64_t hash_, const uint32_t crc_)
+{
+    const std::string file_key = key(path_);
+    {
+        // 複製する前に、記録の対象であるかを確認する。
+        std::lock_guard lock(_mutex);
+        const auto file = _files.find(file_key);
+        if (file == _files.end() || file->second.users < 2 || _bytes + text_.size() > _max_bytes) return;
+    }
+    // エンコード結果のバッファは必要なサイズより大きく確保されているため、内容のみを複製して保持する。
+    std::shared_ptr<char[]> buffer = std::make_shared_for_overwrite<char[]>(text_.size());
+    if (!text_.empty()) std::memcpy(buffer.get(), text_.data(), text_.size());
+    std::lock_guard lock(_mutex);
+    File& file = _files[file_key];
+    if (file.users < 2 || _bytes + text_.size() > _max_bytes) return;
+    const Segment segment{{buffer.get(), text_.size()}, hash_, crc_, buffer};
+    if (const auto [it, inserted] = file.segments.try_emplace({offset_, kind_}, segment); inserted) {
+        _bytes += text_.size();
+        ++_stats.segments;
+    }
+}
+
+bool BundleCache::hasSegment(const fs::path& path_, const uintmax_t offset_, const int kind_) const
+{
+    std::lock_guard lock(_mutex);
+    const auto file = _files.find(key(path_));
+    return file != _files.end() && file->second.segments.contains({offset_, kind_});
+}
+
+void BundleCache::invalidate(const fs::path& dir_)
+{
+    const std::string dir = key(dir_);
+    std::lock_guard lock(_mutex);
+    // 再帰的な走査は下位のディレクトリも含むため、dirの上位のディレクトリの走査結果も破棄する。
+    std::erase_if(_scans, [&](const auto& scan_) {
+        const std::string& root = std::get<0>(scan_.first);
+        return isWithin(root, dir) || isWithin(dir, root);
+    });
+    for (auto& [path, file] : _files) {
+        if (!isWithin(path, dir)) continue;
+        for (const auto& segment : file.segments | std::views::values) _bytes -= segment.text.size();
+        file.segments.clear();
+        file.status.reset();
+        file.hash.reset();
+    }
+}
+
+BundleCache::Stats BundleCache::stats() const
+{
+    std::lock_guard lock(_mutex);
+    return _stats;
+}
+
+std::string BundleCache::key(const fs::path& path_) const
+{
+    return (_base / path_).lexically_normal().generic_string();
+}
+
+bool BundleCache::isWithin(std::string_view child_, std::string_view parent_)
+{
+    // 末尾の区切り文字の有無によらず比較する。(ルートディレクトリ"/"は区切り文字を残す。)
+    if (parent_.size() > 1 && parent_.ends_with('/')) parent_.remove_suffix(1);
+    if (child_.size() > 1 && child_.ends_with('/')) child_.remove_suffix(1);
+    if (!child_.starts_with(parent_)) return false;
+    return child_.size() == parent_.size() || parent_.ends_with('/') || child_[parent_.size()] == '/';
+}
@@ -0,0 +1,158 @@
+/**
+ * @file BundleCache.h
+ * @date 26/10/17
+ * @brief 複数の出力で共有するキャッシュ
+ * @details --jobs-fileで1つのプロセスから複数の出力を行う場合に、スレッドプールと、入力ディレクトリの走査結果、
+ *          入力ファイルの状態・内容ハッシュ、セグメントの処理結果(エンコード・圧縮)を出力の間で共有します。
+ *          複数の出力から参照される入力は、1回の実行につき1度だけ読み込み・エンコードされます。
+ *          キャッシュは実行中に入力が変更されないことを前提とします。出力を他の出力の入力とする場合は、
+ *          出力した後にinvalidate()で出力先ディレクトリの記録を破棄してください。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef BUNDLECACHE_H
+#define BUNDLECACHE_H
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "DirectoryScanner.h"
+#include "WorkerPool.h"
+
+
+class BundleCache {
+public:
+    /// セグメントの処理結果を保持するメモリの既定の上限 (バイト)
+    static constexpr uintmax_t DEFAULT_MAX_BYTES = 1024ull * 1024 * 1024;
+
+    /// 入力ファイルの状態
+    struct FileStatus {
+        uintmax_t size = 0;
+        int64_t mtime = 0;
+    };
+
+    /// キャッシュしたセグメントの処理結果
+    struct Segment {
+        /// 書き込む内容。bufferを参照します。
+        std::string_view text;
+        /// セグメントの入力のXXH64
+        uint64_t hash = 0;
+        /// セグメントの入力のCRC32C (計算しなかった処理の種類では0)
+        uint32_t crc = 0;
+        std::shared_ptr<const char[]> buffer;
+    };
+
+    /// --statsで表示する、キャッシュの利用状況
+    struct Stats {
+        size_t scans = 0;
+        size_t scan_hits = 0;
+        size_t status_hits = 0;
+        size_t hash_hits = 0;
+        size_t segments = 0;
+        size_t segment_hits = 0;
+    };
+
+    /**
+     * @param jobs_ 共有するスレッドプールのスレッド数
+     * @param max_bytes_ セグメントの処理結果を保持するメモリの上限。超える場合は以降の結果を保持しない。
+     */
+    explicit BundleCache(unsigned jobs_, uintmax_t max_bytes_ = DEFAULT_MAX_BYTES);
+
+    [[nodiscard]] WorkerPool& pool() { return _pool; }
+
+    /**
+     * @brief 入力ディレクトリを走査します。同じディレクトリ・条件の走査は2回目以降、前回の結果を返します。
+     */
+    [[nodiscard]] const DirectoryScanner::Result& scan(const std::filesystem::path& root_,
+                                                       const DirectoryScanner::Options& options_);
+
+    /**
+     * @brief 入力ファイルを参照する出力の数を加算・減算します。
+     * @details セグメントの処理結果は、残りの出力から参照される入力のみ保持します。
+     *          参照する出力が0になった入力の処理結果は破棄します。
+     */
+    void retain(const std::filesystem::path& path_);
+    void release(const std::filesystem::path& path_);
+
+    [[nodiscard]] std::optional<FileStatus> findStatus(const std::filesystem::path& path_);
+    void storeStatus(const std::filesystem::path& path_, FileStatus status_);
+
+    /**
+     * @brief 入力ファイルの内容ハッシュ(FileBundler.cppのaddSegmentHashを参照)を取得・記録します。
+     */
+    [[nodiscard]] std::optional<uint64_t> findHash(const std::filesystem::path& path_);
+    void storeHash(const std::filesystem::path& path_, uint64_t hash_);
+
+    /**
+     * @brief セグメントの処理結果を取得・記録します。
+     * @param kind_ 処理の種類。同じ入力・位置でも、種類(エンコードの形式など)が異なる結果は区別する。
+     * @details 記録は、他の出力からも参照される入力で、上限を超えない場合のみ行います。
+     */
+    [[nodiscard]] std::optional<Segment> findSegment(const std::filesystem::path& path_, uintmax_t offset_, int kind_);
+    void storeSegment(const std::filesystem::path& path_, uintmax_t offset_, int kind_, std::string_view text_,
+                      uint64_t hash_, uint32_t crc_);
+
+    /**
+     * @brief 処理結果が記録されているかを返します。(利用状況の集計には含めません。)
+     */
+    [[nodiscard]] bool hasSegment(const std::filesystem::path& path_, uintmax_t offset_, int kind_) const;
+
+    /**
+     * @brief ディレクトリdirの内容が変更された場合に、dirに関係する走査結果と、dir以下のファイルの記録を破棄します。
+     * @details dirを含む(またはdirに含まれる)ディレクトリの走査結果と、dir以下のファイルの状態・内容ハッシュ・
+     *          セグメントの処理結果を破棄します。ファイルを参照する出力の数は保持します。
+     */
+    void invalidate(const std::filesystem::path& dir_);
+
+    [[nodiscard]] Stats stats() const;
+
+    BundleCache() = delete;
+    BundleCache(const BundleCache&) = delete;
+    BundleCache(BundleCache&&) = delete;
+    BundleCache& operator=(const BundleCache&) = delete;
+    BundleCache& operator=(BundleCache&&) = delete;
+
+private:
+    /// 入力ファイル1つ分の記録
+    struct File {
+        /// 残りの出力のうち、このファイルを参照する出力の数
+        unsigned users = 0;
+        std::optional<FileStatus> status;
+        std::optional<uint64_t> hash;
+        /// (オフセット, 処理の種類)ごとの処理結果
+        std::map<std::pair<uintmax_t, int>, Segment> segments;
+    };
+
+    using ScanKey = std::tuple<std::string, bool, std::vector<std::string>, std::vector<std::string>>;
+
+    /**
+     * @brief パスを比較できる形(カレントディレクトリからの絶対パス)にします。
+     */
+    [[nodiscard]] std::string key(const std::filesystem::path& path_) const;
+
+    /**
+     * @brief key()で得たパスchildが、parentまたはその下にあるかを返します。
+     */
+    [[nodiscard]] static bool isWithin(std::string_view child_, std::string_view parent_);
+
+    WorkerPool _pool;
+    uintmax_t _max_bytes;
+    /// 相対パスの基準とするカレントディレクトリ
+    std::filesystem::path _base;
+    mutable std::mutex _mutex;
+    std::map<ScanKey, DirectoryScanner::Result> _scans;
+    std::map<std::string, File> _files;
+    /// 保持しているセグメントの処理結果のバイト数
+    uintmax_t _bytes = 0;
+    Stats _stats;
+};
+
+
+#endif //BUNDLECACHE_H
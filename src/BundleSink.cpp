@@ -0,0 +1,155 @@
+/**
+ * @file BundleSink.cpp
+ * @date 26/10/17
+ * @brief 生成したヘッダファイル・ソースファイルの出力先
+ * @details FileSinkは出力先ディレクトリへ書き込みます。(コマンドラインからの実行で用います。)
+ *          MemorySinkとCallbackSinkはファイルを作成しないため、ライブラリとして呼び出す場合に
+ *          生成結果をファイルを経由せずに受け取れます。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "BundleSink.h"
+
+#include <streambuf>
+#include <utility>
+
+#include "OutputFile.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    class FileOutput final : public BundleSink::Output {
+    public:
+        explicit FileOutput(fs::path path_) : _file(std::move(path_)) {}
+
+        bool open() { return _file.open(); }
+
+        std::ostream& stream() override { return _file.stream(); }
+
+        void close() override { _file.close(); }
+
+        bool commit() override { return _file.commit(); }
+
+        void discard() override { _file.discard(); }
+
+    private:
+        OutputFile _file;
+    };
+
+    /**
+     * @brief std::stringへ追記するストリームバッファ
+     * @details std::ostringstreamと異なり、完成した内容を複製せずに取り出せます。
+     *          tellp()は書き込み済みのバイト数を返します。
+     */
+    class StringBuffer final : public std::streambuf {
+    public:
+        /**
+         * @param buffer_ 書き込み先。内容は破棄し、確保済みの領域のみを再利用する。
+         */
+        explicit StringBuffer(std::string buffer_) : _data(std::move(buffer_)) { _data.clear(); }
+
+        std::string& data() { return _data; }
+
+    protected:
+        int_type overflow(const int_type c_) override
+        {
+            if (traits_type::eq_int_type(c_, traits_type::eof())) return traits_type::not_eof(c_);
+            _data.push_back(traits_type::to_char_type(c_));
+            return c_;
+        }
+
+        std::streamsize xsputn(const char* s_, const std::streamsize n_) override
+        {
+            _data.append(s_, static_cast<size_t>(n_));
+            return n_;
+        }
+
+        pos_type seekoff(const off_type off_, const std::ios_base::seekdir dir_,
+                         const std::ios_base::openmode which_) override
+        {
+            // 書き込み位置の取得(tellp)のみに対応する。
+            if (off_ != 0 || dir_ != std::ios_base::cur || !(which_ & std::ios_base::out)) return pos_type(off_type(-1));
+            return pos_type(static_cast<off_type>(_data.size()));
+        }
+
+    private:
+        std::string _data;
+    };
+
+    /// 書き込んだ内容をcommit()の時点でcommitterに渡す出力ファイル
+    class StringOutput final : public BundleSink::Output {
+    public:
+        using Committer = std::function<bool(std::string& content_)>;
+
+        StringOutput(Committer committer_, std::string buffer_)
+            : _committer(std::move(committer_)), _buffer(std::move(buffer_)), _stream(&_buffer)
+        {
+        }
+
+        std::ostream& stream() override { return _stream; }
+
+        bool commit() override
+        {
+            if (!_pending) return false;
+            _pending = false;
+            return !_stream.fail() && _committer(_buffer.data());
+        }
+
+        void discard() override
+        {
+            _pending = false;
+            _buffer.data().clear();
+        }
+
+    private:
+        Committer _committer;
+        StringBuffer _buffer;
+        std::ostream _stream;
+        bool _pending = true;
+    };
+}
+
+FileSink::FileSink(fs::path directory_) : _directory(std::move(directory_)) {}
+
+std::unique_ptr<BundleSink::Output> FileSink::open(const std::string& name_)
+{
+    auto output = std::make_unique<FileOutput>(_directory / name_);
+    if (!output->open()) return nullptr;
+    return output;
+}
+
+std::unique_ptr<BundleSink::Output> MemorySink::open(const std::string& name_)
+{
+    // 前回の同じ名前の出力の領域を再利用し、大きな出力の拡張による複製を避ける。
+    std::string buffer;
+    {
+        std::lock_guard lock(_mutex);
+        if (const auto spare = _spares.find(name_); spare != _spares.end()) {
+            buffer = std::move(spare->second);
+            _spares.erase(spare);
+        }
+    }
+    return std::make_unique<StringOutput>([this, name_](std::string& content_) {
+        std::lock_guard lock(_mutex);
+        const auto [it, inserted] = _files.try_emplace(name_);
+        std::swap(it->second, content_);
+        if (!inserted) _spares.insert_or_assign(name_, std::move(content_));
+        return true;
+    }, std::move(buffer));
+}
+
+void MemorySink::clear()
+{
+    std::lock_guard lock(_mutex);
+    _files.clear();
+    _spares.clear();
+}
+
+CallbackSink::CallbackSink(Callback callback_) : _callback(std::move(callback_)) {}
+
+std::unique_ptr<BundleSink::Output> CallbackSink::open(const std::string& name_)
+{
+    return std::make_unique<StringOutput>([this, name_](const std::string& content_) {
+        return _callback(name_, content_);
+    }, std::string());
+}
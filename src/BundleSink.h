@@ -0,0 +1,148 @@
+/**
+ * @file BundleSink.h
+ * @date 26/10/17
+ * @brief 生成したヘッダファイル・ソースファイルの出力先
+ * @details FileSinkは出力先ディレクトリへ書き込みます。(コマンドラインからの実行で用います。)
+ *          MemorySinkとCallbackSinkはファイルを作成しないため、ライブラリとして呼び出す場合に
+ *          生成結果をファイルを経由せずに受け取れます。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef BUNDLESINK_H
+#define BUNDLESINK_H
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+
+class BundleSink {
+public:
+    /// 1つの出力ファイル
+    class Output {
+    public:
+        virtual ~Output() = default;
+
+        virtual std::ostream& stream() = 0;
+
+        /**
+         * @brief 書き込みを終えます。出力先への反映はcommit()で行います。
+         */
+        virtual void close() {}
+
+        /**
+         * @brief 書き込んだ内容を出力先に反映します。
+         * @return 反映に失敗した場合はfalse
+         */
+        virtual bool commit() = 0;
+
+        /**
+         * @brief 書き込んだ内容を破棄します。
+         */
+        virtual void discard() = 0;
+    };
+
+    virtual ~BundleSink() = default;
+
+    /**
+     * @brief nameの出力ファイルを開きます。
+     * @return 開けなかった場合はnullptr
+     */
+    [[nodiscard]] virtual std::unique_ptr<Output> open(const std::string& name_) = 0;
+
+    /**
+     * @brief 出力先ディレクトリを返します。ファイル以外の出力先では空です。
+     * @details 空の場合、前回の出力の再利用・上書きの確認・古い出力の削除は行われません。
+     */
+    [[nodiscard]] virtual std::filesystem::path directory() const { return {}; }
+};
+
+
+/**
+ * @brief 出力先ディレクトリへ書き込みます。内容が変化したファイルのみを置き換えます。(OutputFileを参照)
+ */
+class FileSink final : public BundleSink {
+public:
+    explicit FileSink(std::filesystem::path directory_);
+
+    [[nodiscard]] std::unique_ptr<Output> open(const std::string& name_) override;
+
+    [[nodiscard]] std::filesystem::path directory() const override { return _directory; }
+
+    FileSink() = delete;
+    FileSink(const FileSink&) = delete;
+    FileSink(FileSink&&) = delete;
+    FileSink& operator=(const FileSink&) = delete;
+    FileSink& operator=(FileSink&&) = delete;
+
+private:
+    std::filesystem::path _directory;
+};
+
+
+/**
+ * @brief 出力ファイルの内容をメモリ上に保持します。
+ * @details 同じ名前の出力ファイルは、commit()の時点で置き換えられます。
+ *          置き換えられた内容の領域は次の同じ名前の出力で再利用するため、1つのインスタンスを繰り返し用いると
+ *          大きな出力でも領域の確保と拡張による複製が発生しません。(保持する領域は最大で出力の2倍となります。)
+ */
+class MemorySink final : public BundleSink {
+public:
+    MemorySink() = default;
+
+    [[nodiscard]] std::unique_ptr<Output> open(const std::string& name_) override;
+
+    /**
+     * @brief 出力ファイルの名前と内容を返します。
+     */
+    [[nodiscard]] const std::map<std::string, std::string>& files() const { return _files; }
+
+    /**
+     * @brief 保持している内容と、再利用のための領域を解放します。
+     */
+    void clear();
+
+    MemorySink(const MemorySink&) = delete;
+    MemorySink(MemorySink&&) = delete;
+    MemorySink& operator=(const MemorySink&) = delete;
+    MemorySink& operator=(MemorySink&&) = delete;
+
+private:
+    std::mutex _mutex;
+    std::map<std::string, std::string> _files;
+    /// 置き換えられた内容の領域 (内容は不定)
+    std::map<std::string, std::string> _spares;
+};
+
+
+/**
+ * @brief 出力ファイルの内容を、commit()の時点でコールバックに渡します。
+ */
+class CallbackSink final : public BundleSink {
+public:
+    /**
+     * @brief 出力ファイルの名前と内容を受け取ります。contentは呼び出しの間のみ有効です。
+     * @return 受け取りに失敗した場合はfalse (出力はエラーとなります。)
+     */
+    using Callback = std::function<bool(const std::string& name_, std::string_view content_)>;
+
+    explicit CallbackSink(Callback callback_);
+
+    [[nodiscard]] std::unique_ptr<Output> open(const std::string& name_) override;
+
+    CallbackSink() = delete;
+    CallbackSink(const CallbackSink&) = delete;
+    CallbackSink(CallbackSink&&) = delete;
+    CallbackSink& operator=(const CallbackSink&) = delete;
+    CallbackSink& operator=(CallbackSink&&) = delete;
+
+private:
+    Callback _callback;
+};
+
+
+#endif //BUNDLESINK_H
@@ -0,0 +1,179 @@
+/**
+ * @file ByteEncoder.cpp
+ * @date 26/10/17
+ * @brief バイト列をC言語の配列初期化子へ変換するエンコーダ
+ * @details 1バイトごとの整数フォーマットを避けるため、全256値の出力文字列を事前に計算したテーブルを用いて
+ *          チャンク単位で変換します。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "ByteEncoder.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace {
+    /// 1バイト分の出力。8バイト単位でそのままコピーできるよう、長さを末尾に持たせる。
+    struct Entry {
+        char text[7];
+        unsigned char length;
+    };
+
+    static_assert(sizeof(Entry) == 8);
+
+    using Table = std::array<Entry, 256>;
+
+    constexpr char hex_digits[] = "0123456789abcdef";
+
+    constexpr Table makeIntegerTable(const bool hex_)
+    {
+        Table table{};
+        for (int i = 0; i < 256; ++i) {
+            // 出力先の配列はcharのため、C++でも縮小変換とならないよう符号付きの値として書き込む。
+            int value = i < 128 ? i : i - 256;
+            Entry& entry = table[i];
+            unsigned char pos = 0;
+            entry.text[pos++] = ',';
+            entry.text[pos++] = ' ';
+            if (value < 0) {
+                entry.text[pos++] = '-';
+                value = -value;
+            }
+            if (hex_) {
+                entry.text[pos++] = '0';
+                entry.text[pos++] = 'x';
+                entry.text[pos++] = hex_digits[value >> 4];
+                entry.text[pos++] = hex_digits[value & 0xf];
+            }
+            else {
+                if (value >= 100) entry.text[pos++] = static_cast<char>('0' + value / 100);
+                if (value >= 10) entry.text[pos++] = static_cast<char>('0' + value / 10 % 10);
+                entry.text[pos++] = static_cast<char>('0' + value % 10);
+            }
+            entry.length = pos;
+        }
+        return table;
+    }
+
+    constexpr Table makeStringTable()
+    {
+        Table table{};
+        for (int i = 0; i < 256; ++i) {
+            Entry& entry = table[i];
+            unsigned char pos = 0;
+            switch (i) {
+            case '\n': entry.text[pos++] = '\\'; entry.text[pos++] = 'n'; break;
+            case '\t': entry.text[pos++] = '\\'; entry.text[pos++] = 't'; break;
+            case '\r': entry.text[pos++] = '\\'; entry.text[pos++] = 'r'; break;
+            case '"': entry.text[pos++] = '\\'; entry.text[pos++] = '"'; break;
+            case '\\': entry.text[pos++] = '\\'; entry.text[pos++] = '\\'; break;
+            default:
+                if (i >= 0x20 && i < 0x7f) { entry.text[pos++] = static_cast<char>(i); }
+                else {
+                    // 後続の文字が数字でも続けて解釈されないよう、8進数は常に3桁で書き込む。
+                    entry.text[pos++] = '\\';
+                    entry.text[pos++] = static_cast<char>('0' + (i >> 6));
+                    entry.text[pos++] = static_cast<char>('0' + (i >> 3 & 7));
+                    entry.text[pos++] = static_cast<char>('0' + (i & 7));
+                }
+            }
+            entry.length = pos;
+        }
+        return table;
+    }
+
+    constexpr Table decimal_table = makeIntegerTable(false);
+    constexpr Table hex_table = makeIntegerTable(true);
+    constexpr Table string_table = makeStringTable();
+
+    inline char* put(const Table& table_, char* out_, const char byte_)
+    {
+        const Entry& entry = table_[static_cast<unsigned char>(byte_)];
+        std::memcpy(out_, &entry, sizeof(Entry));
+        return out_ + entry.length;
+    }
+
+    size_t encodeIntegers(const Table& table_, const char* data_, const size_t size_, char* out_)
+    {
+        char* out = out_;
+        size_t i = 0;
+        for (; i + 4 <= size_; i += 4) {
+            out = put(table_, out, data_[i]);
+            out = put(table_, out, data_[i + 1]);
+            out = put(table_, out, data_[i + 2]);
+            out = put(table_, out, data_[i + 3]);
+        }
+        for (; i < size_; ++i)
+            out = put(table_, out, data_[i]);
+        return static_cast<size_t>(out - out_);
+    }
+
+    size_t encodeString(const char* data_, const size_t size_, char* out_)
+    {
+        char* out = out_;
+        for (size_t line = 0; line < size_; line += ByteEncoder::STRING_LINE_LENGTH) {
+            const size_t end = std::min(size_, line + ByteEncoder::STRING_LINE_LENGTH);
+            *out++ = '"';
+            for (size_t i = line; i < end; ++i) {
+                // "??"から始まる3文字表記(トライグラフ)と解釈されないよう、連続する2文字目の'?'をエスケープする。
+                if (data_[i] == '?' && i > line && data_[i - 1] == '?') {
+                    *out++ = '\\';
+                    *out++ = '?';
+                    continue;
+                }
+                out = put(string_table, out, data_[i]);
+            }
+            *out++ = '"';
+            *out++ = '\n';
+        }
+        return static_cast<size_t>(out - out_);
+    }
+}
+
+ByteEncoder::ByteEncoder(const Format format_) : _format(format_) {}
+
+std::string_view ByteEncoder::initializerBegin(const Format format_)
+{
+    return format_ == Format::STRING ? "\n" : " {";
+}
+
+std::string_view ByteEncoder::initializerEnd(const Format format_)
+{
+    return format_ == Format::STRING ? ";\n\n\n" : "};\n\n\n";
+}
+
+std::string_view ByteEncoder::separator(const Format format_)
+{
+    // 文字列リテラルは隣接するだけで連結される。
+    return format_ == Format::STRING ? "" : ", ";
+}
+
+std::string_view ByteEncoder::emptyInitializer(const Format format_)
+{
+    // 文字列リテラルは末尾のNUL文字が要素となる。
+    return format_ == Format::STRING ? "\"\"\n" : "0";
+}
+
+size_t ByteEncoder::encode(const Format format_, const char* data_, const size_t size_, char* out_)
+{
+    switch (format_) {
+    case Format::HEX:
+        return encodeIntegers(hex_table, data_, size_, out_);
+    case Format::STRING:
+        return encodeString(data_, size_, out_);
+    default:
+        return encodeIntegers(decimal_table, data_, size_, out_);
+    }
+}
+
+std::string_view ByteEncoder::encode(const char* data_, const size_t size_, const bool continuation_)
+{
+    if (size_ == 0) return {};
+    if (_buffer.size() < requiredBufferSize(size_))
+        _buffer.resize(requiredBufferSize(size_));
+    const size_t written = encode(_format, data_, size_, _buffer.data());
+    // 先頭の", "を省略する。
+    const size_t skip = continuation_ || _format == Format::STRING ? 0 : 2;
+    return {_buffer.data() + skip, written - skip};
+}
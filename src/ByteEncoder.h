@@ -0,0 +1,95 @@
+/**
+ * @file ByteEncoder.h
+ * @date 26/10/17
+ * @brief バイト列をC言語の配列初期化子へ変換するエンコーダ
+ * @details 1バイトごとの整数フォーマットを避けるため、全256値の出力文字列を事前に計算したテーブルを用いて
+ *          チャンク単位で変換します。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef BYTEENCODER_H
+#define BYTEENCODER_H
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+
+class ByteEncoder {
+public:
+    /// 出力形式
+    enum class Format {
+        /// 符号付き10進数の配列初期化子 (", "区切り)
+        DECIMAL,
+        /// 符号付き16進数の配列初期化子 (", "区切り)
+        HEX,
+        /// エスケープシーケンスを用いた文字列リテラルの連結 (末尾にNUL文字が付加されます。)
+        STRING
+    };
+
+    /// 1バイトあたりに書き込む最大文字数 (", -0x80")
+    static constexpr size_t MAX_CHARS_PER_BYTE = 7;
+    /// STRING形式で1つの文字列リテラルに含める入力のバイト数
+    /// (すべてが4文字の8進エスケープ(\ooo)となった場合も、引用符を含めて4000 * 4 + 2 = 16002文字であり、
+    /// MSVCの文字列リテラル1つあたりの上限である16380文字を超えない長さ)
+    static constexpr size_t STRING_LINE_LENGTH = 4000;
+    /// テーブルの1要素は8バイト単位で書き込むため、出力バッファの末尾に必要な余白
+    static constexpr size_t STORE_SLACK = 8;
+
+    explicit ByteEncoder(Format format_ = Format::DECIMAL);
+
+    /**
+     * @brief sizeバイトの入力を変換するのに必要な出力バッファのサイズを返します。
+     */
+    static constexpr size_t requiredBufferSize(const size_t size_)
+    {
+        // STRING形式では、1行ごとに引用符2つと改行が加わる。
+        return size_ * MAX_CHARS_PER_BYTE + (size_ / STRING_LINE_LENGTH + 1) * 3 + STORE_SLACK;
+    }
+
+    /**
+     * @brief 配列の宣言("const char F_X[] =")に続けて、データ部分の前に書き込む文字列を返します。
+     */
+    static std::string_view initializerBegin(Format format_);
+
+    /**
+     * @brief データ部分の後に書き込み、宣言を閉じる文字列を返します。
+     */
+    static std::string_view initializerEnd(Format format_);
+
+    /**
+     * @brief 複数のファイルを1つの配列に連結する場合に、前の要素に続けてデータ部分を書き込む前に書き込む文字列を返します。
+     */
+    static std::string_view separator(Format format_);
+
+    /**
+     * @brief 空のファイルのデータ部分を返します。
+     * @details 要素数0の配列は宣言できないため、いずれの形式でも要素を1つ(値は0)持たせます。
+     */
+    static std::string_view emptyInitializer(Format format_);
+
+    /**
+     * @brief dataをformatに従ってoutに書き込みます。
+     * @details DECIMAL, HEXでは各要素の前に区切り文字", "を付けて書き込みます。
+     *          STRINGではSTRING_LINE_LENGTHバイトごとに、改行で終わる文字列リテラルを書き込みます。
+     *          outにはrequiredBufferSize(size_)以上の領域が必要です。
+     * @return 書き込んだ文字数
+     */
+    static size_t encode(Format format_, const char* data_, size_t size_, char* out_);
+
+    /**
+     * @brief dataを変換し、内部バッファ上の文字列として返します。
+     * @param continuation_ falseの場合、先頭要素の前の区切り文字を省略します。
+     *                      (配列の最初のチャンクではfalseを指定します。STRING形式では意味を持ちません。)
+     * @return 変換結果。次にencodeを呼び出すまで有効です。
+     */
+    std::string_view encode(const char* data_, size_t size_, bool continuation_);
+
+    [[nodiscard]] Format format() const { return _format; }
+
+private:
+    Format _format;
+    std::vector<char> _buffer;
+};
+
+
+#endif //BYTEENCODER_H
@@ -0,0 +1,164 @@
+/**
+ * @file CompressionRuntime.cpp
+ * @date 26/10/17
+ * @brief 圧縮したリソースを展開するC言語のコードの生成
+ * @details 圧縮の対象としたファイルには、初回のアクセス時に展開した内容を返すアクセサR_～を生成します。
+ *          展開先は呼び出し側が渡す領域か、file_bundler_set_arenaで登録したアリーナです。
+ *          圧縮しても十分に小さくならなかったファイルは圧縮せずに格納し、R_～はF_～の内容を返します。
+ *          生成するコードはC言語とC++のどちらとしてもコンパイルできます。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "CompressionRuntime.h"
+
+#include <format>
+
+std::string CompressionRuntime::declarations()
+{
+    return "#include <string.h>\n\n"
+        "#ifdef __cplusplus\n"
+        "extern \"C\" {\n"
+        "#endif\n"
+        "// R_～(NULL)で展開する際に使用する領域を登録します。スレッドセーフではありません。\n"
+        "void file_bundler_set_arena(void* arena, unsigned long long size);\n"
+        "// アリーナからsizeバイトを確保します。容量が不足している場合はNULLを返します。\n"
+        "char* file_bundler_allocate(unsigned long long size);\n"
+        "// LZ4ブロックのストリームをちょうどdst_sizeバイトに展開できた場合は1、それ以外は0を返します。\n"
+        "int file_bundler_decompress(const char* src, unsigned long long src_size, char* dst,\n"
+        "                            unsigned long long dst_size);\n"
+        "#ifdef __cplusplus\n"
+        "}\n"
+        "#endif\n\n\n";
+}
+
+std::string CompressionRuntime::arenaSize(const uintmax_t size_)
+{
+    return std::format("// 圧縮して格納したファイルをすべてR_～(NULL)で展開するのに必要なアリーナのサイズ\n"
+                       "#define FILE_BUNDLER_ARENA_SIZE {}ULL\n\n\n", size_);
+}
+
+std::string CompressionRuntime::definitions()
+{
+    return "#ifdef __cplusplus\n"
+        "extern \"C\" {\n"
+        "#endif\n"
+        "static char* file_bundler_arena = 0;\n"
+        "static unsigned long long file_bundler_arena_remaining = 0;\n\n"
+        "void file_bundler_set_arena(void* arena, unsigned long long size)\n"
+        "{\n"
+        "    file_bundler_arena = (char*)arena;\n"
+        "    file_bundler_arena_remaining = arena ? size : 0;\n"
+        "}\n\n"
+        "char* file_bundler_allocate(unsigned long long size)\n"
+        "{\n"
+        "    char* result = file_bundler_arena;\n"
+        "    if (!result || size > file_bundler_arena_remaining) return 0;\n"
+        "    file_bundler_arena += size;\n"
+        "    file_bundler_arena_remaining -= size;\n"
+        "    return result;\n"
+        "}\n\n"
+        "static int file_bundler_read_length(const unsigned char** ip, const unsigned char* end,\n"
+        "                                    unsigned long long* length)\n"
+        "{\n"
+        "    unsigned char b;\n"
+        "    do {\n"
+        "        if (*ip == end) return 0;\n"
+        "        b = *(*ip)++;\n"
+        "        *length += b;\n"
+        "    } while (b == 255);\n"
+        "    return 1;\n"
+        "}\n\n"
+        "// ブロックごとに4バイトのヘッダ(下位31ビット: バイト数, 最上位ビット: 無圧縮)を持つLZ4ブロックの列を展開する。\n"
+        "int file_bundler_decompress(const char* src, unsigned long long src_size, char* dst,\n"
+        "                            unsigned long long dst_size)\n"
+        "{\n"
+        "    const unsigned char* ip = (const unsigned char*)src;\n"
+        "    const unsigned char* const end = ip + src_size;\n"
+        "    unsigned char* op = (unsigned char*)dst;\n"
+        "    unsigned char* const out_end = op + dst_size;\n"
+        "    while (end - ip >= 4) {\n"
+        "        const unsigned long header = ip[0] | (unsigned long)ip[1] << 8 | (unsigned long)ip[2] << 16 |\n"
+        "            (unsigned long)ip[3] << 24;\n"
+        "        const unsigned long long length = header & 0x7fffffffUL;\n"
+        "        const unsigned char* block_end;\n"
+        "        unsigned char* block_out = op;\n"
+        "        ip += 4;\n"
+        "        if ((unsigned long long)(end - ip) < length) return 0;\n"
+        "        block_end = ip + length;\n"
+        "        if (header & 0x80000000UL) {\n"
+        "            if ((unsigned long long)(out_end - op) < length) return 0;\n"
+        "            memcpy(op, ip, (size_t)length);\n"
+        "            op += length;\n"
+        "            ip = block_end;\n"
+        "            continue;\n"
+        "        }\n"
+        "        while (ip < block_end) {\n"
+        "            const unsigned token = *ip++;\n"
+        "            unsigned long long count = token >> 4;\n"
+        "            unsigned long long offset;\n"
+        "            const unsigned char* match;\n"
+        "            if (count == 15 && !file_bundler_read_length(&ip, block_end, &count)) return 0;\n"
+        "            if ((unsigned long long)(block_end - ip) < count || (unsigned long long)(out_end - op) < count)\n"
+        "                return 0;\n"
+        "            memcpy(op, ip, (size_t)count);\n"
+        "            ip += count;\n"
+        "            op += count;\n"
+        "            if (ip == block_end) break;\n"
+        "            if (block_end - ip < 2) return 0;\n"
+        "            offset = ip[0] | (unsigned long long)ip[1] << 8;\n"
+        "            ip += 2;\n"
+        "            count = (token & 15) + 4;\n"
+        "            if ((token & 15) == 15 && !file_bundler_read_length(&ip, block_end, &count)) return 0;\n"
+        "            if (offset == 0 || (unsigned long long)(op - block_out) < offset ||\n"
+        "                (unsigned long long)(out_end - op) < count)\n"
+        "                return 0;\n"
+        "            match = op - offset;\n"
+        "            if (offset >= count) {\n"
+        "                memcpy(op, match, (size_t)count);\n"
+        "                op += count;\n"
+        "            }\n"
+        "            else {\n"
+        "                while (count--) *op++ = *match++;\n"
+        "            }\n"
+        "        }\n"
+        "    }\n"
+        "    return ip == end && op == out_end;\n"
+        "}\n"
+        "#ifdef __cplusplus\n"
+        "}\n"
+        "#endif\n\n\n";
+}
+
+std::string CompressionRuntime::accessorDeclaration(const std::string& name_)
+{
+    return "#ifdef __cplusplus\n"
+        "extern \"C\"\n"
+        "#endif\n" +
+        std::format("const char* R_{}(char* buffer);\n\n\n", name_);
+}
+
+std::string CompressionRuntime::accessorDefinition(const std::string& name_, const bool compressed_)
+{
+    std::string result = "#ifdef __cplusplus\n"
+        "extern \"C\"\n"
+        "#endif\n" +
+        std::format("const char* R_{}(char* buffer)\n", name_) +
+        "{\n";
+    if (compressed_) {
+        // 展開に成功した場合のみ結果を保持する。
+        result += "    static char* cache = 0;\n"
+            "    char* dst;\n"
+            "    if (!buffer && cache) return cache;\n" +
+            std::format("    dst = buffer ? buffer : file_bundler_allocate(SIZE_{});\n", name_) +
+            std::format("    if (!dst || !file_bundler_decompress(Z_{0}, ZSIZE_{0}, dst, SIZE_{0})) return 0;\n",
+                        name_) +
+            "    if (!buffer) cache = dst;\n"
+            "    return dst;\n";
+    }
+    else {
+        result += "    if (!buffer) " + std::format("return F_{};\n", name_) +
+            std::format("    memcpy(buffer, F_{0}, (size_t)SIZE_{0});\n", name_) +
+            "    return buffer;\n";
+    }
+    return result + "}\n\n\n";
+}
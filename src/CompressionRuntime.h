@@ -0,0 +1,51 @@
+/**
+ * @file CompressionRuntime.h
+ * @date 26/10/17
+ * @brief 圧縮したリソースを展開するC言語のコードの生成
+ * @details 圧縮の対象としたファイルには、初回のアクセス時に展開した内容を返すアクセサR_～を生成します。
+ *          展開先は呼び出し側が渡す領域か、file_bundler_set_arenaで登録したアリーナです。
+ *          圧縮しても十分に小さくならなかったファイルは圧縮せずに格納し、R_～はF_～の内容を返します。
+ *          生成するコードはC言語とC++のどちらとしてもコンパイルできます。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef COMPRESSIONRUNTIME_H
+#define COMPRESSIONRUNTIME_H
+#include <cstdint>
+#include <string>
+
+
+class CompressionRuntime {
+public:
+    /**
+     * @brief ヘッダファイルに書き込む、展開処理の関数宣言を返します。
+     */
+    static std::string declarations();
+
+    /**
+     * @brief アリーナに必要なサイズを表すマクロFILE_BUNDLER_ARENA_SIZEの定義を返します。
+     * @param size_ 圧縮して格納したファイルの展開後のサイズの合計
+     */
+    static std::string arenaSize(uintmax_t size_);
+
+    /**
+     * @brief 展開処理とアリーナの定義を返します。出力全体で1度だけ書き込みます。
+     */
+    static std::string definitions();
+
+    /**
+     * @brief 1ファイル分のアクセサの宣言を返します。
+     * @details 圧縮の対象としたファイルのデータ部分(F_～またはZ_～)は、格納方法によらず利用できるよう
+     *          ソースファイル内のstatic変数とし、ヘッダファイルではアクセサのみを宣言します。
+     */
+    static std::string accessorDeclaration(const std::string& name_);
+
+    /**
+     * @brief 1ファイル分のアクセサの定義を返します。データ部分の定義の後に書き込みます。
+     * @param compressed_ 圧縮して格納した場合はtrue (ZSIZE_～とZ_～を展開します。falseの場合はF_～を返します。)
+     */
+    static std::string accessorDefinition(const std::string& name_, bool compressed_);
+};
+
+
+#endif //COMPRESSIONRUNTIME_H
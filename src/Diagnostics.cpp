@@ -0,0 +1,61 @@
+/**
+ * @file Diagnostics.cpp
+ * @date 26/10/17
+ * @brief 出力中に発生したエラー・警告の記録
+ * @details コマンドラインから実行する場合は記録せず、従来どおり標準出力へ表示します。
+ *          ライブラリとして呼び出す場合は表示せず、呼び出し元が記録を参照します。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "Diagnostics.h"
+
+#include <iostream>
+#include <utility>
+
+#include <net_ln3/cpp_lib/PrintHelper.h>
+
+#include "constants.h"
+
+using ph = net_ln3::cpp_lib::PrintHelper;
+
+Diagnostics::Diagnostics(const bool console_) : _console(console_) {}
+
+void Diagnostics::info(std::string message_) { add({Severity::INFO, 0, std::move(message_), {}, {}}); }
+
+void Diagnostics::warning(std::string message_, std::filesystem::path path_)
+{
+    add({Severity::WARNING, 0, std::move(message_), std::move(path_), {}});
+}
+
+int Diagnostics::error(const int code_, std::string message_, std::filesystem::path path_, std::string detail_)
+{
+    add({Severity::ERROR, code_, std::move(message_), std::move(path_), std::move(detail_)});
+    return code_;
+}
+
+std::vector<Diagnostics::Entry> Diagnostics::take()
+{
+    std::lock_guard lock(_mutex);
+    return std::exchange(_entries, {});
+}
+
+void Diagnostics::add(Entry entry_)
+{
+    std::lock_guard lock(_mutex);
+    if (_console) {
+        switch (entry_.severity) {
+        case Severity::ERROR:
+            std::cout << ph::Color("エラー", ERROR_COLOR) << ": " << entry_.message << std::endl;
+            break;
+        case Severity::WARNING:
+            std::cout << ph::Color("警告", WARN_COLOR) << ": " << entry_.message << std::endl;
+            break;
+        default:
+            std::cout << entry_.message << std::endl;
+            break;
+        }
+        if (!entry_.detail.empty()) std::cerr << entry_.detail << std::endl;
+        return;
+    }
+    _entries.push_back(std::move(entry_));
+}
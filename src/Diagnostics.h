@@ -0,0 +1,74 @@
+/**
+ * @file Diagnostics.h
+ * @date 26/10/17
+ * @brief 出力中に発生したエラー・警告の記録
+ * @details コマンドラインから実行する場合は記録せず、従来どおり標準出力へ表示します。
+ *          ライブラリとして呼び出す場合は表示せず、呼び出し元が記録を参照します。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef DIAGNOSTICS_H
+#define DIAGNOSTICS_H
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+class Diagnostics {
+public:
+    enum class Severity {
+        /// 処理の経過や結果の報告 (--statsの統計など)
+        INFO,
+        WARNING,
+        ERROR
+    };
+
+    struct Entry {
+        Severity severity;
+        /// 処理を中断したエラーの場合はFileBundler::bundle()の戻り値と同じコード。それ以外は0。
+        int code;
+        std::string message;
+        /// 関係するファイル (存在しない場合は空)
+        std::filesystem::path path;
+        /// 例外のメッセージなどの詳細 (存在しない場合は空)
+        std::string detail;
+    };
+
+    /**
+     * @param console_ trueの場合、記録せずに標準出力(詳細は標準エラー出力)へ表示する。
+     */
+    explicit Diagnostics(bool console_);
+
+    void info(std::string message_);
+
+    void warning(std::string message_, std::filesystem::path path_ = {});
+
+    /**
+     * @return code
+     */
+    int error(int code_, std::string message_, std::filesystem::path path_ = {}, std::string detail_ = {});
+
+    [[nodiscard]] bool console() const { return _console; }
+
+    /**
+     * @brief 記録を取り出し、記録を空にします。
+     */
+    [[nodiscard]] std::vector<Entry> take();
+
+    Diagnostics() = delete;
+    Diagnostics(const Diagnostics&) = delete;
+    Diagnostics(Diagnostics&&) = delete;
+    Diagnostics& operator=(const Diagnostics&) = delete;
+    Diagnostics& operator=(Diagnostics&&) = delete;
+
+private:
+    void add(Entry entry_);
+
+    bool _console;
+    std::mutex _mutex;
+    std::vector<Entry> _entries;
+};
+
+
+#endif //DIAGNOSTICS_H
@@ -0,0 +1,206 @@
+/**
+ * @file DirectoryScanner.cpp
+ * @date 26/10/17
+ * @brief 入力ディレクトリの並列走査とglobによる絞り込み
+ * @details ディレクトリごとに1つのタスクとしてWorkerPoolで並列に走査します。
+ *          ファイルの種類はディレクトリエントリのd_typeから判定し、判定できない場合(シンボリックリンクや
+ *          d_typeに対応しないファイルシステム)のみstatを呼び出します。
+ *          シンボリックリンクのディレクトリはループを避けるため辿りません。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "DirectoryScanner.h"
+
+#include <algorithm>
+#include <deque>
+#include <optional>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+#include "Trace.h"
+#include "WorkerPool.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    /// パターンの先頭の"./"と末尾の"/"を取り除く。
+    std::string normalizePattern(std::string pattern_)
+    {
+        while (pattern_.starts_with("./")) pattern_.erase(0, 2);
+        while (pattern_.size() > 1 && pattern_.ends_with("/")) pattern_.pop_back();
+        return pattern_;
+    }
+
+    /**
+     * @brief pattern[index]から始まる文字クラスとcを比較します。
+     * @param index_ 一致した場合は、クラスの次の位置に更新されます。
+     * @return クラスが閉じていない場合はnullopt
+     */
+    std::optional<bool> matchClass(const std::string_view pattern_, size_t& index_, const char c_)
+    {
+        size_t i = index_ + 1;
+        const bool negate = i < pattern_.size() && (pattern_[i] == '!' || pattern_[i] == '^');
+        if (negate) ++i;
+        bool matched = false;
+        // 先頭の"]"はクラスの文字として扱う。
+        for (bool first = true; i < pattern_.size() && (first || pattern_[i] != ']'); first = false) {
+            const char low = pattern_[i];
+            if (i + 2 < pattern_.size() && pattern_[i + 1] == '-' && pattern_[i + 2] != ']') {
+                matched = matched || (low <= c_ && c_ <= pattern_[i + 2]);
+                i += 3;
+            }
+            else {
+                matched = matched || low == c_;
+                ++i;
+            }
+        }
+        if (i >= pattern_.size()) return std::nullopt;
+        index_ = i + 1;
+        return matched != negate && c_ != '/';
+    }
+}
+
+DirectoryScanner::DirectoryScanner(fs::path root_, Options options_)
+    : _root(std::move(root_)), _options(std::move(options_))
+{
+    for (auto& pattern : _options.include) pattern = normalizePattern(std::move(pattern));
+    for (auto& pattern : _options.exclude) pattern = normalizePattern(std::move(pattern));
+}
+
+DirectoryScanner::Result DirectoryScanner::scan(WorkerPool& pool_) const
+{
+    // 各タスクは1つのディレクトリを読み込み、見つかったサブディレクトリは呼び出し元がタスクとして登録する。
+    // ワーカー内で他のタスクの完了を待たないため、スレッド数によらずデッドロックしない。
+    Result result;
+    std::deque<std::pair<std::string, std::future<Listing>>> pending;
+    pending.emplace_back("", pool_.submit([this] { return list(""); }));
+    while (!pending.empty()) {
+        auto [relative, future] = std::move(pending.front());
+        pending.pop_front();
+        Listing listing = future.get();
+        fs::path directory = relative.empty() ? _root : _root / relative;
+        if (listing.failed) result.errors.push_back(std::move(directory));
+        else result.directories.push_back(std::move(directory));
+        std::ranges::move(listing.files, std::back_inserter(result.files));
+        for (auto& subdirectory : listing.directories) {
+            auto task = pool_.submit([this, subdirectory] { return list(subdirectory); });
+            pending.emplace_back(std::move(subdirectory), std::move(task));
+        }
+    }
+    std::ranges::sort(result.files, {}, &Entry::relative);
+    return result;
+}
+
+DirectoryScanner::Listing DirectoryScanner::list(const std::string& relative_) const
+{
+    Trace::Span span("scan_directory", relative_);
+    Listing listing;
+    const fs::path directory = relative_.empty() ? _root : _root / relative_;
+    auto add_entry = [&](const std::string& name_, const bool is_file_, const bool is_directory_) {
+        std::string relative = relative_.empty() ? name_ : relative_ + "/" + name_;
+        if (is_directory_) {
+            if (_options.recursive && !matchAny(_options.exclude, relative))
+                listing.directories.push_back(std::move(relative));
+        }
+        else if (is_file_ && (_options.include.empty() || matchAny(_options.include, relative)) &&
+            !matchAny(_options.exclude, relative)) {
+            listing.files.push_back({directory / name_, std::move(relative)});
+        }
+    };
+
+#ifdef _WIN32
+    std::error_code ec;
+    fs::directory_iterator it(directory, ec);
+    if (ec) {
+        listing.failed = true;
+        return listing;
+    }
+    // Windowsではディレクトリの列挙時に種類が取得されるため、追加の問い合わせは発生しない。
+    for (const auto& entry : it) {
+        const bool is_symlink = entry.is_symlink(ec);
+        add_entry(entry.path().filename().generic_string(), entry.is_regular_file(ec),
+                  !is_symlink && entry.is_directory(ec));
+    }
+#else
+    DIR* dir = ::opendir(directory.c_str());
+    if (!dir) {
+        listing.failed = true;
+        return listing;
+    }
+    const int dir_fd = ::dirfd(dir);
+    while (const dirent* entry = ::readdir(dir)) {
+        const std::string_view name = entry->d_name;
+        if (name == "." || name == "..") continue;
+        unsigned char type = entry->d_type;
+        struct stat st{};
+        // d_typeに対応しないファイルシステムでは、シンボリックリンクか否かから判定する。
+        if (type == DT_UNKNOWN && ::fstatat(dir_fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+            if (S_ISLNK(st.st_mode)) type = DT_LNK;
+            else if (S_ISDIR(st.st_mode)) type = DT_DIR;
+            else if (S_ISREG(st.st_mode)) type = DT_REG;
+        }
+        // シンボリックリンクは参照先が通常のファイルである場合のみ対象とする。
+        if (type == DT_LNK)
+            type = ::fstatat(dir_fd, entry->d_name, &st, 0) == 0 && S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+        add_entry(std::string(name), type == DT_REG, type == DT_DIR);
+    }
+    ::closedir(dir);
+#endif
+    return listing;
+}
+
+bool DirectoryScanner::matchAny(const std::vector<std::string>& patterns_, const std::string_view relative_)
+{
+    const size_t separator = relative_.rfind('/');
+    const std::string_view name = separator == std::string_view::npos ? relative_ : relative_.substr(separator + 1);
+    return std::ranges::any_of(patterns_, [&](const std::string& pattern_) {
+        return matchGlob(pattern_, pattern_.find('/') == std::string::npos ? name : relative_);
+    });
+}
+
+bool DirectoryScanner::matchGlob(const std::string_view pattern_, const std::string_view path_)
+{
+    size_t p = 0;
+    size_t s = 0;
+    while (p < pattern_.size()) {
+        if (pattern_[p] == '*') {
+            const bool any_depth = p + 1 < pattern_.size() && pattern_[p + 1] == '*';
+            const size_t rest = p + (any_depth ? 2 : 1);
+            // "**/"は0個のディレクトリにも一致する。
+            if (any_depth && rest < pattern_.size() && pattern_[rest] == '/' &&
+                matchGlob(pattern_.substr(rest + 1), path_.substr(s)))
+                return true;
+            for (size_t i = s; i <= path_.size(); ++i) {
+                if (matchGlob(pattern_.substr(rest), path_.substr(i))) return true;
+                if (i < path_.size() && !any_depth && path_[i] == '/') break;
+            }
+            return false;
+        }
+        if (s >= path_.size()) return false;
+        if (pattern_[p] == '?') {
+            if (path_[s] == '/') return false;
+            ++p;
+        }
+        else if (pattern_[p] == '[') {
+            size_t next = p;
+            if (const auto matched = matchClass(pattern_, next, path_[s])) {
+                if (!*matched) return false;
+                p = next;
+            }
+            // 閉じていない"["は文字として比較する。
+            else if (path_[s] == '[') { ++p; }
+            else { return false; }
+        }
+        else {
+            if (pattern_[p] == '\\' && p + 1 < pattern_.size()) ++p;
+            if (pattern_[p] != path_[s]) return false;
+            ++p;
+        }
+        ++s;
+    }
+    return s == path_.size();
+}
@@ -0,0 +1,91 @@
+/**
+ * @file DirectoryScanner.h
+ * @date 26/10/17
+ * @brief 入力ディレクトリの並列走査とglobによる絞り込み
+ * @details ディレクトリごとに1つのタスクとしてWorkerPoolで並列に走査します。
+ *          ファイルの種類はディレクトリエントリのd_typeから判定し、判定できない場合(シンボリックリンクや
+ *          d_typeに対応しないファイルシステム)のみstatを呼び出します。
+ *          シンボリックリンクのディレクトリはループを避けるため辿りません。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef DIRECTORYSCANNER_H
+#define DIRECTORYSCANNER_H
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class WorkerPool;
+
+
+class DirectoryScanner {
+public:
+    struct Options {
+        /// サブディレクトリも走査する。
+        bool recursive = false;
+        /// 対象とするファイルのglob。空の場合はすべてのファイルを対象とする。
+        std::vector<std::string> include;
+        /// 除外するファイル・ディレクトリのglob
+        std::vector<std::string> exclude;
+    };
+
+    struct Entry {
+        std::filesystem::path path;
+        /// ルートからの相対パス ("/"区切り)
+        std::string relative;
+    };
+
+    struct Result {
+        /// 見つかったファイル (relativeの順)
+        std::vector<Entry> files;
+        /// 走査したディレクトリ (ルートを含む)
+        std::vector<std::filesystem::path> directories;
+        /// 読み込めなかったディレクトリ
+        std::vector<std::filesystem::path> errors;
+    };
+
+    DirectoryScanner(std::filesystem::path root_, Options options_);
+
+    /**
+     * @brief ルートディレクトリを走査します。サブディレクトリはpoolで並列に走査します。
+     */
+    [[nodiscard]] Result scan(WorkerPool& pool_) const;
+
+    /**
+     * @brief globとパスを比較します。
+     * @details "*"と"?"は"/"以外の文字に、"**"は"/"を含む任意の文字列に一致します。
+     *          "/"が続く"**"は、0個以上のディレクトリに一致します。
+     *          "[abc]", "[a-z]", "[!a-z]"は文字クラス、"\"は次の文字をそのまま比較します。
+     */
+    static bool matchGlob(std::string_view pattern_, std::string_view path_);
+
+    DirectoryScanner() = delete;
+    DirectoryScanner(const DirectoryScanner&) = delete;
+    DirectoryScanner(DirectoryScanner&&) = delete;
+    DirectoryScanner& operator=(const DirectoryScanner&) = delete;
+    DirectoryScanner& operator=(DirectoryScanner&&) = delete;
+
+private:
+    /// 1つのディレクトリの走査結果
+    struct Listing {
+        std::vector<Entry> files;
+        /// 走査するサブディレクトリの相対パス
+        std::vector<std::string> directories;
+        bool failed = false;
+    };
+
+    [[nodiscard]] Listing list(const std::string& relative_) const;
+
+    /**
+     * @brief patternsのいずれかに一致するかを返します。
+     * @details "/"を含むパターンは相対パス全体と、含まないパターンは最後の要素(ファイル名)と比較します。
+     */
+    static bool matchAny(const std::vector<std::string>& patterns_, std::string_view relative_);
+
+    std::filesystem::path _root;
+    Options _options;
+};
+
+
+#endif //DIRECTORYSCANNER_H
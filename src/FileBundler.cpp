@@ -9,24 +9,73 @@
 #include "FileBundler.h"
 
 #include <algorithm>
+#include <chrono>
+#include <deque>
+#include <functional>
 #include <filesystem>
 #include <format>
 #include <fstream>
 #include <iostream>
-#include <iterator>
-#include <regex>
-#include <unordered_map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <map>
+#include <numeric>
+#include <optional>
+#include <queue>
+#include <ranges>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
 
-#include <net_ln3/cpp_lib/PrintHelper.h>
-
-#include "constants.h"
-
-const std::regex sign_replace_pattern("[^A-Z0-9_]");
-const std::regex space_replace_pattern(" ");
-const std::regex line_separator_pattern(R"((\r\n?)|\n)");
+#include "AssemblyBackend.h"
+#include "BundleCache.h"
+#include "BundleSink.h"
+#include "ByteEncoder.h"
+#include "CompressionRuntime.h"
+#include "DirectoryScanner.h"
+#include "FileList.h"
+#include "Hash.h"
+#include "InputFile.h"
+#include "InputPrefetcher.h"
+#include "IoStats.h"
+#include "Lz4.h"
+#include "Manifest.h"
+#include "OutputFile.h"
+#include "PackedLayout.h"
+#include "PhaseTimer.h"
+#include "ResourceIndex.h"
+#include "RunContext.h"
+#include "Trace.h"
+#include "Transform.h"
+#include "Watcher.h"
+#include "WorkerPool.h"
 
 namespace fs = std::filesystem;
-using ph = net_ln3::cpp_lib::PrintHelper;
+
+/// 1つのエンコードタスクが担当する入力の最大バイト数
+constexpr uintmax_t segment_size = 1024 * 1024;
+/// 分割出力の場合に生成する、ソースファイルの一覧のファイル名
+constexpr auto source_list_file_name = "resource_sources.cmake";
+/// 圧縮後のサイズが元のサイズのこの割合(7/8)以上となる場合は、展開の手間に見合わないため圧縮せずに格納する。
+constexpr uintmax_t min_compression_saving_divisor = 8;
+/// テキスト変換で1度に読み込む入力のバイト数
+constexpr size_t transform_chunk_size = 64 * 1024;
+/// テキスト変換の結果を書き込む、出力先ディレクトリ内のディレクトリ名
+constexpr auto transformed_dir_name = ".file-bundler-transformed";
+/// --watchで、変更が途切れてから再出力するまでの時間 (保存や一括コピーによる連続した変更を1回にまとめる。)
+constexpr std::chrono::milliseconds watch_debounce{200};
+/// 先読みの対象とする入力ファイルの最大バイト数 (これより大きいファイルは、従来どおりメモリマップで読み込む。)
+constexpr uintmax_t prefetch_file_size = 8 * 1024;
+/// 状態の取得や先読みをまとめて行う最小のファイル数 (少ない場合は、リングやスレッドの準備に見合わない。)
+constexpr size_t min_prefetch_files = 16;
+/// 先読みで読み込み中・読み込み済みとするファイルの数とバイト数の上限
+constexpr size_t prefetch_window_files = 1024;
+constexpr uintmax_t prefetch_window_bytes = 64 * 1024 * 1024;
+/// ファイルリストなどで指定されたファイルの定数名を生成する、1つのタスクが担当するファイル数
+constexpr size_t constant_name_chunk_size = 4096;
+/// 共有キャッシュに記録する処理結果の種類に加える、CRC32Cを計算したことを表すビット
+constexpr int crc_segment_kind = 0x100;
 
 bool confirmPrompt(const std::string& message_, const std::string& yes_message_, const std::string& no_message_,
                    const bool yes_)
@@ -49,239 +98,1803 @@ bool confirmPrompt(const std::string& message_, const std::string& yes_message_,
     }
 }
 
+/**
+ * @brief 名前の一部を定数名に使用できる文字にしてresultへ追加します。
+ * @details 英小文字は大文字に、空白は"_"にし、英大文字・数字・"_"以外は取り除きます。
+ *          ファイル数に比例して呼び出されるため、正規表現やロケールに依存せず1文字ずつ変換します。
+ */
+void appendConstantNameChars(std::string& result, const std::string_view name)
+{
+    for (const char c : name) {
+        if (c >= 'a' && c <= 'z') result += static_cast<char>(c - 'a' + 'A');
+        else if (c == ' ') result += '_';
+        else if ((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_') result += c;
+    }
+}
+
+/**
+ * @brief ファイル名を定数名にします。
+ * @details 拡張子の前に"_"を置くため、"logo.png"はLOGO_PNGになります。
+ *          拡張子の区切りはstd::filesystem::path::stem()・extension()と同じく最後の"."とし、
+ *          先頭の"."と"."・".."は拡張子の区切りとしません。
+ */
+std::string convertFileNameToConstantName(const std::string_view filename)
+{
+    size_t separator = filename == "." || filename == ".." ? std::string_view::npos : filename.rfind('.');
+    if (separator == 0) separator = std::string_view::npos;
+    std::string result;
+    result.reserve(filename.size() + 1);
+    appendConstantNameChars(result, filename.substr(0, separator));
+    result += '_';
+    if (separator != std::string_view::npos) appendConstantNameChars(result, filename.substr(separator));
+    return result;
+}
+
 std::string convertFilePathToConstantName(const fs::path& file_path)
 {
-    std::string filename = file_path.stem().generic_string();
-    std::string extension = file_path.extension().generic_string();
-    std::string result = std::format("{}_{}", filename, extension);
-    std::ranges::transform(result, result.begin(), toupper);
-    result = std::regex_replace(result, space_replace_pattern, "_");
-    result = std::regex_replace(result, sign_replace_pattern, "");
+    return convertFileNameToConstantName(file_path.filename().generic_string());
+}
+
+/**
+ * @brief 入力ディレクトリからの相対パスを定数名にします。
+ * @details サブディレクトリの名前を"_"で連結してファイル名の定数名の前に付けるため、
+ *          "a/logo.png"と"b/logo.png"はそれぞれA_LOGO_PNG、B_LOGO_PNGになります。
+ */
+std::string convertRelativePathToConstantName(const fs::path& relative_path)
+{
+    std::string result;
+    for (const auto& component : relative_path.parent_path()) {
+        appendConstantNameChars(result, component.generic_string());
+        result += '_';
+    }
+    return result + convertFilePathToConstantName(relative_path);
+}
+
+/// ファイルの親ディレクトリ (親を含まない相対パスの場合はカレントディレクトリ)
+fs::path parentDirectory(const fs::path& path)
+{
+    const fs::path parent = path.parent_path();
+    return parent.empty() ? fs::path(".") : parent;
+}
+
+/// データ部分として読み込む入力
+struct InputSource {
+    fs::path path;
+    /// メモリ上の入力(ライブラリとして渡された内容やテキスト変換の結果)の場合の内容
+    std::optional<std::string_view> data;
+};
+
+/**
+ * @brief 入力を開きます。メモリ上の入力は常に開けます。
+ */
+bool openSource(InputFile& input_, const InputSource& source_)
+{
+    if (!source_.data) return input_.open(source_.path);
+    input_.openMemory(*source_.data);
+    return true;
+}
+
+/**
+ * @brief 先読みした内容を入力とする間、その内容を保持します。
+ * @details 内容はsource()を最初に呼び出した時点で取得し、先読みされていなければ元の入力を返します。
+ *          先読みの対象であれば、取得の有無にかかわらず破棄時に解放します。
+ */
+class PrefetchedInput {
+public:
+    /// 先読みの対象でないことを表すslot
+    static constexpr size_t NONE = static_cast<size_t>(-1);
+
+    PrefetchedInput(InputPrefetcher* prefetcher_, const size_t slot_, const InputSource& source_)
+        : _prefetcher(slot_ == NONE ? nullptr : prefetcher_), _slot(slot_), _source(&source_)
+    {
+    }
+
+    ~PrefetchedInput() { if (_prefetcher) _prefetcher->release(_slot); }
+
+    const InputSource& source()
+    {
+        if (_prefetcher && !_acquired) {
+            _acquired = true;
+            if (const auto data = _prefetcher->acquire(_slot)) {
+                _prefetched = {_source->path, data};
+                _source = &_prefetched;
+            }
+        }
+        return *_source;
+    }
+
+    PrefetchedInput(const PrefetchedInput&) = delete;
+    PrefetchedInput(PrefetchedInput&&) = delete;
+    PrefetchedInput& operator=(const PrefetchedInput&) = delete;
+    PrefetchedInput& operator=(PrefetchedInput&&) = delete;
+
+private:
+    InputPrefetcher* _prefetcher;
+    size_t _slot;
+    const InputSource* _source;
+    InputSource _prefetched;
+    bool _acquired = false;
+};
+
+/**
+ * @brief 入力ファイルの状態の取得と読み込みに用いる方式を返します。先読みしない場合はstd::nullopt
+ */
+std::optional<InputPrefetcher::Backend> toPrefetchBackend(const FileBundler::InputEngine engine_)
+{
+    switch (engine_) {
+    case FileBundler::InputEngine::AUTO:
+        return InputPrefetcher::Backend::IO_URING;
+    case FileBundler::InputEngine::THREADS:
+        return InputPrefetcher::Backend::THREADS;
+    default:
+        return std::nullopt;
+    }
+}
+
+/// --statsで表示する先読みの方式の名前
+const char* prefetchBackendName(const InputPrefetcher::Backend backend_)
+{
+    return backend_ == InputPrefetcher::Backend::IO_URING ? "io_uring" : "threads";
+}
+
+/// エンコード済みのセグメント
+struct EncodedSegment {
+    /// 書き込む内容。bufferまたはsourceのマップを参照します。
+    std::string_view text;
+    /// セグメントの入力のXXH64
+    uint64_t hash = 0;
+    /// セグメントの入力のCRC32C (--hashを指定した場合のみ計算します。)
+    uint32_t crc = 0;
+    /// セグメントの入力のバイト数
+    size_t length = 0;
+    std::unique_ptr<char[]> buffer;
+    /// 入力をそのまま書き込む場合に、textが参照する範囲を保持するファイル
+    std::unique_ptr<InputFile> source;
+    /// 共有キャッシュから取得した場合に、textが参照する内容
+    std::shared_ptr<const char[]> cached;
+};
+
+/**
+ * @brief ファイル全体の内容ハッシュにセグメントのハッシュを加えます。
+ * @details ファイルの内容ハッシュは、セグメントごとのXXH64を先頭から順にリトルエンディアンで並べた列のXXH64です。
+ *          セグメント単位で並列に計算できるよう、ファイル全体を直接ハッシュすることはしません。
+ */
+void addSegmentHash(Xxh64& content_hash_, const uint64_t segment_hash_)
+{
+    unsigned char bytes[8];
+    for (int i = 0; i < 8; ++i) bytes[i] = static_cast<unsigned char>(segment_hash_ >> (i * 8));
+    content_hash_.update(bytes, sizeof(bytes));
+}
+
+/**
+ * @brief 書き込むファイルの内容ハッシュとCRC32Cを、受け取ったセグメントから順に求めます。
+ * @details CRC32Cはセグメントごとの値を結合するため、ファイル全体を直接計算した値と一致します。
+ */
+struct ContentDigest {
+    Xxh64 hash;
+    uint32_t crc = 0;
+
+    void add(const EncodedSegment& segment_)
+    {
+        addSegmentHash(hash, segment_.hash);
+        crc = Crc32c::combine(crc, segment_.crc, segment_.length);
+    }
+};
+
+/**
+ * @brief ファイルのoffsetからlengthバイトを取得します。
+ * @details 通常のファイルはメモリマップした範囲を返すため、返す範囲はinputを閉じるまで有効です。
+ * @throw std::runtime_error ファイルが開けないか、lengthバイトを読み込めなかった場合
+ */
+std::string_view readSegment(InputFile& input_, const InputSource& source_, const uintmax_t offset_,
+                             const size_t length_)
+{
+    if (!openSource(input_, source_))
+        throw std::runtime_error(std::format("\"{}\"を開けませんでした。", source_.path.generic_string()));
+    const std::string_view data = input_.read(offset_, length_);
+    if (data.size() != length_) {
+        throw std::runtime_error(std::format("\"{}\"の読み込み中にファイルが終端に達しました。",
+                                             source_.path.generic_string()));
+    }
+    return data;
+}
+
+/**
+ * @brief ファイルのoffsetからlengthバイトを読み込み、配列初期化子の文字列に変換します。
+ * @details offsetが0でない場合は、先頭に区切り文字を付けて前のセグメントに続けられる形で返します。
+ *          入力はマップした範囲から直接エンコードし、中間のバッファへ複製しません。
+ * @param crc_ trueの場合、入力のCRC32Cも計算する。
+ * @throw std::runtime_error ファイルが開けないか、lengthバイトを読み込めなかった場合
+ */
+EncodedSegment encodeSegment(const InputSource& source_, const uintmax_t offset_, const size_t length_,
+                             const ByteEncoder::Format format_, const bool crc_)
+{
+    InputFile input;
+    const std::string_view data = readSegment(input, source_, offset_, length_);
+    EncodedSegment result;
+    result.buffer = std::make_unique_for_overwrite<char[]>(ByteEncoder::requiredBufferSize(length_));
+    const size_t written = ByteEncoder::encode(format_, data.data(), data.size(), result.buffer.get());
+    // 先頭のセグメントでは、先頭の", "を省略する。
+    const size_t skip = offset_ != 0 || format_ == ByteEncoder::Format::STRING || written == 0 ? 0 : 2;
+    result.text = {result.buffer.get() + skip, written - skip};
+    result.hash = Xxh64::hash(data.data(), data.size());
+    if (crc_) result.crc = Crc32c::hash(data.data(), data.size());
+    return result;
+}
+
+/**
+ * @brief ファイルのoffsetからlengthバイトのXXH64と、crcがtrueの場合はCRC32Cを計算します。(書き込む内容は空)
+ */
+EncodedSegment hashSegment(const InputSource& source_, const uintmax_t offset_, const size_t length_, const bool crc_)
+{
+    InputFile input;
+    const std::string_view data = readSegment(input, source_, offset_, length_);
+    EncodedSegment result;
+    result.hash = Xxh64::hash(data.data(), data.size());
+    if (crc_) result.crc = Crc32c::hash(data.data(), data.size());
     return result;
 }
 
-std::string stripLn(const std::string& str) { return std::regex_replace(str, line_separator_pattern, ""); }
+/**
+ * @brief ファイルのoffsetからlengthバイトを、複製せずにそのまま書き込む内容とします。
+ */
+EncodedSegment copySegment(const InputSource& source_, const uintmax_t offset_, const size_t length_)
+{
+    EncodedSegment result;
+    result.source = std::make_unique<InputFile>();
+    result.text = readSegment(*result.source, source_, offset_, length_);
+    return result;
+}
+
+/**
+ * @brief ファイルのoffsetからlengthバイトを読み込み、LZ4のブロックとして圧縮します。
+ * @details セグメントごとに独立したブロックとするため、並列に圧縮できます。
+ * @param crc_ trueの場合、入力のCRC32Cも計算する。
+ */
+EncodedSegment compressSegment(const InputSource& source_, const uintmax_t offset_, const size_t length_,
+                               const bool crc_)
+{
+    InputFile input;
+    const std::string_view data = readSegment(input, source_, offset_, length_);
+    EncodedSegment result;
+    result.buffer = std::make_unique_for_overwrite<char[]>(Lz4::BLOCK_HEADER_SIZE + Lz4::compressBound(length_));
+    result.text = {result.buffer.get(), Lz4::writeBlock(data.data(), data.size(), result.buffer.get())};
+    result.hash = Xxh64::hash(data.data(), data.size());
+    if (crc_) result.crc = Crc32c::hash(data.data(), data.size());
+    return result;
+}
+
+/**
+ * @brief ファイルの内容ハッシュを計算します。(addSegmentHashを参照)
+ */
+uint64_t hashFile(const InputSource& source_, const uintmax_t size_, const std::string& name_)
+{
+    Trace::Span span("hash_file", name_);
+    span.setBytes(size_, 0);
+    Xxh64 content_hash;
+    InputFile input;
+    if (!openSource(input, source_))
+        throw std::runtime_error(std::format("\"{}\"を開けませんでした。", source_.path.generic_string()));
+    for (uintmax_t offset = 0; offset < size_; offset += segment_size) {
+        const auto length = static_cast<size_t>(std::min<uintmax_t>(segment_size, size_ - offset));
+        const std::string_view data = input.read(offset, length);
+        if (data.size() != length) {
+            throw std::runtime_error(std::format("\"{}\"の読み込み中にファイルが終端に達しました。",
+                                                 source_.path.generic_string()));
+        }
+        addSegmentHash(content_hash, Xxh64::hash(data.data(), data.size()));
+    }
+    return content_hash.digest();
+}
+
+/**
+ * @brief 2つの入力の先頭sizeバイトが一致するかを返します。開けない・読み込めない場合はfalseを返します。
+ * @details 内容ハッシュは衝突し得るため、ハッシュが一致した入力を別名とする前に内容を比較します。
+ */
+bool isSameContent(const InputSource& original_, const InputSource& source_, const uintmax_t size_,
+                   const std::string& name_)
+{
+    Trace::Span span("compare_file", name_);
+    span.setBytes(size_, 0);
+    InputFile original;
+    InputFile input;
+    if (!openSource(original, original_) || !openSource(input, source_)) return false;
+    for (uintmax_t offset = 0; offset < size_; offset += segment_size) {
+        const auto length = static_cast<size_t>(std::min<uintmax_t>(segment_size, size_ - offset));
+        const std::string_view data = input.read(offset, length);
+        if (data.size() != length || original.read(offset, length) != data) return false;
+    }
+    return true;
+}
+
+ByteEncoder::Format toEncoderFormat(const FileBundler::Format format_)
+{
+    switch (format_) {
+    case FileBundler::Format::HEX:
+        return ByteEncoder::Format::HEX;
+    case FileBundler::Format::STRING:
+        return ByteEncoder::Format::STRING;
+    default:
+        return ByteEncoder::Format::DECIMAL;
+    }
+}
+
+/**
+ * @brief ファイルが圧縮の対象であるかを返します。
+ * @param extensions_ 圧縮の対象とする拡張子 (小文字、"."を含まない)
+ */
+bool isCompressTarget(const fs::path& path_, const bool all_, const std::set<std::string>& extensions_)
+{
+    if (all_) return true;
+    std::string extension = path_.extension().generic_string();
+    if (extension.empty()) return false;
+    extension.erase(0, 1);
+    std::ranges::transform(extension, extension.begin(), tolower);
+    return extensions_.contains(extension);
+}
+
+/**
+ * @brief ファイルに行うテキスト変換を返します。
+ * @param transforms_ 拡張子(小文字、"."を含まない)ごとのテキスト変換
+ * @param default_ transformsに含まれない拡張子のファイルに行うテキスト変換
+ */
+FileBundler::TextTransform selectTransform(const fs::path& path_,
+                                           const std::map<std::string, FileBundler::TextTransform>& transforms_,
+                                           const FileBundler::TextTransform default_)
+{
+    std::string extension = path_.extension().generic_string();
+    if (!extension.empty()) extension.erase(0, 1);
+    std::ranges::transform(extension, extension.begin(), tolower);
+    const auto it = transforms_.find(extension);
+    return it != transforms_.end() ? it->second : default_;
+}
+
+Transform::Kind toTransformKind(const FileBundler::TextTransform transform_)
+{
+    switch (transform_) {
+    case FileBundler::TextTransform::COMMENTS:
+        return Transform::Kind::COMMENTS;
+    case FileBundler::TextTransform::JSON:
+        return Transform::Kind::JSON;
+    case FileBundler::TextTransform::GLSL:
+        return Transform::Kind::GLSL;
+    default:
+        return Transform::Kind::BLOCK_COMMENT;
+    }
+}
+
+/**
+ * @brief 入力をテキスト変換し、outputに書き込みます。
+ * @details 入力はtransform_chunk_sizeバイトずつ変換して書き込むため、入力全体を複製しません。
+ * @return 入力と出力のバイト数
+ * @throw std::runtime_error 入力が開けなかった場合
+ */
+std::pair<uintmax_t, uintmax_t> transformStream(const InputSource& source_, const Transform::Kind kind_,
+                                                std::ostream& output_)
+{
+    InputFile input;
+    if (!openSource(input, source_))
+        throw std::runtime_error(std::format("\"{}\"を開けませんでした。", source_.path.generic_string()));
+    const std::unique_ptr<Transform> transform = Transform::create(kind_);
+    std::string transformed;
+    uintmax_t offset = 0;
+    uintmax_t written = 0;
+    for (bool last = false; !last;) {
+        const std::string_view chunk = input.read(offset, transform_chunk_size);
+        offset += chunk.size();
+        last = chunk.size() < transform_chunk_size;
+        transformed.clear();
+        transform->process(chunk, transformed);
+        if (last) transform->finish(transformed);
+        output_.write(transformed.data(), static_cast<std::streamsize>(transformed.size()));
+        written += transformed.size();
+    }
+    return {offset, written};
+}
+
+/**
+ * @brief 入力をテキスト変換し、output_pathに書き込みます。
+ * @details output_pathは内容が変化した場合のみ更新されるため、更新日時による前回の出力の再利用が機能します。
+ * @throw std::runtime_error 入力が開けないか、書き込みに失敗した場合
+ */
+void transformFile(const InputSource& source_, const fs::path& output_path_, const Transform::Kind kind_,
+                   const std::string& name_)
+{
+    Trace::Span span("transform_file", name_);
+    OutputFile output(output_path_);
+    if (!output.open())
+        throw std::runtime_error(std::format("\"{}\"を開けませんでした。", output_path_.generic_string()));
+    const auto [read, written] = transformStream(source_, kind_, output.stream());
+    if (!output.commit())
+        throw std::runtime_error(std::format("\"{}\"に書き込めませんでした。", output_path_.generic_string()));
+    span.setBytes(read, written);
+}
+
+/**
+ * @brief 入力をテキスト変換した結果を返します。出力先がファイルでない場合に用います。
+ * @throw std::runtime_error 入力が開けなかった場合
+ */
+std::string transformToMemory(const InputSource& source_, const Transform::Kind kind_, const std::string& name_)
+{
+    Trace::Span span("transform_file", name_);
+    std::ostringstream output;
+    const auto [read, written] = transformStream(source_, kind_, output);
+    span.setBytes(read, written);
+    return std::move(output).str();
+}
+
+/// データ部分を書き込む出力ファイルと、そこに書き込むファイル(resourcesの添字)
+struct OutputUnit {
+    std::string file_name;
+    std::vector<size_t> resources;
+};
+
+/**
+ * @brief ファイルをサイズの合計がなるべく均等になるようshard_count個の出力ファイルに振り分けます。
+ * @details サイズの大きいファイルから順に、その時点で合計が最も小さい出力ファイルへ割り当てます。
+ *          各出力ファイル内のファイルは添字の順(定数名の順)に並べます。
+ */
+std::vector<OutputUnit> balanceShards(const std::vector<uintmax_t>& sizes_, const unsigned shard_count_,
+                                      const std::string& extension_)
+{
+    std::vector<OutputUnit> units(shard_count_);
+    for (unsigned i = 0; i < shard_count_; ++i) units[i].file_name = std::format("resource_{}.{}", i, extension_);
+
+    std::vector<size_t> order(sizes_.size());
+    std::iota(order.begin(), order.end(), size_t{0});
+    // サイズが同じ場合は添字の順とし、実行ごとに同じ割り当てになるようにする。
+    std::ranges::stable_sort(order, std::greater{}, [&](const size_t i_) { return sizes_[i_]; });
+    // (合計サイズ, 出力ファイルの番号)の最小ヒープ
+    using Load = std::pair<uintmax_t, unsigned>;
+    std::priority_queue<Load, std::vector<Load>, std::greater<>> loads;
+    for (unsigned i = 0; i < shard_count_; ++i) loads.emplace(0, i);
+    for (const size_t index : order) {
+        auto [load, shard] = loads.top();
+        loads.pop();
+        units[shard].resources.push_back(index);
+        loads.emplace(load + sizes_[index], shard);
+    }
+    for (auto& unit : units) std::ranges::sort(unit.resources);
+    return units;
+}
+
+/**
+ * @brief 出力先ディレクトリから、このツールが以前に生成したソースファイルのうちkeepに含まれないものを削除します。
+ * @details 先頭行が生成時のコメントであるファイルのみを対象とし、利用者が作成したファイルは削除しません。
+ */
+void removeStaleOutputs(const fs::path& output_dir_, const std::set<std::string>& keep_)
+{
+    std::error_code ec;
+    for (const fs::directory_iterator it(output_dir_, ec); const auto& i : it) {
+        if (!i.is_regular_file(ec)) continue;
+        const std::string name = i.path().filename().generic_string();
+        const bool is_source = name.starts_with("resource") && (name.ends_with(".c") || name.ends_with(".S"));
+        if (!(is_source || name == source_list_file_name) || keep_.contains(name)) continue;
+        std::ifstream ifs(i.path(), std::ios::binary);
+        std::string first_line;
+        std::getline(ifs, first_line);
+        ifs.close();
+        if (first_line.ends_with("This file is auto generated. by net.ln3.file-bundler"))
+            fs::remove(i.path(), ec);
+    }
+}
+
+/**
+ * @brief テキスト変換後のファイルを格納するディレクトリから、keepに含まれないファイルを削除します。
+ * @details ディレクトリが空になった場合はディレクトリも削除します。
+ */
+void removeStaleTransformed(const fs::path& transformed_dir_, const std::set<std::string>& keep_)
+{
+    std::error_code ec;
+    if (!fs::is_directory(transformed_dir_, ec)) return;
+    for (const fs::directory_iterator it(transformed_dir_, ec); const auto& i : it) {
+        if (!keep_.contains(i.path().filename().generic_string())) fs::remove(i.path(), ec);
+    }
+    if (fs::is_empty(transformed_dir_, ec)) fs::remove(transformed_dir_, ec);
+}
+
+/**
+ * @brief 定義をソースファイルに書き込む必要がある設定(分割出力、アセンブリソース、圧縮)かを返します。
+ * @details 圧縮の展開処理とアクセサは外部リンケージを持つため、ヘッダファイルに定義すると
+ *          複数の翻訳単位から読み込めなくなります。
+ */
+bool requiresSourceFile(const FileBundler::Parameters& parameters_)
+{
+    // 連結して出力する場合は、分割出力と圧縮を行わない。
+    if (parameters_.pack_alignment > 0) return parameters_.backend == FileBundler::Backend::ASSEMBLY;
+    const bool sharded = parameters_.shard_per_file || parameters_.shard_count > 0;
+    const bool compressed = parameters_.format != FileBundler::Format::EMBED &&
+        (parameters_.compress_all || !parameters_.compress_extensions.empty());
+    return sharded || compressed || parameters_.backend == FileBundler::Backend::ASSEMBLY;
+}
 
 FileBundler::FileBundler(std::string input_dir_, std::string output_dir_, std::string filelist_path_,
-                         const int option_)
+                         const int option_, const Parameters& parameters_)
     : _input_dir(std::move(input_dir_)), _output_dir(std::move(output_dir_)),
-      _filelist_path(std::move(filelist_path_)), _header_only(option_ & Options::HEADER_ONLY),
+      _filelist_path(std::move(filelist_path_)),
+      _header_only((option_ & Options::HEADER_ONLY) && !requiresSourceFile(parameters_)),
       _declare_only(option_ & Options::DECLARE_ONLY),
-      _all_yes(option_ & Options::ALL_YES)
+      _all_yes(option_ & Options::ALL_YES),
+      _incremental(option_ & Options::INCREMENTAL),
+      _stats(option_ & Options::STATS),
+      _index(option_ & Options::INDEX),
+      _recursive(option_ & Options::RECURSIVE),
+      _hash(option_ & Options::HASH),
+      _jobs(parameters_.jobs),
+      // 連結して出力する場合は、分割出力と圧縮を行わない。
+      _shard_count(parameters_.pack_alignment > 0 ? 0 : parameters_.shard_count),
+      _shard_per_file(parameters_.pack_alignment == 0 && parameters_.shard_per_file),
+      _backend(parameters_.backend),
+      _format(parameters_.format),
+      _compress_all(parameters_.pack_alignment == 0 && parameters_.compress_all),
+      _compress_extensions(parameters_.pack_alignment > 0 ? std::set<std::string>{} : parameters_.compress_extensions),
+      _trace_path(parameters_.trace_path),
+      _include_patterns(parameters_.include_patterns),
+      _exclude_patterns(parameters_.exclude_patterns),
+      _pack_alignment(parameters_.pack_alignment),
+      _transforms(parameters_.transforms),
+      _default_transform(parameters_.default_transform),
+      _cache(parameters_.cache),
+      _input_engine(parameters_.input_engine)
+{
+}
+
+FileBundler::FileBundler(const int option_, const Parameters& parameters_)
+    : FileBundler("", "", "", option_, parameters_)
 {
 }
 
 int FileBundler::bundle() const
 {
-    // バンドル対象ファイルの指定モード
-    int bundle_target_mode = 0;
-    // 有効なパスかを確認し、それが有効なパスであればモードに追加する。
-    if (fs::is_regular_file(_filelist_path))
-        bundle_target_mode |= 0b01; // filelist id: 1
-    if (fs::is_directory(_input_dir))
-        bundle_target_mode |= 0b10; // input_dir id: 2
-    if (bundle_target_mode == 0) {
-        std::cout << ph::Color("エラー", ERROR_COLOR) << ": バンドル対象が指定されていません。" << std::endl;
-        return 1;
+    const Inputs inputs;
+    FileSink sink(_output_dir);
+    Diagnostics diagnostics(true);
+    RunStats stats;
+    Registry registry;
+    return execute(stats, registry, {inputs, sink, diagnostics, _cache}, false, true);
+}
+
+FileBundler::Result FileBundler::bundle(const Inputs& inputs_, BundleSink& sink_) const
+{
+    Diagnostics diagnostics(false);
+    RunStats stats;
+    Registry registry;
+    Result result;
+    result.code = execute(stats, registry, {inputs_, sink_, diagnostics, _cache}, false, false);
+    result.diagnostics = diagnostics.take();
+    result.phase_seconds = std::move(stats.phase_seconds);
+    result.io_counters = std::move(stats.io_counters);
+    return result;
+}
+
+int FileBundler::watch() const
+{
+    const Inputs inputs;
+    FileSink sink(_output_dir);
+    Diagnostics diagnostics(true);
+    // 監視中は入力が変更されるため、共有キャッシュは用いない。
+    const Session session{inputs, sink, diagnostics, nullptr};
+    Watcher watcher;
+    if (!watcher.valid()) return diagnostics.error(11, "この環境ではファイルの変更を監視できません。");
+    Registry registry;
+    RunStats initial;
+    if (const int result = execute(initial, registry, session, false, true); result != 0 || initial.cancelled)
+        return result;
+    const fs::path filelist_path = fs::path(_filelist_path).lexically_normal();
+    bool registered = true;
+    while (true) {
+        std::vector<fs::path> directories = registry.scanned_directories;
+        directories.insert(directories.end(), registry.listed_directories.begin(), registry.listed_directories.end());
+        watcher.setDirectories(directories);
+        std::set<fs::path> registered_paths;
+        for (const auto& path : registry.files | std::views::values) registered_paths.insert(path.lexically_normal());
+        std::set<fs::path> scanned_directories;
+        for (const auto& directory : registry.scanned_directories)
+            scanned_directories.insert(directory.lexically_normal());
+        diagnostics.info("入力の変更を監視しています。(Ctrl+Cで終了します。)");
+
+        // 登録したファイルの変更と、登録に影響する変更(入力ディレクトリ内のファイルの作成・削除、ファイルリストの変更)を待つ。
+        // 監視するディレクトリ内のその他のファイル(出力や除外したファイル)の変更は無視する。
+        std::set<fs::path> changed;
+        while (changed.empty()) {
+            std::vector<Watcher::Event> events;
+            if (!watcher.wait(watch_debounce, events))
+                return diagnostics.error(11, "ファイルの変更を読み込めませんでした。");
+            for (const auto& event : events) {
+                const fs::path path = event.path.lexically_normal();
+                const bool structural = event.path.empty() || (!filelist_path.empty() && path == filelist_path) ||
+                    (event.structural && (registered_paths.contains(path) || scanned_directories.contains(path) ||
+                        scanned_directories.contains(path.parent_path())));
+                if (!structural && !registered_paths.contains(path)) continue;
+                registered = registered && !structural;
+                changed.insert(path);
+            }
+        }
+
+        diagnostics.info(std::format("{}個のファイルの変更を検出しました。再出力します。", changed.size()));
+        const auto start = std::chrono::steady_clock::now();
+        RunStats stats;
+        // ファイルの作成・削除がない場合は、前回登録したファイルをそのまま用いる。
+        if (const int result = execute(stats, registry, session, registered, false); result != 0) {
+            diagnostics.warning("再出力に失敗しました。次の変更で再度出力します。");
+            registered = false;
+            continue;
+        }
+        registered = true;
+        diagnostics.info(std::format("再出力しました。({:.3f}秒)",
+                                     std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()));
     }
-    // ディレクトリが作成できず、ディレクトリが存在しない場合
-    if (!fs::create_directories(_output_dir) && !fs::is_directory(_output_dir)) {
-        std::cout << ph::Color("エラー", ERROR_COLOR) << ": 指定されたパスはディレクトリでないか作成に失敗しました。" << std::endl;
-        return 2;
+}
+
+std::vector<fs::path> FileBundler::inputPaths() const
+{
+    const Inputs inputs;
+    MemorySink sink;
+    Diagnostics diagnostics(false);
+    std::optional<WorkerPool> owned_pool;
+    WorkerPool& pool = _cache ? _cache->pool() : owned_pool.emplace(_jobs);
+    Registry registry;
+    registerFiles(pool, bundleTargetMode(), {inputs, sink, diagnostics, _cache}, registry);
+    std::vector<fs::path> paths;
+    paths.reserve(registry.files.size());
+    for (const auto& path : registry.files | std::views::values) paths.push_back(path);
+    return paths;
+}
+
+int FileBundler::execute(RunStats& stats_, Registry& registry_, const Session& session_, const bool registered_,
+                         const bool prompt_) const
+{
+    // 集計と記録は呼び出しごとに行い、run()から登録したタスクと先読みのスレッドにもRunContextで引き継ぐ。
+    IoStats io_stats;
+    PhaseTimer phase_timer;
+    std::optional<Trace> trace;
+    if (!_trace_path.empty()) trace.emplace();
+    int result;
+    {
+        const RunContext::Scope scope({&io_stats, &phase_timer, trace ? &*trace : nullptr});
+        result = run(stats_, registry_, session_, registered_, prompt_);
+    }
+    if (trace && !trace->write(_trace_path))
+        session_.diagnostics.warning(std::format("トレースを\"{}\"に書き込めませんでした。", _trace_path), _trace_path);
+    for (size_t i = 0; i < static_cast<size_t>(PhaseTimer::Phase::COUNT); ++i)
+        stats_.phase_seconds.push_back(phase_timer.seconds(static_cast<PhaseTimer::Phase>(i)));
+    for (size_t i = 0; i < static_cast<size_t>(IoStats::Counter::COUNT); ++i)
+        stats_.io_counters.push_back(io_stats.get(static_cast<IoStats::Counter>(i)));
+    if (_stats && result == 0 && !stats_.cancelled) {
+        std::string stats = formatStats(stats_, io_stats, phase_timer);
+        // 報告は行ごとに表示されるため、末尾の改行を除く。
+        if (stats.ends_with('\n')) stats.pop_back();
+        session_.diagnostics.info(std::move(stats));
     }
+    return result;
+}
 
-    //
-    // バンドル対象のファイルを登録する
-    //
+std::string FileBundler::formatStats(const RunStats& stats_, const IoStats& io_stats_, const PhaseTimer& phase_timer_)
+{
+    // 処理段階は排他的に計測しているため、合計がrun()の所要時間となる。
+    double total = 0;
+    std::string phases;
+    for (size_t i = 0; i < static_cast<size_t>(PhaseTimer::Phase::COUNT); ++i) {
+        const auto phase = static_cast<PhaseTimer::Phase>(i);
+        total += phase_timer_.seconds(phase);
+        phases += std::format("{}{} {:.3f}s", i == 0 ? "" : ", ", PhaseTimer::name(phase), phase_timer_.seconds(phase));
+    }
+    const double input_mb = static_cast<double>(stats_.input_bytes) / (1024.0 * 1024.0);
+    std::string result = io_stats_.report(stats_.input_bytes);
+    result += std::format("処理段階: {}\n", phases);
+    if (!stats_.prefetch_backend.empty())
+        result += std::format("先読み: {} (延べ{}ファイル)\n", stats_.prefetch_backend, stats_.prefetched_files);
+    result += std::format("合計: {:.3f}s ({:.2f} MB/s, {:.1f} files/s)\n", total, total > 0 ? input_mb / total : 0.0,
+                          total > 0 ? static_cast<double>(stats_.file_count) / total : 0.0);
 
-    // ファイルから登録
-    std::unordered_map<std::string, fs::path> files;
-    if (bundle_target_mode & 0b01) {
-        if (std::ifstream ifs(_filelist_path); ifs) {
-            while (!ifs.eof()) {
-                std::string line;
-                std::getline(ifs, line);
-                line = stripLn(line);
-                const fs::path file_path(line);
-                if (line.empty()) continue;
-                if (!is_regular_file(file_path)) {
-                    std::cout << ph::Color("警告", WARN_COLOR) << ": \"" <<
-                        file_path.generic_string() <<
-                        "\"はファイルではないか存在しないため無視されます。" << std::endl;
-                    continue;
-                }
-                std::string filename = convertFilePathToConstantName(file_path);
-                if (files.contains(filename)) {
-                    std::cout << ph::Color("警告", WARN_COLOR) << ": \"" <<
-                        file_path.generic_string() << "\"は同じファイル名のファイルがすでに存在しているため無視されます。" << std::endl;
-                    continue;
-                }
-                files.try_emplace(filename, file_path);
-            }
+    // 書き込みに時間のかかったファイルを表示する。
+    constexpr size_t max_listed_files = 10;
+    std::vector<const FileStats*> files;
+    files.reserve(stats_.files.size());
+    for (const auto& file : stats_.files) files.push_back(&file);
+    const size_t listed = std::min(max_listed_files, files.size());
+    std::ranges::partial_sort(files, files.begin() + static_cast<std::ptrdiff_t>(listed), std::ranges::greater{},
+                              &FileStats::seconds);
+    if (listed > 0) result += std::format("時間のかかったファイル (上位{}件):\n", listed);
+    for (size_t i = 0; i < listed; ++i) {
+        const FileStats& file = *files[i];
+        result += std::format("    {}: 入力 {} バイト, 出力 {} バイト, {:.3f}s ({:.2f} MB/s)\n", file.name, file.bytes_in,
+                              file.bytes_out, file.seconds,
+                              file.seconds > 0
+                                  ? static_cast<double>(file.bytes_in) / (1024.0 * 1024.0) / file.seconds
+                                  : 0.0);
+    }
+    return result;
+}
+
+void FileBundler::registerFiles(WorkerPool& pool_, const int bundle_target_mode_, const Session& session_,
+                                Registry& registry_) const
+{
+    Diagnostics& diagnostics = session_.diagnostics;
+    std::map<std::string, fs::path>& files = registry_.files;
+    // ファイルリストと引数で指定されたファイルは、状態の取得と定数名の生成をまとめて並列に行ってから、
+    // 指定された順に登録する。(同じ定数名のファイルは、指定された順で最初のファイルを登録する。)
+    std::vector<fs::path> listed_files;
+    if (bundle_target_mode_ & 0b01) {
+        registry_.listed_directories.push_back(parentDirectory(_filelist_path));
+        if (FileList filelist; filelist.load(_filelist_path)) {
+            listed_files.reserve(filelist.entries().size() + session_.inputs.files.size());
+            for (const std::string_view entry : filelist.entries()) listed_files.emplace_back(entry);
         }
-        else { std::cout << ph::Color("エラー", ERROR_COLOR) << ": ファイルリストの読み込みに失敗しました。" << std::endl; }
+        else { diagnostics.error(0, "ファイルリストの読み込みに失敗しました。", _filelist_path); }
     }
-    // ディレクトリから登録
-    if (bundle_target_mode & 0b10) {
-        for (const fs::directory_iterator it(_input_dir); const auto& i : it) {
-            if (!i.is_regular_file()) continue;
-            std::string filename = convertFilePathToConstantName(i.path());
+    listed_files.insert(listed_files.end(), session_.inputs.files.begin(), session_.inputs.files.end());
+    // 先読みしない場合(sync)も、状態の取得はpoolで並列に行う。
+    const InputPrefetcher::Backend status_backend =
+        toPrefetchBackend(_input_engine).value_or(InputPrefetcher::Backend::THREADS);
+    const std::vector<std::optional<InputPrefetcher::Status>> listed_statuses =
+        listed_files.size() >= min_prefetch_files
+            ? InputPrefetcher::queryStatus(listed_files, pool_, status_backend)
+            : std::vector<std::optional<InputPrefetcher::Status>>(listed_files.size());
+    std::vector<std::string> listed_names(listed_files.size());
+    auto convert_names = [&listed_files, &listed_names](const size_t begin_, const size_t end_) {
+        for (size_t i = begin_; i < end_; ++i) listed_names[i] = convertFilePathToConstantName(listed_files[i]);
+    };
+    if (listed_files.size() < min_prefetch_files) { convert_names(0, listed_files.size()); }
+    else {
+        std::vector<std::future<void>> tasks;
+        for (size_t begin = 0; begin < listed_files.size(); begin += constant_name_chunk_size) {
+            const size_t end = std::min(listed_files.size(), begin + constant_name_chunk_size);
+            tasks.push_back(pool_.submit([&convert_names, begin, end] { convert_names(begin, end); }));
+        }
+        for (auto& task : tasks) task.get();
+    }
+    // 親ディレクトリはパスの最後の区切り文字までで決まるため、直前に追加したファイルと同じであれば改めて求めない。
+    constexpr fs::path::value_type separators[] = {'/', fs::path::preferred_separator, 0};
+    std::optional<std::basic_string_view<fs::path::value_type>> previous_parent;
+    // 状態を取得できなかったファイルは、個別に確認し直す。
+    for (size_t i = 0; i < listed_files.size(); ++i) {
+        fs::path& file_path = listed_files[i];
+        const std::optional<InputPrefetcher::Status>& status = listed_statuses[i];
+        if (!(status ? status->regular : is_regular_file(file_path))) {
+            diagnostics.warning(std::format("\"{}\"はファイルではないか存在しないため無視されます。",
+                                            file_path.generic_string()), file_path);
+            continue;
+        }
+        // 登録しなかった場合、file_pathは移動されない。
+        const auto [registered, inserted] = files.try_emplace(std::move(listed_names[i]), std::move(file_path));
+        if (!inserted) {
+            diagnostics.warning(std::format("\"{}\"は同じファイル名のファイルがすでに存在しているため無視されます。",
+                                            file_path.generic_string()), file_path);
+            continue;
+        }
+        const std::basic_string_view<fs::path::value_type> path = registered->second.native();
+        const size_t separator = path.find_last_of(separators);
+        if (separator == std::string_view::npos || path.substr(0, separator + 1) != previous_parent) {
+            registry_.listed_directories.push_back(parentDirectory(registered->second));
+            previous_parent = separator == std::string_view::npos
+                                  ? std::nullopt
+                                  : std::optional(path.substr(0, separator + 1));
+        }
+    }
+    // メモリ上の入力を登録
+    for (const auto& [name, data] : session_.inputs.memory) {
+        std::string filename = convertFilePathToConstantName(name);
+        if (files.contains(filename)) {
+            diagnostics.warning(std::format("\"{}\"は同じファイル名のファイルがすでに存在しているため無視されます。", name),
+                                name);
+            continue;
+        }
+        files.try_emplace(filename, name);
+        registry_.contents.try_emplace(filename, data);
+        registry_.index_names.try_emplace(filename, name);
+    }
+    // ディレクトリから登録 (共有キャッシュがある場合は、他の出力と同じ条件の走査結果を再利用する。)
+    if (bundle_target_mode_ & 0b10) {
+        const DirectoryScanner::Options options{_recursive, _include_patterns, _exclude_patterns};
+        std::optional<DirectoryScanner::Result> own_scan;
+        if (!session_.cache) own_scan = DirectoryScanner(_input_dir, options).scan(pool_);
+        const DirectoryScanner::Result& scanned = own_scan ? *own_scan : session_.cache->scan(_input_dir, options);
+        for (const auto& directory : scanned.errors) {
+            diagnostics.warning(std::format("\"{}\"を読み込めなかったため無視されます。", directory.generic_string()),
+                                directory);
+        }
+        for (const auto& [path, relative] : scanned.files) {
+            std::string filename = convertRelativePathToConstantName(relative);
             if (files.contains(filename)) {
-                std::cout << ph::Color("警告", WARN_COLOR) << ": \"" <<
-                    i.path().generic_string() << "\"は同じファイル名のファイルがすでに存在しているため無視されます。" << std::endl;
+                diagnostics.warning(std::format("\"{}\"は同じ定数名のファイルがすでに存在しているため無視されます。",
+                                                path.generic_string()), path);
                 continue;
             }
-            files.try_emplace(filename, i.path());
+            files.try_emplace(filename, path);
+            registry_.index_names.try_emplace(filename, relative);
         }
+        registry_.scanned_directories = scanned.directories;
+    }
+}
+
+int FileBundler::bundleTargetMode() const
+{
+    // 有効なパスかを確認し、それが有効なパスであればモードに追加する。
+    int mode = 0;
+    if (fs::is_regular_file(_filelist_path))
+        mode |= 0b01; // filelist id: 1
+    if (fs::is_directory(_input_dir))
+        mode |= 0b10; // input_dir id: 2
+    return mode;
+}
+
+int FileBundler::run(RunStats& stats_, Registry& registry_, const Session& session_, const bool registered_,
+                     const bool prompt_) const
+{
+    PhaseTimer::Scope phase(PhaseTimer::Phase::REGISTRATION);
+    Diagnostics& diagnostics = session_.diagnostics;
+    BundleSink& sink = session_.sink;
+    // ファイル以外の出力先では空となり、出力先ディレクトリに対する処理(上書きの確認・再利用・古い出力の削除)を行わない。
+    const fs::path output_dir = sink.directory();
+    const bool incremental = _incremental && !output_dir.empty();
+    BundleCache* cache = session_.cache;
+    // 入力ディレクトリの走査とエンコードで共有する。(共有キャッシュがある場合は、他の出力とも共有する。)
+    std::optional<WorkerPool> owned_pool;
+    WorkerPool& pool = cache ? cache->pool() : owned_pool.emplace(_jobs);
+    // バンドル対象ファイルの指定モード
+    const int bundle_target_mode = bundleTargetMode();
+    if (bundle_target_mode == 0 && session_.inputs.files.empty() && session_.inputs.memory.empty())
+        return diagnostics.error(1, "バンドル対象が指定されていません。");
+    // ディレクトリが作成できず、ディレクトリが存在しない場合
+    std::error_code output_dir_error;
+    if (!output_dir.empty() && !fs::create_directories(output_dir, output_dir_error) && !fs::is_directory(output_dir))
+        return diagnostics.error(2, "指定されたパスはディレクトリでないか作成に失敗しました。", output_dir);
+
+    if (!registered_) {
+        registry_ = {};
+        registerFiles(pool, bundle_target_mode, session_, registry_);
     }
+    const std::map<std::string, fs::path>& files = registry_.files;
+    const std::map<std::string, std::string>& index_names = registry_.index_names;
 
     //
     // ヘッダファイル・ソースファイルに書き込む。
     //
 
-    fs::path header_path(_output_dir);
+    fs::path header_path(output_dir);
     header_path /= "resource.h";
-    fs::path source_path(_output_dir);
-    source_path /= "resource.c";
+    fs::path source_path(output_dir);
+    // 定義を書き込むソースファイルの拡張子
+    const std::string source_extension = _backend == Backend::ASSEMBLY ? "S" : "c";
+    source_path /= std::format("resource.{}", source_extension);
+    const bool sharded = _shard_per_file || _shard_count > 0;
+    // 分割出力の場合は、生成したソースファイルの一覧を上書き確認の対象とする。
+    const fs::path source_list_path = sharded ? output_dir / source_list_file_name : source_path;
+    const std::string source_list_name = source_list_path.filename().generic_string();
     // ファイルの存在確認・上書き確認を行う。
-    if (exists(header_path)) {
+    if (!output_dir.empty() && exists(header_path)) {
         if (is_regular_file(header_path)) {
             if (!confirmPrompt("resource.hは既に存在しています。上書きしますか？(Y/N)",
                                "ファイルを上書きします。",
-                               "コマンドをキャンセルしました。", _all_yes))
+                               "コマンドをキャンセルしました。", _all_yes || !prompt_)) {
+                stats_.cancelled = true;
                 return 0;
+            }
         }
-        else {
-            std::cout << ph::Color("エラー", ERROR_COLOR) << ": resource.hはすでに存在していますがファイルではありません。" << std::endl;
-            return 3;
-        }
+        else { return diagnostics.error(3, "resource.hはすでに存在していますがファイルではありません。", header_path); }
     }
-    if (!(_header_only || _declare_only) && exists(source_path)) {
-        if (is_regular_file(header_path)) {
-            if (!confirmPrompt("resource.cは既に存在しています。上書きしますか？(Y/N)",
+    if (!output_dir.empty() && !(_header_only || _declare_only) && exists(source_list_path)) {
+        if (is_regular_file(source_list_path)) {
+            if (!confirmPrompt(std::format("{}は既に存在しています。上書きしますか？(Y/N)", source_list_name),
                                "ファイルを上書きします。",
-                               "コマンドをキャンセルしました。", _all_yes))
+                               "コマンドをキャンセルしました。", _all_yes || !prompt_)) {
+                stats_.cancelled = true;
                 return 0;
+            }
         }
         else {
-            std::cout << ph::Color("エラー", ERROR_COLOR) << ": resource.cはすでに存在していますがファイルではありません。" << std::endl;
-            return 4;
+            return diagnostics.error(4, std::format("{}はすでに存在していますがファイルではありません。", source_list_name),
+                                     source_list_path);
+        }
+    }
+
+    // 添字でアクセスできるよう、登録したファイルを定数名の順に並べる。
+    const std::vector<std::pair<std::string, fs::path>> resources(files.begin(), files.end());
+
+    // アセンブリソースや#embedによる出力ではデータ部分を書き込まないため、圧縮できない。
+    const bool assembly = _backend == Backend::ASSEMBLY;
+    const bool external_data = assembly || _format == Format::EMBED;
+    // 連結して出力する場合は、F_～とSIZE_～が配列内の位置を表すマクロとなる。
+    const bool packed = _pack_alignment > 0;
+    if (packed && (!PackedLayout::isValidAlignment(_pack_alignment) || (external_data && !assembly)))
+        return diagnostics.error(12, "連結して出力する場合の境界が不正か、#embedによる出力が指定されています。");
+    std::vector<bool> compress_targets(resources.size(), false);
+    if (!external_data) {
+        for (size_t i = 0; i < resources.size(); ++i)
+            compress_targets[i] = isCompressTarget(resources[i].second, _compress_all, _compress_extensions);
+    }
+    const bool use_compression = std::ranges::find(compress_targets, true) != compress_targets.end();
+
+    //
+    // テキスト変換の対象のファイルを変換し、出力先ディレクトリに書き込む。
+    //
+    // 以降の処理(サイズの取得・エンコード・.incbinや#embedによる取り込み)は、変換後のファイルを入力とする。
+    // 出力先がファイルでない場合は、変換の結果をメモリ上に保持する。
+    //
+
+    phase.switchTo(PhaseTimer::Phase::TRANSFORM);
+    // データ部分として読み込む入力
+    std::vector<InputSource> sources;
+    sources.reserve(resources.size());
+    for (const auto& [filename, path] : resources) {
+        const auto content = registry_.contents.find(filename);
+        sources.push_back({path, content != registry_.contents.end() ? std::optional(content->second) : std::nullopt});
+    }
+    const fs::path transformed_dir = output_dir / transformed_dir_name;
+    std::set<std::string> transformed_names;
+    // メモリ上に保持する変換の結果 (sourcesが参照するため、以降は要素数を変更しない。)
+    std::vector<std::string> transformed_contents(output_dir.empty() ? resources.size() : 0);
+    if (!_declare_only || packed) {
+        std::vector<std::pair<size_t, std::future<void>>> transforming;
+        for (size_t i = 0; i < resources.size(); ++i) {
+            const TextTransform transform = selectTransform(resources[i].second, _transforms, _default_transform);
+            if (transform == TextTransform::NONE) continue;
+            const Transform::Kind kind = toTransformKind(transform);
+            if (output_dir.empty()) {
+                transforming.emplace_back(i, pool.submit([&, i, kind] {
+                    transformed_contents[i] = transformToMemory(sources[i], kind, resources[i].first);
+                }));
+                continue;
+            }
+            std::error_code ec;
+            if (transformed_names.empty()) fs::create_directories(transformed_dir, ec);
+            transformed_names.insert(resources[i].first);
+            transforming.emplace_back(i, pool.submit([&, i, kind] {
+                transformFile(sources[i], transformed_dir / resources[i].first, kind, resources[i].first);
+            }));
+        }
+        // 変換中のタスクはresourcesとsourcesを参照するため、失敗した場合もすべての完了を待つ。
+        bool failed = false;
+        for (auto& [index, task] : transforming) {
+            try { task.get(); }
+            catch (const std::exception& e) {
+                diagnostics.error(13, "ファイルを変換できませんでした。", resources[index].second, e.what());
+                failed = true;
+            }
+        }
+        if (failed) return 13;
+        for (const size_t index : transforming | std::views::keys) {
+            if (output_dir.empty()) sources[index] = {resources[index].second, transformed_contents[index]};
+            else sources[index] = {transformed_dir / resources[index].first, std::nullopt};
+        }
+    }
+    // 共有キャッシュは、変換していない入力ファイルの状態と処理結果のみを共有する。
+    std::vector<bool> cacheable(resources.size(), false);
+    if (cache) {
+        for (size_t i = 0; i < resources.size(); ++i)
+            cacheable[i] = !sources[i].data && sources[i].path == resources[i].second;
+    }
+    // アセンブリソースや#embedによる出力は、入力をパスで参照する。
+    const bool has_memory_source = std::ranges::any_of(sources, [](const InputSource& source_) {
+        return source_.data.has_value();
+    });
+    if (external_data && has_memory_source)
+        return diagnostics.error(14, "メモリ上の入力は、アセンブリソースや#embedによる出力では参照できません。");
+
+    //
+    // 入力ファイルの状態を取得する。
+    //
+
+    phase.switchTo(PhaseTimer::Phase::SIZE_QUERY);
+
+    struct InputState {
+        uintmax_t size = 0;
+        int64_t mtime = 0;
+        /// 前回の出力からデータ部分を再利用できる場合の記録
+        const Manifest::Entry* reuse = nullptr;
+        /// 再利用するデータ部分が書き込まれている前回の出力ファイル
+        InputSource reuse_source;
+        size_t segment_count = 0;
+        /// 内容ハッシュを計算済みの場合はtrue
+        bool hashed = false;
+        uint64_t hash = 0;
+        /// 同一の内容を持つファイルの別名として出力する場合の、実体となるファイル(resourcesの添字)
+        std::optional<size_t> alias_of;
+    };
+    std::vector<InputState> inputs;
+    const std::optional<InputPrefetcher::Backend> prefetch_backend = toPrefetchBackend(_input_engine);
+    // 連結して出力する場合は、宣言にもファイルのオフセットとサイズが必要となる。
+    if (!_declare_only || packed) {
+        inputs.resize(resources.size());
+        // 状態を取得するファイル (メモリ上の入力と、共有キャッシュに記録されたファイルを除く。)
+        std::vector<size_t> unknown;
+        for (size_t i = 0; i < resources.size(); ++i) {
+            InputState& state = inputs[i];
+            if (sources[i].data) {
+                state.size = sources[i].data->size();
+                continue;
+            }
+            if (const auto status = cacheable[i] ? cache->findStatus(sources[i].path) : std::nullopt) {
+                state.size = status->size;
+                state.mtime = status->mtime;
+                continue;
+            }
+            unknown.push_back(i);
+        }
+        // 状態はまとめて取得し、取得できなかったファイルと通常のファイルでないものは個別に取得し直してエラーを報告する。
+        std::vector<std::optional<InputPrefetcher::Status>> statuses(unknown.size());
+        if (prefetch_backend && unknown.size() >= min_prefetch_files) {
+            Trace::Span span("query_status");
+            std::vector<fs::path> paths;
+            paths.reserve(unknown.size());
+            for (const size_t index : unknown) paths.push_back(sources[index].path);
+            statuses = InputPrefetcher::queryStatus(paths, pool, *prefetch_backend);
+        }
+        for (size_t i = 0; i < unknown.size(); ++i) {
+            const size_t index = unknown[i];
+            InputState& state = inputs[index];
+            if (statuses[i] && statuses[i]->regular) {
+                state.size = statuses[i]->size;
+                state.mtime = Manifest::toMtime(statuses[i]->mtime);
+            }
+            else {
+                Trace::Span span("file_size", resources[index].first);
+                try {
+                    state.size = fs::file_size(sources[index].path);
+                    state.mtime = Manifest::toMtime(fs::last_write_time(sources[index].path));
+                }
+                catch (const std::filesystem::filesystem_error& e) {
+                    return diagnostics.error(7, "ファイルサイズが取得できませんでした。", sources[index].path, e.what());
+                }
+            }
+            if (cacheable[index]) cache->storeStatus(sources[index].path, {state.size, state.mtime});
+        }
+    }
+
+    phase.switchTo(PhaseTimer::Phase::HASH);
+
+    // この値が前回と異なる場合、前回のデータ部分は再利用できない。
+    // (CRC32Cを計算しなかった前回の出力は、--hashを指定した場合に再利用できない。)
+    const int manifest_options = (_header_only ? Options::HEADER_ONLY : 0) | (_hash ? Options::HASH : 0) |
+        static_cast<int>(_format) << 12 | static_cast<int>(_backend) << 16;
+    const fs::path manifest_path = output_dir / Manifest::FILE_NAME;
+    Manifest previous_manifest;
+    const bool manifest_loaded = incremental && !_declare_only && previous_manifest.load(manifest_path);
+    // メモリ上の入力は更新日時を持たないため、前回から変更されていないかは内容ハッシュのみで判定する。
+    auto is_mtime_unchanged = [&](const size_t index_, const Manifest::Entry& entry_) {
+        return !sources[index_].data && entry_.mtime == inputs[index_].mtime;
+    };
+    // 内容ハッシュを計算する。共有キャッシュがある場合は、他の出力で計算した値を用いる。
+    auto hash_source = [&](const size_t index_) {
+        if (cacheable[index_]) {
+            if (const auto hash = cache->findHash(sources[index_].path)) return *hash;
+        }
+        const uint64_t hash = hashFile(sources[index_], inputs[index_].size, resources[index_].first);
+        if (cacheable[index_]) cache->storeHash(sources[index_].path, hash);
+        return hash;
+    };
+
+    //
+    // 同一の内容を持つファイルを検出する。
+    //
+    // サイズと圧縮の対象であるかが一致するファイルのみ内容ハッシュを比較し、2つ目以降(定数名の順)を
+    // 最初のファイルの別名とする。前回から変更されていないファイルは記録されたハッシュを用いる。
+    // 別名とするのは、内容を比較して最初のファイルと一致した場合のみとする。
+    //
+
+    uintmax_t deduplicated_count = 0;
+    uintmax_t deduplicated_bytes = 0;
+    if (!_declare_only) {
+        std::map<std::pair<uintmax_t, bool>, std::vector<size_t>> candidates;
+        for (size_t i = 0; i < resources.size(); ++i) candidates[{inputs[i].size, compress_targets[i]}].push_back(i);
+        // 記録されたハッシュを用いられないファイルのみを読み込む。
+        std::vector<size_t> unhashed;
+        for (const auto& group : candidates | std::views::values) {
+            if (group.size() < 2) continue;
+            for (const size_t index : group) {
+                const auto& [filename, path] = resources[index];
+                InputState& state = inputs[index];
+                const Manifest::Entry* entry = manifest_loaded ? previous_manifest.findEntry(filename) : nullptr;
+                std::optional<uint64_t> hash;
+                if (entry && entry->path == path && entry->size == state.size && is_mtime_unchanged(index, *entry))
+                    hash = entry->hash;
+                else if (cacheable[index])
+                    hash = cache->findHash(sources[index].path);
+                if (hash) {
+                    state.hashed = true;
+                    state.hash = *hash;
+                }
+                else { unhashed.push_back(index); }
+            }
+        }
+        // 小さなファイルは、ハッシュを計算するタスクに先行して読み込む。
+        std::vector<size_t> prefetch_slots(resources.size(), PrefetchedInput::NONE);
+        std::vector<fs::path> prefetch_paths;
+        std::vector<uintmax_t> prefetch_sizes;
+        for (const size_t index : unhashed) {
+            if (sources[index].data || inputs[index].size > prefetch_file_size) continue;
+            prefetch_slots[index] = prefetch_paths.size();
+            prefetch_paths.push_back(sources[index].path);
+            prefetch_sizes.push_back(inputs[index].size);
+        }
+        std::unique_ptr<InputPrefetcher> prefetcher;
+        if (prefetch_backend && prefetch_paths.size() >= min_prefetch_files) {
+            stats_.prefetched_files += prefetch_paths.size();
+            prefetcher = std::make_unique<InputPrefetcher>(std::move(prefetch_paths), std::move(prefetch_sizes),
+                                                           prefetch_window_files, prefetch_window_bytes,
+                                                           *prefetch_backend);
+            stats_.prefetch_backend = prefetchBackendName(prefetcher->backend());
+        }
+        std::vector<std::pair<size_t, std::future<uint64_t>>> hashing;
+        for (const size_t index : unhashed) {
+            hashing.emplace_back(index, pool.submit([&, index] {
+                PrefetchedInput input(prefetcher.get(), prefetch_slots[index], sources[index]);
+                const uint64_t hash = hashFile(input.source(), inputs[index].size, resources[index].first);
+                if (cacheable[index]) cache->storeHash(sources[index].path, hash);
+                return hash;
+            }));
+        }
+        for (auto& [index, hash] : hashing) {
+            // 読み込めないファイルは重複として扱わず、エンコード時にエラーとする。
+            try {
+                inputs[index].hash = hash.get();
+                inputs[index].hashed = true;
+            }
+            catch (const std::exception&) {}
+        }
+        // ハッシュが一致したファイルは内容を比較し、一致した場合のみ別名とする。(衝突した場合は別のファイルとする。)
+        std::vector<std::tuple<size_t, size_t, std::future<bool>>> comparisons;
+        for (const auto& group : candidates | std::views::values) {
+            std::map<uint64_t, size_t> originals;
+            for (const size_t index : group) {
+                if (!inputs[index].hashed) continue;
+                const auto [it, inserted] = originals.try_emplace(inputs[index].hash, index);
+                if (inserted) continue;
+                comparisons.emplace_back(index, it->second, pool.submit([&, index, original = it->second] {
+                    return isSameContent(sources[original], sources[index], inputs[index].size,
+                                         resources[index].first);
+                }));
+            }
+        }
+        for (auto& [index, original, same] : comparisons) {
+            if (!same.get()) continue;
+            inputs[index].alias_of = original;
+            ++deduplicated_count;
+            deduplicated_bytes += inputs[index].size;
         }
     }
 
     //
-    // 書き込み対象ファイルのストリームを開き、コメント・includeディレクティブなどを書き込む。
+    // データ部分を書き込む出力ファイルを決定する。
     //
 
-    std::ofstream header, source;
-    if (!(_header_only || _declare_only)) {
-        source.open(source_path);
-        if (!source) {
-            std::cout << ph::Color("エラー", ERROR_COLOR) << ": 出力先ファイルが開けませんでした。" << std::endl;
-            return 5;
+    std::vector<OutputUnit> units;
+    if (!_declare_only) {
+        if (_header_only) { units.push_back({"resource.h", {}}); }
+        else if (_shard_per_file) {
+            for (size_t i = 0; i < resources.size(); ++i) {
+                if (inputs[i].alias_of) continue;
+                units.push_back({std::format("resource_{}.{}", resources[i].first, source_extension), {i}});
+            }
+        }
+        else if (_shard_count > 0) {
+            std::vector<uintmax_t> sizes;
+            sizes.reserve(inputs.size());
+            for (const auto& state : inputs) sizes.push_back(state.alias_of ? 0 : state.size);
+            units = balanceShards(sizes, _shard_count, source_extension);
+        }
+        else { units.push_back({source_path.filename().generic_string(), {}}); }
+        // 分割しない場合は、すべてのファイルを1つの出力ファイルに書き込む。
+        if (units.size() == 1 && !_shard_per_file && _shard_count == 0) {
+            units.front().resources.resize(resources.size());
+            std::iota(units.front().resources.begin(), units.front().resources.end(), size_t{0});
         }
-        source << "// This file is auto generated. by net.ln3.file-bundler\n\n\n"
-            << "#include \"resource.h\"\n\n";
+        // 別名として出力するファイルはデータ部分を持たない。
+        for (auto& unit : units)
+            std::erase_if(unit.resources, [&](const size_t i_) { return inputs[i_].alias_of.has_value(); });
     }
-    header.open(header_path);
-    if (!header) {
-        std::cout << ph::Color("エラー", ERROR_COLOR) << ": 出力先ファイルが開けませんでした。" << std::endl;
-        return 6;
+
+    //
+    // 前回の実行から変更されていないファイルを判定する。
+    //
+
+    if (manifest_loaded && previous_manifest.options() == manifest_options) {
+        // 前回から変更されていない出力ファイルのみ、データ部分の読み出し元にできる。
+        std::map<std::string, bool> unchanged_outputs;
+        auto is_output_unchanged = [&](const std::string& name_) {
+            auto [it, inserted] = unchanged_outputs.try_emplace(name_, false);
+            if (inserted) it->second = previous_manifest.isOutputUnchanged(name_, output_dir);
+            return it->second;
+        };
+        // 更新日時のみが変化したファイルは、内容のハッシュを比較する。
+        std::vector<std::tuple<size_t, const Manifest::Entry*, std::future<uint64_t>>> rehash;
+        for (size_t i = 0; i < resources.size(); ++i) {
+            const auto& [filename, path] = resources[i];
+            InputState& state = inputs[i];
+            const Manifest::Entry* entry = previous_manifest.findEntry(filename);
+            if (!state.alias_of && state.size > 0 && entry && entry->path == path && entry->size == state.size &&
+                entry->compress == compress_targets[i] && is_output_unchanged(entry->fragment_file)) {
+                if (is_mtime_unchanged(i, *entry)) { state.reuse = entry; }
+                else if (state.hashed) { if (state.hash == entry->hash) state.reuse = entry; }
+                else { rehash.emplace_back(i, entry, pool.submit([&hash_source, i] { return hash_source(i); })); }
+            }
+        }
+        for (auto& [index, entry, hash] : rehash) {
+            // 読み込みに失敗した場合は再エンコードを試み、そこでエラーとして扱う。
+            try { if (hash.get() == entry->hash) inputs[index].reuse = entry; }
+            catch (const std::exception&) {}
+        }
+        for (auto& state : inputs)
+            if (state.reuse) state.reuse_source = {output_dir / state.reuse->fragment_file, std::nullopt};
     }
+
+    //
+    // 連結して出力する場合の、各ファイルの配置を決定する。
+    //
+    // 定数名の順に境界に揃えて配置し、配列の末尾も境界に揃える。別名は実体となるファイルと同じ位置を指す。
+    //
+
+    std::vector<PackedLayout::TableEntry> pack_table;
+    uintmax_t pack_size = 0;
+    if (packed) {
+        pack_table.resize(resources.size());
+        for (size_t i = 0; i < resources.size(); ++i) {
+            if (inputs[i].alias_of) continue;
+            pack_table[i] = {PackedLayout::alignUp(pack_size, _pack_alignment), inputs[i].size};
+            pack_size = pack_table[i].first + inputs[i].size;
+        }
+        for (size_t i = 0; i < resources.size(); ++i)
+            if (inputs[i].alias_of) pack_table[i] = pack_table[*inputs[i].alias_of];
+        pack_size = PackedLayout::alignUp(pack_size, _pack_alignment);
+    }
+    // file_bundler_blobの要素数 (空の場合も要素を1つ持たせる。文字列リテラルは末尾のNUL文字を含む。)
+    const uintmax_t pack_length = !assembly && _format == Format::STRING
+                                      ? pack_size + 1
+                                      : std::max<uintmax_t>(pack_size, 1);
+
+    //
+    // ヘッダファイルを開き、コメント・インクルードガードなどを書き込む。
+    //
+    // 出力はすべての書き込みを終えてから出力先に反映する。(ファイルの場合は、内容が変化した場合のみ置き換える。)
+    //
+
+    phase.switchTo(PhaseTimer::Phase::WRITE);
+    const std::unique_ptr<BundleSink::Output> header_file = sink.open(header_path.filename().generic_string());
+    if (!header_file) return diagnostics.error(6, "出力先ファイルが開けませんでした。", header_path);
+    std::ostream& header = header_file->stream();
     header << "// This file is auto generated. by net.ln3.file-bundler\n\n\n";
-    header << "#ifndef RESOURCE_H\n#define RESOURCE_H\n\n\n" << std::flush;
+    header << "#ifndef RESOURCE_H\n#define RESOURCE_H\n\n\n";
+
+    std::vector<std::unique_ptr<BundleSink::Output>> source_files;
+    // 書き込みに失敗した場合に、書きかけの出力を破棄する。既存の出力ファイルは変更しない。
+    auto discard_outputs = [&] {
+        header_file->discard();
+        for (const auto& source_file : source_files) source_file->discard();
+    };
+
+    //
+    // ファイルをセグメントに分割し、ワーカーでエンコードする。
+    //
+
+    // 巨大なファイルが1つのワーカーを占有しないよう、ファイルを一定サイズのセグメントに分割して割り当てる。
+    // 再利用するファイルは、前回の出力からデータ部分を同じく一定サイズずつ読み込む。
+    // セグメントは出力ファイルへ書き込む順に並べる。
+    // アセンブリソースや#embedによる出力ではデータ部分を書き込まないため、内容ハッシュのみを計算する。
+    // 圧縮の対象のファイルは、セグメントごとに圧縮したブロックを書き込み時にまとめてエンコードする。
+    struct Segment {
+        enum class Task { ENCODE, HASH, COPY, COMPRESS };
+
+        const InputSource* source;
+        /// 記録に用いる定数名
+        const std::string* name;
+        uintmax_t offset;
+        size_t length;
+        Task task;
+        /// 処理結果を共有キャッシュで他の出力と共有する。
+        bool shared;
+        /// 先読みの対象である場合の、先読みの順序 (対象でない場合はPrefetchedInput::NONE)
+        size_t prefetch_slot;
+    };
+    const ByteEncoder::Format encoder_format = toEncoderFormat(_format);
+    // 共有キャッシュに記録する処理結果の種類 (エンコードの結果は形式ごとに、CRC32Cを計算したかも区別する。)
+    auto segment_kind = [encoder_format, crc = _hash](const Segment::Task task_) {
+        return (task_ == Segment::Task::ENCODE
+                    ? static_cast<int>(Segment::Task::COMPRESS) + 1 + static_cast<int>(encoder_format)
+                    : static_cast<int>(task_)) | (crc ? crc_segment_kind : 0);
+    };
+    // 小さなファイルは1つのセグメントとなるため、エンコードなどのタスクに先行して書き込む順に読み込む。
+    // 前回の出力から再利用するファイルと、共有キャッシュに処理結果が記録されているファイルは読み込まない。
+    std::vector<fs::path> prefetch_paths;
+    std::vector<uintmax_t> prefetch_sizes;
+    std::vector<Segment> segments;
+    for (const auto& unit : units) {
+        for (const size_t index : unit.resources) {
+            InputState& state = inputs[index];
+            // 再利用するファイルのハッシュは前回の記録を用いる。
+            if (external_data && state.reuse) continue;
+            const Segment::Task task = state.reuse ? Segment::Task::COPY
+                                       : external_data ? Segment::Task::HASH
+                                       : compress_targets[index] ? Segment::Task::COMPRESS
+                                       : Segment::Task::ENCODE;
+            const InputSource* segment_source = state.reuse ? &state.reuse_source : &sources[index];
+            const uintmax_t begin = state.reuse ? state.reuse->fragment_offset : 0;
+            const uintmax_t end = state.reuse ? begin + state.reuse->fragment_length : state.size;
+            const bool shared = cacheable[index] && !state.reuse;
+            const bool prefetch = prefetch_backend && !state.reuse && !sources[index].data &&
+                state.size <= prefetch_file_size && state.size > 0 &&
+                !(shared && cache->hasSegment(sources[index].path, 0, segment_kind(task)));
+            if (prefetch) {
+                prefetch_paths.push_back(sources[index].path);
+                prefetch_sizes.push_back(state.size);
+            }
+            for (uintmax_t offset = begin; offset < end; offset += segment_size, ++state.segment_count) {
+                segments.push_back({
+                    segment_source, &resources[index].first, offset,
+                    static_cast<size_t>(std::min<uintmax_t>(segment_size, end - offset)), task, shared,
+                    prefetch ? prefetch_paths.size() - 1 : PrefetchedInput::NONE
+                });
+            }
+        }
+    }
+    // 処理中のタスクが参照するため、in_flightより先に宣言する。
+    std::unique_ptr<InputPrefetcher> prefetcher;
+    if (prefetch_paths.size() >= min_prefetch_files) {
+        stats_.prefetched_files += prefetch_paths.size();
+        prefetcher = std::make_unique<InputPrefetcher>(std::move(prefetch_paths), std::move(prefetch_sizes),
+                                                       prefetch_window_files, prefetch_window_bytes,
+                                                       *prefetch_backend);
+        stats_.prefetch_backend = prefetchBackendName(prefetcher->backend());
+    }
+    else {
+        for (auto& segment : segments) segment.prefetch_slot = PrefetchedInput::NONE;
+    }
+
+    // 書き込み待ちのエンコード結果がメモリを圧迫しないよう、同時に処理するセグメント数を制限する。
+    const size_t max_in_flight = static_cast<size_t>(pool.size()) * 4;
+    std::deque<std::future<EncodedSegment>> in_flight;
+    // エラーで途中で戻る場合も、処理中のタスクが入力と先読みした内容を参照し終えるまで待つ。
+    struct InFlightGuard {
+        std::deque<std::future<EncodedSegment>>& tasks;
+        ~InFlightGuard() { for (const auto& task : tasks) if (task.valid()) task.wait(); }
+    } in_flight_guard{in_flight};
+    size_t next_segment = 0;
+    auto submit_segments = [&] {
+        while (next_segment < segments.size() && in_flight.size() < max_in_flight) {
+            const Segment& segment = segments[next_segment++];
+            in_flight.push_back(pool.submit([segment, encoder_format, crc = _hash, cache, &segment_kind, &prefetcher] {
+                static constexpr const char* span_names[] = {
+                    "encode_segment", "hash_segment", "copy_segment", "compress_segment"
+                };
+                Trace::Span span(span_names[static_cast<int>(segment.task)], *segment.name);
+                // 先読みした内容は、キャッシュから取得した場合も解放する。
+                PrefetchedInput input(prefetcher.get(), segment.prefetch_slot, *segment.source);
+                const int kind = segment_kind(segment.task);
+                EncodedSegment result;
+                if (segment.shared) {
+                    if (auto cached = cache->findSegment(segment.source->path, segment.offset, kind)) {
+                        result.text = cached->text;
+                        result.hash = cached->hash;
+                        result.crc = cached->crc;
+                        result.length = segment.length;
+                        result.cached = std::move(cached->buffer);
+                        span.setBytes(segment.length, result.text.size());
+                        return result;
+                    }
+                }
+                switch (segment.task) {
+                case Segment::Task::HASH:
+                    result = hashSegment(input.source(), segment.offset, segment.length, crc);
+                    break;
+                case Segment::Task::COPY:
+                    result = copySegment(*segment.source, segment.offset, segment.length);
+                    break;
+                case Segment::Task::COMPRESS:
+                    result = compressSegment(input.source(), segment.offset, segment.length, crc);
+                    break;
+                default:
+                    result = encodeSegment(input.source(), segment.offset, segment.length, encoder_format, crc);
+                    break;
+                }
+                result.length = segment.length;
+                if (segment.shared) {
+                    cache->storeSegment(segment.source->path, segment.offset, kind, result.text, result.hash,
+                                        result.crc);
+                }
+                span.setBytes(segment.length, result.text.size());
+                return result;
+            }));
+        }
+    };
+    // 次のセグメントの処理結果を受け取る。失敗した場合はエラーを表示してfalseを返す。
+    auto receive_segment = [&](EncodedSegment& segment_) {
+        submit_segments();
+        const PhaseTimer::Scope wait(PhaseTimer::Phase::ENCODE);
+        try { segment_ = in_flight.front().get(); }
+        catch (const std::exception& e) {
+            diagnostics.error(8, "ファイルを読み込めませんでした。", {}, e.what());
+            return false;
+        }
+        in_flight.pop_front();
+        return true;
+    };
 
     //
-    // モードに合わせてヘッダファイル・ソースファイルにファイルの内容や定数宣言を書き込む。
+    // ヘッダファイルに宣言を書き込む。
     //
 
-    for (const auto& [filename, path] : files) {
-        //
-        // ヘッダファイルの書き込み
-        //
+    // 圧縮の対象のファイルが存在する場合は、展開処理を宣言する。
+    // 定義は外部リンケージを持つため、常に最初のソースファイルに書き込む。(圧縮を指定した場合はヘッダのみの出力とならない。)
+    if (use_compression) header << CompressionRuntime::declarations();
+    // 別名はデータ部分の実体となるファイルの定数をマクロで参照させる。
+    auto write_alias = [&](const size_t index_) {
+        const auto& [filename, path] = resources[index_];
+        const std::string& original = resources[*inputs[index_].alias_of].first;
+        header << std::format("// {} ({}と同一の内容)\n", path.filename().generic_string(), original)
+            << std::format("#define SIZE_{} SIZE_{}\n", filename, original);
+        const char* data_prefix = compress_targets[index_] ? "R_" : "F_";
+        header << std::format("#define {0}{1} {0}{2}\n\n\n", data_prefix, filename, original);
+    };
+    if (packed) {
+        header << PackedLayout::declarations(_pack_alignment, pack_length, resources.size());
+        for (size_t i = 0; i < resources.size(); ++i) {
+            if (inputs[i].alias_of) {
+                write_alias(i);
+                continue;
+            }
+            header << std::format("// {}\n", resources[i].second.filename().generic_string())
+                << PackedLayout::accessor(resources[i].first, pack_table[i].first, pack_table[i].second);
+        }
+    }
+    else if (!_header_only) {
+        for (size_t i = 0; i < resources.size(); ++i) {
+            const auto& [filename, path] = resources[i];
+            if (!inputs.empty() && inputs[i].alias_of) {
+                write_alias(i);
+                continue;
+            }
+            header << std::format("// {}\n", path.filename().generic_string())
+                << std::format("extern const unsigned long long SIZE_{};\n", filename);
+            if (compress_targets[i]) header << CompressionRuntime::accessorDeclaration(filename);
+            else header << std::format("extern const char F_{}[];\n\n\n", filename);
+        }
+    }
 
-        header << std::format("// {}\n", path.filename().generic_string());
+    //
+    // モードに合わせてヘッダファイル・ソースファイルにファイルの内容を書き込む。
+    //
+    // エンコードは並列に行うが、書き込みは出力ファイルごとに定数名の順に行うため、出力はjobsの値によらず同一になる。
+    //
+
+    Manifest manifest;
+    manifest.setOptions(manifest_options);
+    // 各リソースの内容のCRC32C (--hash)
+    std::vector<uint32_t> content_crcs(resources.size());
+    // 圧縮して格納したファイルの展開後のサイズの合計
+    uintmax_t arena_size = 0;
+    for (const auto& unit : units) {
+        BundleSink::Output* source_file = nullptr;
         if (!_header_only) {
-            header
-                << std::format("extern const unsigned long long SIZE_{};\n", filename)
-                << std::format("extern const char F_{}[];\n\n\n", filename);
-        }
-        if (_declare_only) continue;
-
-        //
-        // ファイルサイズを取得
-        //
-
-        size_t input_size;
-        try { input_size = fs::file_size(path); }
-        catch (const std::filesystem::filesystem_error& e) {
-            std::cout << ph::Color("エラー", ERROR_COLOR) << ": ファイルサイズが取得できませんでした。" << std::endl;
-            std::cerr << e.what() << std::endl;
-            // TODO: 失敗時の処理を関数として切り出す。（ソースファイルとヘッダの書き込み時）
-            // ERROR HANDLER - Remove files.
-            header.close();
-            fs::remove(header_path);
-            if (!_header_only) {
-                source.close();
-                fs::remove(source_path);
+            std::unique_ptr<BundleSink::Output> opened = sink.open(unit.file_name);
+            if (!opened) {
+                discard_outputs();
+                return diagnostics.error(5, "出力先ファイルが開けませんでした。", output_dir / unit.file_name);
             }
-            // END ERROR HANDLER
-            return 7;
-        }
-
-        //
-        // ソースファイルまたはヘッダファイルに定義を書き込む。
-        //
-
-        std::string size_declare = std::format("const unsigned long long SIZE_{} = {};\n", filename, input_size);
-        std::string file_declare = std::format("const char F_{}[] = {{", filename);
-        if (_header_only) { header << size_declare << file_declare; }
-        else { source << size_declare << file_declare; }
-
-        header.flush();
-        if (!_header_only) { source.flush(); }
-
-        //
-        // バンドル対象のファイルからデータをソースファイルまたはヘッダファイルに書き込む。
-        //
-
-        // ファイルを開く
-        std::ifstream input(path);
-        if (!input) {
-            std::cout << ph::Color("エラー", ERROR_COLOR) << ": ファイルを開けませんでした。" << std::endl;
-            // TODO: 失敗時の処理を関数として切り出す。（ソースファイルとヘッダの書き込み時）
-            // ERROR HANDLER - Remove files.
-            header.close();
-            fs::remove(header_path);
-            if (!_header_only) {
-                source.close();
-                fs::remove(source_path);
+            source_file = source_files.emplace_back(std::move(opened)).get();
+            source_file->stream() << "// This file is auto generated. by net.ln3.file-bundler\n\n\n";
+            if (assembly) source_file->stream() << AssemblyBackend::prologue();
+            else source_file->stream() << "#include \"resource.h\"\n\n";
+            // 展開処理は最初の出力ファイルにのみ定義する。
+            if (use_compression && &unit == &units.front()) source_file->stream() << CompressionRuntime::definitions();
+        }
+        std::ostream& output = source_file ? source_file->stream() : header;
+        // 連結して出力する場合の、書き込み済みのバイト数
+        uintmax_t pack_position = 0;
+        // 境界に揃えるための0
+        ByteEncoder padding_encoder(encoder_format);
+        const std::vector<char> padding_bytes(packed ? _pack_alignment : 0, 0);
+        auto write_padding = [&](const uintmax_t end_) {
+            for (; pack_position < end_; pack_position += padding_bytes.size()) {
+                const auto length = static_cast<size_t>(std::min<uintmax_t>(padding_bytes.size(), end_ - pack_position));
+                output << padding_encoder.encode(padding_bytes.data(), length, pack_position != 0);
             }
-            // END ERROR HANDLER
-            return 8;
-        }
-
-        std::ofstream& output = _header_only ? header : source;
-
-        do {
-            constexpr size_t input_buff_size = 10000;
-            char buff[input_buff_size]{};
-            // 読み込み文字数を正規化
-            const size_t read_char_count = input_size > input_buff_size ? input_buff_size : input_size;
-            input.read(buff, input_buff_size);
-            input_size -= input_buff_size;
-            std::vector buff_vec(buff, buff + read_char_count);
-            // データを書き込む。
-            if (input.eof()) {
-                std::copy(buff_vec.begin(), buff_vec.end() - 1, std::ostream_iterator<int>(output, ", "));
-                output << static_cast<int>(buff_vec.back()) << "};\n\n\n";
+            pack_position = end_;
+        };
+        if (packed) {
+            if (assembly) output << AssemblyBackend::packedBegin(_pack_alignment);
+            else output << PackedLayout::blobBegin() << ByteEncoder::initializerBegin(encoder_format);
+        }
+
+        for (const size_t index : unit.resources) {
+            const auto& [filename, path] = resources[index];
+            const InputState& state = inputs[index];
+            Trace::Span file_span("write_file", filename);
+            const auto file_start = _stats ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{};
+            const auto output_start = static_cast<uintmax_t>(output.tellp());
+            // 定義の書き込みの終了時に、入力と出力のバイト数と所要時間を記録する。
+            auto finish_file = [&] {
+                const uintmax_t written = static_cast<uintmax_t>(output.tellp()) - output_start;
+                file_span.setBytes(state.size, written);
+                if (!_stats) return;
+                const std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - file_start;
+                stats_.files.push_back({filename, state.size, written, seconds.count()});
+            };
+
+            //
+            // 連結して出力する場合は、境界に揃えてデータ部分のみを書き込む。
+            //
+
+            if (packed) {
+                const uintmax_t offset = pack_table[index].first;
+                ContentDigest content;
+                if (assembly) {
+                    for (size_t i = 0; i < state.segment_count; ++i) {
+                        EncodedSegment segment;
+                        if (!receive_segment(segment)) {
+                            discard_outputs();
+                            return 8;
+                        }
+                        content.add(segment);
+                    }
+                    const uint64_t hash = state.reuse ? state.reuse->hash : content.hash.digest();
+                    content_crcs[index] = state.reuse ? state.reuse->crc : content.crc;
+                    output << AssemblyBackend::packedData(sources[index].path, state.size, hash, offset - pack_position);
+                    pack_position = offset + state.size;
+                    manifest.setEntry(filename, {
+                                          path, state.size, state.mtime, hash, content_crcs[index], unit.file_name, 0, 0
+                                      });
+                    finish_file();
+                    continue;
+                }
+                write_padding(offset);
+                if (offset > 0 && state.size > 0) output << ByteEncoder::separator(encoder_format);
+                const auto fragment_offset = static_cast<uintmax_t>(output.tellp());
+                for (size_t i = 0; i < state.segment_count; ++i) {
+                    EncodedSegment segment;
+                    if (!receive_segment(segment)) {
+                        discard_outputs();
+                        return 8;
+                    }
+                    output.write(segment.text.data(), static_cast<std::streamsize>(segment.text.size()));
+                    content.add(segment);
+                }
+                pack_position = offset + state.size;
+                content_crcs[index] = state.reuse ? state.reuse->crc : content.crc;
+                manifest.setEntry(filename, {
+                                      path, state.size, state.mtime,
+                                      state.reuse ? state.reuse->hash : content.hash.digest(), content_crcs[index],
+                                      unit.file_name, fragment_offset,
+                                      static_cast<uintmax_t>(output.tellp()) - fragment_offset
+                                  });
+                finish_file();
+                continue;
+            }
+
+            if (_header_only) output << std::format("// {}\n", path.filename().generic_string());
+            std::string size_declare = std::format("const unsigned long long SIZE_{} = {};\n", filename, state.size);
+
+            //
+            // アセンブリソースの.incbinまたは#embedでファイルを取り込む定義を書き込む。
+            //
+
+            if (external_data) {
+                ContentDigest content;
+                for (size_t i = 0; i < state.segment_count; ++i) {
+                    EncodedSegment segment;
+                    if (!receive_segment(segment)) {
+                        discard_outputs();
+                        return 8;
+                    }
+                    content.add(segment);
+                }
+                const uint64_t hash = state.reuse ? state.reuse->hash : content.hash.digest();
+                content_crcs[index] = state.reuse ? state.reuse->crc : content.crc;
+                if (assembly) { output << AssemblyBackend::definition(filename, sources[index].path, state.size, hash); }
+                else {
+                    // 内容が変化した場合にこのファイルも変化させ、再コンパイルさせるためにハッシュを埋め込む。
+                    output << size_declare
+                        << std::format("// xxh64: {:016x}\n", hash)
+                        << std::format("const char F_{}[] = {{\n#embed \"{}\" if_empty(0)\n}};\n\n\n", filename,
+                                       fs::absolute(sources[index].path).generic_string());
+                }
+                manifest.setEntry(filename, {
+                                      path, state.size, state.mtime, hash, content_crcs[index], unit.file_name, 0, 0
+                                  });
+                finish_file();
+                continue;
+            }
+
+            //
+            // 圧縮の対象のファイルは、圧縮したブロックをすべて受け取ってから格納方法を決定する。
+            //
+
+            const bool compress_target = compress_targets[index];
+            ContentDigest content;
+            // 圧縮して格納する場合は圧縮したストリーム、圧縮せずに格納する場合は元の内容
+            std::string stored;
+            bool compressed = false;
+            uintmax_t stored_size = 0;
+            if (compress_target && !state.reuse) {
+                std::string stream;
+                for (size_t i = 0; i < state.segment_count; ++i) {
+                    EncodedSegment segment;
+                    if (!receive_segment(segment)) {
+                        discard_outputs();
+                        return 8;
+                    }
+                    stream.append(segment.text);
+                    content.add(segment);
+                }
+                compressed = stream.size() < state.size - state.size / min_compression_saving_divisor;
+                if (compressed) { stored = std::move(stream); }
+                else {
+                    stored.resize(state.size);
+                    if (!Lz4::decompressStream(stream.data(), stream.size(), stored.data(), stored.size())) {
+                        discard_outputs();
+                        return diagnostics.error(10, std::format("\"{}\"を圧縮したデータを展開できませんでした。",
+                                                                 path.generic_string()), path);
+                    }
+                }
+                stored_size = compressed ? stored.size() : 0;
+            }
+            else if (compress_target) {
+                stored_size = state.reuse->stored_size;
+                compressed = stored_size > 0;
+            }
+
+            //
+            // ソースファイルまたはヘッダファイルに定義を書き込む。
+            //
+            // 圧縮の対象のファイルのデータ部分は、アクセサからのみ参照させるためstaticとする。
+            //
+
+            output << size_declare;
+            if (compressed) output << std::format("static const unsigned long long ZSIZE_{} = {};\n", filename, stored_size);
+            output << std::format("{}const char {}_{}[] =", compress_target ? "static " : "", compressed ? "Z" : "F",
+                                  filename)
+                << ByteEncoder::initializerBegin(encoder_format);
+
+            //
+            // エンコード済みのデータを書き込む。
+            //
+
+            const auto fragment_offset = static_cast<uintmax_t>(output.tellp());
+            if (compress_target && !state.reuse) {
+                constexpr size_t encode_chunk_size = 64 * 1024;
+                ByteEncoder encoder(encoder_format);
+                for (size_t offset = 0; offset < stored.size(); offset += encode_chunk_size) {
+                    output << encoder.encode(stored.data() + offset, std::min(encode_chunk_size, stored.size() - offset),
+                                             offset != 0);
+                }
             }
             else {
-                std::ranges::copy(buff_vec, std::ostream_iterator<int>(output, ", "));
+                for (size_t i = 0; i < state.segment_count; ++i) {
+                    EncodedSegment segment;
+                    if (!receive_segment(segment)) {
+                        discard_outputs();
+                        return 8;
+                    }
+                    output.write(segment.text.data(), static_cast<std::streamsize>(segment.text.size()));
+                    content.add(segment);
+                }
+            }
+            // 空のファイルは要素数0の配列を宣言できないため、SIZE_を0のまま要素を1つ持たせる。
+            if (state.size == 0) output << ByteEncoder::emptyInitializer(encoder_format);
+            const auto fragment_length = static_cast<uintmax_t>(output.tellp()) - fragment_offset;
+            output << ByteEncoder::initializerEnd(encoder_format);
+            if (compress_target) output << CompressionRuntime::accessorDefinition(filename, compressed);
+            if (compressed) arena_size += state.size;
+
+            content_crcs[index] = state.reuse ? state.reuse->crc : content.crc;
+            manifest.setEntry(filename, {
+                                  path, state.size, state.mtime,
+                                  state.reuse ? state.reuse->hash : content.hash.digest(), content_crcs[index],
+                                  unit.file_name, fragment_offset, fragment_length, compress_target, stored_size
+                              });
+            finish_file();
+        }
+        if (packed) {
+            if (assembly) {
+                output << AssemblyBackend::packedEnd(pack_size - pack_position, pack_size == 0, pack_table);
             }
-            output.flush();
-        } while (!input.eof());
+            else {
+                write_padding(pack_size);
+                if (pack_size == 0) output << ByteEncoder::emptyInitializer(encoder_format);
+                output << ByteEncoder::initializerEnd(encoder_format) << PackedLayout::table(pack_table);
+            }
+        }
+        if (assembly) output << AssemblyBackend::epilogue();
+        // 分割出力では出力ファイルが多数になり得るため、書き込みが済んだものから閉じる。
+        if (source_file) source_file->close();
+    }
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        if (!inputs[i].alias_of) continue;
+        if (_header_only && !packed) write_alias(i);
+        // 別名のファイルも内容ハッシュを記録し、次回の重複の検出で再利用する。(データ部分は持たない。)
+        const InputState& state = inputs[i];
+        content_crcs[i] = content_crcs[*state.alias_of];
+        manifest.setEntry(resources[i].first, {
+                              resources[i].second, state.size, state.mtime, state.hash, content_crcs[i], "-", 0, 0,
+                              compress_targets[i], 0
+                          });
+    }
+    // エンコードの際に計算した内容ハッシュを、他の出力の重複の検出で再利用する。
+    if (cache) {
+        for (size_t i = 0; i < resources.size(); ++i) {
+            if (!cacheable[i] || inputs[i].alias_of) continue;
+            if (const Manifest::Entry* entry = manifest.findEntry(resources[i].first))
+                cache->storeHash(resources[i].second, entry->hash);
+        }
+    }
+    // 実行時に内容を改めてハッシュせずに済むよう、エンコードの際に計算したCRC32Cを定数として書き込む。
+    // 全体の値は、すべてのリソースの内容を定数名の順に連結したデータのCRC32Cとする。
+    if (_hash && !_declare_only) {
+        header << "// 各リソースの内容のCRC32C (Castagnoli多項式)\n";
+        uint32_t bundle_crc = 0;
+        for (size_t i = 0; i < resources.size(); ++i) {
+            header << std::format("#define HASH_{} 0x{:08x}u\n", resources[i].first, content_crcs[i]);
+            bundle_crc = Crc32c::combine(bundle_crc, content_crcs[i], inputs[i].size);
+        }
+        header << std::format("#define FILE_BUNDLER_BUNDLE_HASH 0x{:08x}u\n\n\n", bundle_crc);
+    }
+    // 索引はすべてのリソースの宣言(ヘッダのみの出力では定義と別名)の後に書き込む。
+    if (_index && !_declare_only) {
+        std::vector<ResourceIndex::Entry> index_entries;
+        index_entries.reserve(resources.size());
+        for (size_t i = 0; i < resources.size(); ++i) {
+            const auto name = index_names.find(resources[i].first);
+            index_entries.push_back({
+                name != index_names.end() ? name->second : resources[i].second.filename().generic_string(),
+                resources[i].first, inputs[i].size, compress_targets[i]
+            });
+        }
+        header << ResourceIndex::definitions(index_entries);
     }
+    if (use_compression && !_declare_only) header << CompressionRuntime::arenaSize(arena_size);
     header << "#endif // RESOURCE_H\n";
+
+    //
+    // 分割出力の場合は、生成したソースファイルの一覧をCMakeから読み込める形式で書き込む。
+    //
+
+    std::unique_ptr<BundleSink::Output> source_list_file;
+    if (sharded) {
+        source_list_file = sink.open(source_list_name);
+        if (!source_list_file) {
+            discard_outputs();
+            return diagnostics.error(5, "出力先ファイルが開けませんでした。", source_list_path);
+        }
+        std::ostream& source_list = source_list_file->stream();
+        source_list << "# This file is auto generated. by net.ln3.file-bundler\n\n"
+            "set(FILE_BUNDLER_RESOURCE_SOURCES\n";
+        for (const auto& unit : units)
+            source_list << std::format("        \"${{CMAKE_CURRENT_LIST_DIR}}/{}\"\n", unit.file_name);
+        source_list << ")\n";
+    }
+
+    //
+    // 出力先に反映する。(ファイルの場合は、内容が変化した出力ファイルのみを置き換える。)
+    //
+
+    bool committed = header_file->commit();
+    for (const auto& source_file : source_files) committed = committed && source_file->commit();
+    if (sharded) committed = committed && source_list_file->commit();
+    if (!committed) {
+        discard_outputs();
+        if (source_list_file) source_list_file->discard();
+        return diagnostics.error(9, "出力先ファイルに書き込めませんでした。");
+    }
+    if (!output_dir.empty()) {
+        // 以前の実行で生成され、今回は生成されなかったソースファイル(分割出力や別の形式の出力)を削除する。
+        if (!(_header_only || _declare_only)) {
+            std::set<std::string> generated;
+            for (const auto& unit : units) generated.insert(unit.file_name);
+            if (sharded) generated.insert(source_list_name);
+            removeStaleOutputs(output_dir, generated);
+        }
+        removeStaleTransformed(transformed_dir, transformed_names);
+    }
+    if (incremental && !_declare_only) {
+        bool recorded = true;
+        for (const auto& unit : units) recorded = recorded && manifest.recordOutput(unit.file_name, output_dir);
+        if (!recorded || !manifest.save(manifest_path))
+            diagnostics.warning("マニフェストを保存できませんでした。次回の実行ではすべてのファイルが再エンコードされます。");
+    }
+    if (deduplicated_count > 0) {
+        diagnostics.info(std::format("{}個のファイルを同一の内容を持つファイルの別名として出力し、{}バイトを削減しました。",
+                                     deduplicated_count, deduplicated_bytes));
+    }
+    for (const auto& state : inputs) stats_.input_bytes += state.size;
+    stats_.file_count = resources.size();
     return 0;
 }
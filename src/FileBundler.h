@@ -8,23 +8,185 @@
 
 #ifndef FILEBUNDLER_H
 #define FILEBUNDLER_H
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <set>
 #include <string>
+#include <string_view>
+#include <vector>
+
+#include "Diagnostics.h"
+
+class BundleCache;
+class BundleSink;
+class IoStats;
+class PhaseTimer;
+class WorkerPool;
 
 
 class FileBundler {
 public:
     struct Options {
         enum Option {
+            /// 定義をresource.hに書き込む。分割出力・アセンブリソース・圧縮を指定した場合は無視される。
             HEADER_ONLY = 0x0001,
             DECLARE_ONLY = 0x0010,
-            ALL_YES = 0x0100
+            ALL_YES = 0x0100,
+            /// 前回の出力を再利用し、変更されたファイルのみをエンコードする。
+            INCREMENTAL = 0x1000,
+            /// 入出力の統計を表示する。
+            STATS = 0x10000,
+            /// ファイル名からリソースを検索する索引(resource_find)を生成する。
+            INDEX = 0x100000,
+            /// 入力ディレクトリのサブディレクトリも再帰的に走査する。
+            RECURSIVE = 0x1000000,
+            /// 各リソースと全体の内容のCRC32C(HASH_～, FILE_BUNDLER_BUNDLE_HASH)をヘッダファイルに書き込む。
+            HASH = 0x10000000
         };
     };
 
-    FileBundler(std::string input_dir_, std::string output_dir_, std::string filelist_path_, int option_);
+    /// 定義を書き込むソースファイルの形式
+    enum class Backend {
+        /// 配列初期化子によるC言語のソースファイル(resource.c)
+        C,
+        /// .incbinでファイルを取り込むアセンブリソース(resource.S)
+        ASSEMBLY
+    };
+
+    /// C言語のソースファイルに書き込むデータ部分の形式
+    enum class Format {
+        /// 符号付き10進数の配列初期化子
+        DECIMAL,
+        /// 符号付き16進数の配列初期化子
+        HEX,
+        /// 文字列リテラル (配列の末尾にNUL文字が1つ付加されます。SIZE_には含まれません。)
+        STRING,
+        /// C23/C++26の#embedディレクティブ
+        EMBED
+    };
+
+    /// 入力ファイルの状態の取得と、小さな入力ファイルの読み込みの方式
+    enum class InputEngine {
+        /// io_uringでまとめて発行する。io_uringが使用できない場合はTHREADSとなる。
+        AUTO,
+        /// 読み込み用のスレッドで先読みする。
+        THREADS,
+        /// 先読みせず、ファイルごとに順に取得・読み込みする。
+        SYNC
+    };
+
+    /// エンコードの前に行うテキスト変換
+    enum class TextTransform {
+        NONE,
+        /// ブロックコメント(/*～*/)を取り除く。
+        BLOCK_COMMENT,
+        /// ブロックコメントと行コメントを取り除く。(C言語、JavaScriptなど。CSSにはBLOCK_COMMENTを用いる。)
+        COMMENTS,
+        /// 文字列の外側の空白を取り除く。
+        JSON,
+        /// コメントを取り除き、空白を詰める。
+        GLSL
+    };
+
+    /// 値を伴う設定
+    struct Parameters {
+        /// エンコードを並列に行うスレッド数
+        unsigned jobs = 1;
+        /// resource.cをファイルサイズの合計が均等になるよう分割する数。0の場合は分割しない。
+        unsigned shard_count = 0;
+        /// trueの場合、resource.cをファイルごとに分割する。(shard_countより優先されます。)
+        bool shard_per_file = false;
+        Backend backend = Backend::C;
+        Format format = Format::DECIMAL;
+        /// trueの場合、すべてのファイルを圧縮の対象とする。
+        bool compress_all = false;
+        /// 圧縮の対象とするファイルの拡張子 (小文字、"."を含まない)
+        std::set<std::string> compress_extensions;
+        /// 処理区間をChrome trace-event形式で書き込むファイル。空の場合は記録しない。
+        std::string trace_path;
+        /// 入力ディレクトリから登録するファイルのglob。空の場合はすべてのファイルを登録する。
+        std::vector<std::string> include_patterns;
+        /// 入力ディレクトリから除外するファイル・ディレクトリのglob
+        std::vector<std::string> exclude_patterns;
+        /// 0以外の場合、すべてのファイルをこの境界(2のべき乗)に揃えて1つの配列に連結する。
+        /// (分割出力と圧縮は無効になります。formatがEMBEDの場合は指定できません。)
+        unsigned pack_alignment = 0;
+        /// 拡張子(小文字、"."を含まない)ごとのテキスト変換。SIZE_～は変換後のサイズとなる。
+        std::map<std::string, TextTransform> transforms;
+        /// transformsに含まれない拡張子のファイルに行うテキスト変換
+        TextTransform default_transform = TextTransform::NONE;
+        /// 複数の出力で共有するキャッシュ。指定した場合はjobsの代わりにキャッシュのスレッドプールを用いる。
+        /// 出力の間、有効である必要があります。(watch()では使用しません。)
+        BundleCache* cache = nullptr;
+        /// 入力ファイルの状態の取得と読み込みの方式。出力される内容はこの値によらず同一です。
+        InputEngine input_engine = InputEngine::AUTO;
+    };
+
+    /// ライブラリとして呼び出す場合に、ファイルの代わりに渡すメモリ上の入力
+    struct MemoryInput {
+        /// 定数名・索引の名前と、テキスト変換・圧縮の対象の判定に用いるファイル名 (例: "shader.glsl")
+        std::string name;
+        /// 内容。bundle()から戻るまで有効である必要があります。
+        std::string_view data;
+    };
+
+    /// ライブラリとして呼び出す場合の入力。コンストラクタで指定した入力ディレクトリ・ファイルリストに加えて登録します。
+    struct Inputs {
+        /// ファイルリストと同様に登録するファイル
+        std::vector<std::filesystem::path> files;
+        std::vector<MemoryInput> memory;
+    };
+
+    /// ライブラリとして呼び出した場合の結果
+    struct Result {
+        /// コマンドラインから実行した場合の終了コード (0は成功)
+        int code = 0;
+        /// 発生したエラー・警告と、--statsの統計などの報告
+        std::vector<Diagnostics::Entry> diagnostics;
+        /// 処理段階(PhaseTimer::Phase)の順の所要時間 (秒)
+        std::vector<double> phase_seconds;
+        /// 入出力の集計(IoStats::Counter)の順の値
+        std::vector<uint64_t> io_counters;
+    };
+
+    FileBundler(std::string input_dir_, std::string output_dir_, std::string filelist_path_, int option_,
+                const Parameters& parameters_);
+
+    /**
+     * @brief ライブラリとして呼び出すためのコンストラクタです。入力はbundle()で指定します。
+     */
+    FileBundler(int option_, const Parameters& parameters_);
 
     [[nodiscard]] int bundle() const;
 
+    /**
+     * @brief ライブラリとして出力します。
+     * @details 標準入出力を使用せず、上書きの確認も行いません。エラー・警告はResultに記録されます。
+     *          統計とトレースは呼び出しごとに記録するため、異なるインスタンスは複数のスレッドから同時に呼び出せます。
+     *          1つのインスタンスは繰り返し呼び出せますが、同じ出力先・トレースのファイルに書き込むため、
+     *          複数のスレッドから同時に呼び出すことはできません。
+     *          sinkがファイル以外の出力先の場合、Options::INCREMENTALは無視され、テキスト変換の結果はメモリ上に保持されます。
+     *          メモリ上の入力(テキスト変換の結果を含む)は、アセンブリソースと#embedによる出力では参照できません。
+     */
+    [[nodiscard]] Result bundle(const Inputs& inputs_, BundleSink& sink_) const;
+
+    /**
+     * @brief 出力した後、入力の変更を検出するたびに再出力します。
+     * @details 登録したファイルは保持し、ファイルの作成・削除やファイルリストの変更があった場合のみ登録し直します。
+     *          上書きの確認は初回の出力でのみ行います。再出力で変更されたファイルのみをエンコードするには、
+     *          Options::INCREMENTALを指定してください。
+     * @return 監視を開始できなかった場合、または初回の出力に失敗した場合のみ戻ります。
+     */
+    [[nodiscard]] int watch() const;
+
+    /**
+     * @brief 登録されるファイルのパスを返します。(メモリ上の入力を除く)
+     * @details 共有キャッシュに、複数の出力から参照される入力を登録するために用います。
+     *          エラー・警告は表示しません。
+     */
+    [[nodiscard]] std::vector<std::filesystem::path> inputPaths() const;
+
     FileBundler() = delete;
     FileBundler(const FileBundler&) = delete;
     FileBundler(FileBundler&&) = delete;
@@ -32,12 +194,110 @@ public:
     FileBundler& operator=(FileBundler&&) = delete;
 
 private:
+    /// --statsで表示する、ファイルごとの書き込みの記録
+    struct FileStats {
+        std::string name;
+        uintmax_t bytes_in;
+        uintmax_t bytes_out;
+        /// データ部分のエンコードの待機を含む、定義の書き込みに要した時間
+        double seconds;
+    };
+
+    /// --statsで表示する、run()の処理の記録
+    struct RunStats {
+        uintmax_t input_bytes = 0;
+        size_t file_count = 0;
+        std::vector<FileStats> files;
+        /// 上書きの確認で出力が取り消された。
+        bool cancelled = false;
+        /// 先読みに用いた方式 (先読みしなかった場合は空)
+        std::string prefetch_backend;
+        /// 先読みの対象としたファイルの延べ数 (ハッシュの計算とエンコードで2回読み込む場合を含む。)
+        size_t prefetched_files = 0;
+        /// 処理段階の所要時間と入出力の集計 (Result::phase_seconds, Result::io_counters)
+        std::vector<double> phase_seconds;
+        std::vector<uint64_t> io_counters;
+    };
+
+    /// 1回のbundle()・watch()で共有する入出力
+    struct Session {
+        const Inputs& inputs;
+        BundleSink& sink;
+        Diagnostics& diagnostics;
+        /// 複数の出力で共有するキャッシュ (使用しない場合はnullptr)
+        BundleCache* cache;
+    };
+
+    /// 登録したバンドル対象のファイル
+    struct Registry {
+        /// 定数名とファイルのパス。定数名の順に出力するため、順序付きのmapで管理する。
+        /// メモリ上の入力はMemoryInput::nameをパスとする。
+        std::map<std::string, std::filesystem::path> files;
+        /// メモリ上の入力の定数名と内容
+        std::map<std::string, std::string_view> contents;
+        /// 索引で検索する名前 (入力ディレクトリから登録したファイルは相対パス)
+        std::map<std::string, std::string> index_names;
+        /// 走査した入力ディレクトリとそのサブディレクトリ
+        std::vector<std::filesystem::path> scanned_directories;
+        /// ファイルリストと、ファイルリストで指定されたファイルの親ディレクトリ (重複を含む場合がある)
+        std::vector<std::filesystem::path> listed_directories;
+    };
+
+    /**
+     * @brief 有効なファイルリスト(0b01)と入力ディレクトリ(0b10)を表す、バンドル対象ファイルの指定モードを返します。
+     */
+    [[nodiscard]] int bundleTargetMode() const;
+
+    /**
+     * @brief ファイルリスト・入力ディレクトリと、sessionの入力からバンドル対象のファイルを登録します。
+     */
+    void registerFiles(WorkerPool& pool_, int bundle_target_mode_, const Session& session_, Registry& registry_) const;
+
+    /**
+     * @brief 計測を開始してrun()を呼び出し、記録と統計を出力します。
+     */
+    [[nodiscard]] int execute(RunStats& stats_, Registry& registry_, const Session& session_, bool registered_,
+                              bool prompt_) const;
+
+    /**
+     * @brief 出力の本体です。
+     * @param registered_ trueの場合、registryを登録し直さずに用いる。
+     * @param prompt_ falseの場合、上書きの確認を行わない。
+     */
+    [[nodiscard]] int run(RunStats& stats_, Registry& registry_, const Session& session_, bool registered_,
+                          bool prompt_) const;
+
+    /**
+     * @brief --statsで表示する統計を文字列にします。
+     */
+    static std::string formatStats(const RunStats& stats_, const IoStats& io_stats_, const PhaseTimer& phase_timer_);
+
     std::string _input_dir;
     std::string _output_dir;
     std::string _filelist_path;
     bool _header_only;
     bool _declare_only;
     bool _all_yes;
+    bool _incremental;
+    bool _stats;
+    bool _index;
+    bool _recursive;
+    bool _hash;
+    unsigned _jobs;
+    unsigned _shard_count;
+    bool _shard_per_file;
+    Backend _backend;
+    Format _format;
+    bool _compress_all;
+    std::set<std::string> _compress_extensions;
+    std::string _trace_path;
+    std::vector<std::string> _include_patterns;
+    std::vector<std::string> _exclude_patterns;
+    unsigned _pack_alignment;
+    std::map<std::string, TextTransform> _transforms;
+    TextTransform _default_transform;
+    BundleCache* _cache;
+    InputEngine _input_engine;
 };
 
 
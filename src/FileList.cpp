@@ -0,0 +1,54 @@
+/**
+ * @file FileList.cpp
+ * @date 26/10/17
+ * @brief ファイルリスト(--filelist)の読み込み
+ * @details 1行に1つのファイルのパスを記述します。空行は無視し、行内の\rは取り除きます。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "FileList.h"
+
+#include <utility>
+
+#include "InputFile.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    /// 1度に読み込むバイト数 (マップできる場合は、この単位で参照するのみで複製しない。)
+    constexpr size_t read_chunk_size = 4 * 1024 * 1024;
+}
+
+bool FileList::load(const fs::path& path_)
+{
+    _arena.clear();
+    _entries.clear();
+    InputFile input;
+    if (!input.open(path_)) return false;
+    // 行は改行と\rを除いて格納するため、ファイルサイズを超えることはない。
+    std::error_code ec;
+    if (const uintmax_t size = fs::file_size(path_, ec); !ec) _arena.reserve(static_cast<size_t>(size));
+    // アリーナは読み込み中に再確保される可能性があるため、行の範囲は位置で記録し、最後にstring_viewにする。
+    std::vector<std::pair<size_t, size_t>> lines;
+    size_t line_begin = 0;
+    auto end_line = [&] {
+        if (_arena.size() > line_begin) lines.emplace_back(line_begin, _arena.size() - line_begin);
+        line_begin = _arena.size();
+    };
+    for (uintmax_t offset = 0;;) {
+        const std::string_view chunk = input.read(offset, read_chunk_size);
+        for (size_t position = 0; position < chunk.size();) {
+            const size_t separator = chunk.find_first_of("\r\n", position);
+            _arena.append(chunk.substr(position, separator - position));
+            if (separator == std::string_view::npos) break;
+            if (chunk[separator] == '\n') end_line();
+            position = separator + 1;
+        }
+        offset += chunk.size();
+        if (chunk.size() < read_chunk_size) break;
+    }
+    end_line();
+    _entries.reserve(lines.size());
+    for (const auto& [begin, length] : lines) _entries.emplace_back(_arena.data() + begin, length);
+    return true;
+}
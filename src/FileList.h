@@ -0,0 +1,46 @@
+/**
+ * @file FileList.h
+ * @date 26/10/17
+ * @brief ファイルリスト(--filelist)の読み込み
+ * @details 1行に1つのファイルのパスを記述します。空行は無視し、行内の\rは取り除きます。
+ *          ファイルはInputFileで読み込みながら1度だけ走査し、各行を1つの領域(アリーナ)へ連続して格納するため、
+ *          数百万行のファイルリストでも行ごとの確保を行いません。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef FILELIST_H
+#define FILELIST_H
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+class FileList {
+public:
+    FileList() = default;
+
+    /**
+     * @brief ファイルリストを読み込みます。以前に読み込んだ内容は破棄します。
+     * @return ファイルを開けなかった場合はfalse
+     */
+    bool load(const std::filesystem::path& path_);
+
+    /**
+     * @brief 記述された順のパスを返します。各要素は、次にload()を呼び出すか破棄するまで有効です。
+     */
+    [[nodiscard]] const std::vector<std::string_view>& entries() const { return _entries; }
+
+    FileList(const FileList&) = delete;
+    FileList(FileList&&) = delete;
+    FileList& operator=(const FileList&) = delete;
+    FileList& operator=(FileList&&) = delete;
+
+private:
+    /// すべての行を連続して格納する領域
+    std::string _arena;
+    std::vector<std::string_view> _entries;
+};
+
+
+#endif //FILELIST_H
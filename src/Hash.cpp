@@ -0,0 +1,273 @@
+/**
+ * @file Hash.cpp
+ * @date 26/10/17
+ * @brief バンドル対象ファイルの内容ハッシュ
+ * @details 外部ライブラリに依存しないXXH64とCRC32Cの実装です。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "Hash.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define FILE_BUNDLER_CRC32C_SSE42
+#define FILE_BUNDLER_TARGET_SSE42 __attribute__((target("sse4.2")))
+#include <nmmintrin.h>
+#elif defined(_M_X64)
+#define FILE_BUNDLER_CRC32C_SSE42
+#define FILE_BUNDLER_TARGET_SSE42
+#include <intrin.h>
+#include <nmmintrin.h>
+#endif
+
+namespace {
+    constexpr uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+    constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+    constexpr uint64_t prime3 = 0x165667B19E3779F9ULL;
+    constexpr uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+    constexpr uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+
+    constexpr uint64_t rotl(const uint64_t x_, const int r_) { return x_ << r_ | x_ >> (64 - r_); }
+
+    // XXH64の定義に合わせ、リトルエンディアンとして読み込む。
+    inline uint64_t read64(const unsigned char* p_)
+    {
+        uint64_t value = 0;
+        for (int i = 7; i >= 0; --i) value = value << 8 | p_[i];
+        return value;
+    }
+
+    inline uint32_t read32(const unsigned char* p_)
+    {
+        return static_cast<uint32_t>(p_[0]) | static_cast<uint32_t>(p_[1]) << 8 |
+            static_cast<uint32_t>(p_[2]) << 16 | static_cast<uint32_t>(p_[3]) << 24;
+    }
+
+    inline uint64_t round(uint64_t acc_, const uint64_t input_)
+    {
+        acc_ += input_ * prime2;
+        acc_ = rotl(acc_, 31);
+        return acc_ * prime1;
+    }
+
+    inline uint64_t mergeRound(uint64_t acc_, const uint64_t value_)
+    {
+        acc_ ^= round(0, value_);
+        return acc_ * prime1 + prime4;
+    }
+
+    /// CRC32Cの生成多項式 (ビット反転表現)
+    constexpr uint32_t crc32c_polynomial = 0x82F63B78u;
+
+    /**
+     * @brief slicing-by-8の表。tables[k][b]は、バイトbの後に0をkバイト続けた場合の剰余です。
+     */
+    constexpr std::array<std::array<uint32_t, 256>, 8> crc32c_tables = [] {
+        std::array<std::array<uint32_t, 256>, 8> tables{};
+        for (uint32_t b = 0; b < 256; ++b) {
+            uint32_t crc = b;
+            for (int i = 0; i < 8; ++i) crc = crc & 1 ? crc >> 1 ^ crc32c_polynomial : crc >> 1;
+            tables[0][b] = crc;
+        }
+        for (size_t k = 1; k < tables.size(); ++k)
+            for (size_t b = 0; b < 256; ++b) tables[k][b] = tables[k - 1][b] >> 8 ^ tables[0][tables[k - 1][b] & 0xFF];
+        return tables;
+    }();
+
+    /**
+     * @brief GF(2)上の多項式a・bの積をCRC32Cの生成多項式で割った剰余を返します。(いずれもビット反転表現)
+     */
+    constexpr uint32_t multiplyModP(const uint32_t a_, uint32_t b_)
+    {
+        uint32_t product = 0;
+        for (uint32_t m = 1u << 31; m != 0; m >>= 1) {
+            if (a_ & m) product ^= b_;
+            b_ = b_ & 1 ? b_ >> 1 ^ crc32c_polynomial : b_ >> 1;
+        }
+        return product;
+    }
+
+    /// x^(2^k)を生成多項式で割った剰余
+    constexpr std::array<uint32_t, 64> crc32c_x2n = [] {
+        std::array<uint32_t, 64> table{};
+        table[0] = 1u << 30;
+        for (size_t k = 1; k < table.size(); ++k) table[k] = multiplyModP(table[k - 1], table[k - 1]);
+        return table;
+    }();
+
+    /**
+     * @brief 反転前後の処理を除いたCRC32Cの値crcに、lengthバイトの0を続けて与えた場合の値を返します。
+     */
+    uint32_t shiftCrc32c(const uint32_t crc_, uintmax_t length_)
+    {
+        uint32_t shift = 1u << 31;
+        for (size_t k = 3; length_ != 0; length_ >>= 1, ++k)
+            if (length_ & 1) shift = multiplyModP(crc32c_x2n[k & 63], shift);
+        return multiplyModP(shift, crc_);
+    }
+
+    /// 反転前後の処理を除いたCRC32Cの計算 (表引き)
+    uint32_t crc32cTable(uint32_t crc_, const unsigned char* p_, size_t size_)
+    {
+        const auto& t = crc32c_tables;
+        for (; size_ >= 8; p_ += 8, size_ -= 8) {
+            crc_ ^= read32(p_);
+            const uint32_t high = read32(p_ + 4);
+            crc_ = t[7][crc_ & 0xFF] ^ t[6][crc_ >> 8 & 0xFF] ^ t[5][crc_ >> 16 & 0xFF] ^ t[4][crc_ >> 24] ^
+                t[3][high & 0xFF] ^ t[2][high >> 8 & 0xFF] ^ t[1][high >> 16 & 0xFF] ^ t[0][high >> 24];
+        }
+        for (; size_ > 0; ++p_, --size_) crc_ = crc_ >> 8 ^ t[0][(crc_ ^ *p_) & 0xFF];
+        return crc_;
+    }
+
+#ifdef FILE_BUNDLER_CRC32C_SSE42
+    /// crc32命令を3系統に分けて発行する最小のバイト数 (系統を結合する手間に見合う大きさ)
+    constexpr size_t crc32c_lanes_min_size = 16 * 1024;
+
+    /// 反転前後の処理を除いたCRC32Cの計算 (crc32命令)
+    FILE_BUNDLER_TARGET_SSE42 uint32_t crc32cSse42(uint32_t crc_, const unsigned char* p_, size_t size_)
+    {
+        auto read = [](const unsigned char* p) {
+            uint64_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        };
+        uint64_t crc = crc_;
+        // crc32命令は1命令の完了を待たずに次の命令を発行できるため、入力を3つに分けて並行に計算し、最後に結合する。
+        if (size_ >= crc32c_lanes_min_size) {
+            const size_t lane = size_ / 3 & ~size_t{7};
+            uint64_t crc1 = 0;
+            uint64_t crc2 = 0;
+            for (size_t i = 0; i < lane; i += 8) {
+                crc = _mm_crc32_u64(crc, read(p_ + i));
+                crc1 = _mm_crc32_u64(crc1, read(p_ + lane + i));
+                crc2 = _mm_crc32_u64(crc2, read(p_ + lane * 2 + i));
+            }
+            crc = shiftCrc32c(static_cast<uint32_t>(crc), lane) ^ crc1;
+            crc = shiftCrc32c(static_cast<uint32_t>(crc), lane) ^ crc2;
+            p_ += lane * 3;
+            size_ -= lane * 3;
+        }
+        for (; size_ >= 8; p_ += 8, size_ -= 8) crc = _mm_crc32_u64(crc, read(p_));
+        auto result = static_cast<uint32_t>(crc);
+        for (; size_ > 0; ++p_, --size_) result = _mm_crc32_u8(result, *p_);
+        return result;
+    }
+
+    bool detectSse42()
+    {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 1);
+        return (info[2] >> 20 & 1) != 0;
+#else
+        return __builtin_cpu_supports("sse4.2");
+#endif
+    }
+
+    const bool has_sse42 = detectSse42();
+#endif
+}
+
+Xxh64::Xxh64(const uint64_t seed_)
+    : _v{seed_ + prime1 + prime2, seed_ + prime2, seed_, seed_ - prime1}, _seed(seed_)
+{
+}
+
+void Xxh64::update(const void* data_, size_t size_)
+{
+    auto p = static_cast<const unsigned char*>(data_);
+    _total_length += size_;
+
+    // 前回の残りと合わせて32バイトに満たない場合はバッファに溜める。
+    if (_buffer_size + size_ < 32) {
+        std::memcpy(_buffer + _buffer_size, p, size_);
+        _buffer_size += size_;
+        return;
+    }
+    if (_buffer_size > 0) {
+        const size_t fill = 32 - _buffer_size;
+        std::memcpy(_buffer + _buffer_size, p, fill);
+        for (int i = 0; i < 4; ++i) _v[i] = round(_v[i], read64(_buffer + i * 8));
+        p += fill;
+        size_ -= fill;
+        _buffer_size = 0;
+    }
+    for (; size_ >= 32; p += 32, size_ -= 32) {
+        _v[0] = round(_v[0], read64(p));
+        _v[1] = round(_v[1], read64(p + 8));
+        _v[2] = round(_v[2], read64(p + 16));
+        _v[3] = round(_v[3], read64(p + 24));
+    }
+    std::memcpy(_buffer, p, size_);
+    _buffer_size = size_;
+}
+
+uint64_t Xxh64::digest() const
+{
+    uint64_t h;
+    if (_total_length >= 32) {
+        h = rotl(_v[0], 1) + rotl(_v[1], 7) + rotl(_v[2], 12) + rotl(_v[3], 18);
+        for (const uint64_t v : _v) h = mergeRound(h, v);
+    }
+    else { h = _seed + prime5; }
+    h += _total_length;
+
+    const unsigned char* p = _buffer;
+    size_t remaining = _buffer_size;
+    for (; remaining >= 8; p += 8, remaining -= 8) {
+        h ^= round(0, read64(p));
+        h = rotl(h, 27) * prime1 + prime4;
+    }
+    if (remaining >= 4) {
+        h ^= static_cast<uint64_t>(read32(p)) * prime1;
+        h = rotl(h, 23) * prime2 + prime3;
+        p += 4;
+        remaining -= 4;
+    }
+    for (; remaining > 0; ++p, --remaining) {
+        h ^= *p * prime5;
+        h = rotl(h, 11) * prime1;
+    }
+
+    h ^= h >> 33;
+    h *= prime2;
+    h ^= h >> 29;
+    h *= prime3;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t Xxh64::hash(const void* data_, const size_t size_, const uint64_t seed_)
+{
+    Xxh64 state(seed_);
+    state.update(data_, size_);
+    return state.digest();
+}
+
+uint32_t Crc32c::update(const uint32_t crc_, const void* data_, const size_t size_)
+{
+    const auto p = static_cast<const unsigned char*>(data_);
+#ifdef FILE_BUNDLER_CRC32C_SSE42
+    if (has_sse42) return ~crc32cSse42(~crc_, p, size_);
+#endif
+    return ~crc32cTable(~crc_, p, size_);
+}
+
+uint32_t Crc32c::combine(const uint32_t crc1_, const uint32_t crc2_, const uintmax_t length2_)
+{
+    // crc(A+B) = crc(A)・x^(Bのビット数) mod P xor crc(B)。crc(A)が0であれば積も0となる。
+    if (crc1_ == 0) return crc2_;
+    return shiftCrc32c(crc1_, length2_) ^ crc2_;
+}
+
+bool Crc32c::isHardwareAccelerated()
+{
+#ifdef FILE_BUNDLER_CRC32C_SSE42
+    return has_sse42;
+#else
+    return false;
+#endif
+}
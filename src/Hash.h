@@ -0,0 +1,78 @@
+/**
+ * @file Hash.h
+ * @date 26/10/17
+ * @brief バンドル対象ファイルの内容ハッシュ
+ * @details 外部ライブラリに依存しないXXH64とCRC32Cの実装です。
+ *          XXH64は前回の出力との比較や重複の検出に、CRC32Cは生成するヘッダファイルのHASH_～に用います。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef HASH_H
+#define HASH_H
+#include <cstddef>
+#include <cstdint>
+
+
+/**
+ * @brief XXH64を逐次計算します。
+ * @details update()で入力を分割して与えても、一括で与えた場合と同じ値になります。
+ */
+class Xxh64 {
+public:
+    explicit Xxh64(uint64_t seed_ = 0);
+
+    void update(const void* data_, size_t size_);
+
+    [[nodiscard]] uint64_t digest() const;
+
+    /**
+     * @brief dataのXXH64を一括で計算します。
+     */
+    static uint64_t hash(const void* data_, size_t size_, uint64_t seed_ = 0);
+
+private:
+    uint64_t _v[4];
+    uint64_t _seed;
+    uint64_t _total_length = 0;
+    unsigned char _buffer[32]{};
+    size_t _buffer_size = 0;
+};
+
+/**
+ * @brief CRC32C(Castagnoli多項式。iSCSIやext4などと同一)を計算します。
+ * @details x86-64でSSE4.2が使用できる場合はcrc32命令で、それ以外は表引き(slicing-by-8)で計算します。
+ *          命令が使用できるかは実行時に判定するため、コンパイル時の指定(-msse4.2など)は不要です。
+ */
+class Crc32c {
+public:
+    /**
+     * @brief crcを計算したデータに続けてdataを与えた場合のCRC32Cを返します。
+     * @param crc_ 先行するデータのCRC32C。0の場合はdataのみのCRC32Cとなります。
+     */
+    static uint32_t update(uint32_t crc_, const void* data_, size_t size_);
+
+    /**
+     * @brief dataのCRC32Cを一括で計算します。
+     */
+    static uint32_t hash(const void* data_, const size_t size_) { return update(0, data_, size_); }
+
+    /**
+     * @brief データAとBを連結したデータのCRC32Cを、それぞれのCRC32CとBのバイト数から求めます。
+     * @details 分割して並列に計算した結果から、全体のCRC32Cを求められます。計算量はlengthの対数に比例します。
+     */
+    static uint32_t combine(uint32_t crc1_, uint32_t crc2_, uintmax_t length2_);
+
+    /**
+     * @brief crc32命令で計算するかを返します。
+     */
+    [[nodiscard]] static bool isHardwareAccelerated();
+
+    Crc32c() = delete;
+    Crc32c(const Crc32c&) = delete;
+    Crc32c(Crc32c&&) = delete;
+    Crc32c& operator=(const Crc32c&) = delete;
+    Crc32c& operator=(Crc32c&&) = delete;
+};
+
+
+#endif //HASH_H
@@ -0,0 +1,174 @@
+/**
+ * @file InputFile.cpp
+ * @date 26/10/17
+ * @brief メモリマップによる入力ファイルの読み込み
+ * @details 通常のファイルはメモリマップし、読み込んだ範囲をバッファへ複製せずに直接参照させます。
+ *          パイプやデバイスファイルなどマップできないファイルは、内部バッファへ順に読み込みます。
+ *          POSIX以外の環境では、常にstd::ifstreamで内部バッファへ読み込みます。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "InputFile.h"
+
+#include <algorithm>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "IoStats.h"
+
+namespace fs = std::filesystem;
+
+InputFile::~InputFile() { close(); }
+
+void InputFile::openMemory(const std::string_view data_)
+{
+    close();
+    _memory = data_;
+    _in_memory = true;
+}
+
+#ifdef _WIN32
+
+bool InputFile::open(const fs::path& path_)
+{
+    close();
+    _stream.open(path_, std::ios::binary);
+    _position = 0;
+    IoStats::add(IoStats::Counter::INPUT_SYSCALLS);
+    return _stream.is_open();
+}
+
+std::string_view InputFile::read(const uintmax_t offset_, const size_t length_)
+{
+    if (_in_memory)
+        return offset_ < _memory.size() ? _memory.substr(static_cast<size_t>(offset_), length_) : std::string_view{};
+    if (_buffer_capacity < length_) {
+        _buffer = std::make_unique_for_overwrite<char[]>(length_);
+        _buffer_capacity = length_;
+    }
+    _stream.clear();
+    _stream.seekg(static_cast<std::streamoff>(offset_));
+    _stream.read(_buffer.get(), static_cast<std::streamsize>(length_));
+    const auto read_size = static_cast<size_t>(_stream.gcount());
+    IoStats::add(IoStats::Counter::INPUT_SYSCALLS);
+    IoStats::add(IoStats::Counter::BYTES_READ, read_size);
+    return {_buffer.get(), read_size};
+}
+
+void InputFile::unmap() {}
+
+void InputFile::close()
+{
+    _in_memory = false;
+    if (!_stream.is_open()) return;
+    _stream.close();
+    IoStats::add(IoStats::Counter::INPUT_SYSCALLS);
+}
+
+#else
+
+bool InputFile::open(const fs::path& path_)
+{
+    close();
+    _fd = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+    IoStats::add(IoStats::Counter::INPUT_SYSCALLS);
+    if (_fd < 0) return false;
+    struct stat st{};
+    IoStats::add(IoStats::Counter::INPUT_SYSCALLS);
+    if (::fstat(_fd, &st) != 0) {
+        close();
+        return false;
+    }
+    _mappable = S_ISREG(st.st_mode);
+    _size = _mappable ? static_cast<uintmax_t>(st.st_size) : 0;
+    _position = 0;
+    return true;
+}
+
+std::string_view InputFile::read(const uintmax_t offset_, const size_t length_)
+{
+    unmap();
+    if (_in_memory)
+        return offset_ < _memory.size() ? _memory.substr(static_cast<size_t>(offset_), length_) : std::string_view{};
+    if (_fd < 0 || length_ == 0) return {};
+
+    if (_mappable) {
+        if (offset_ >= _size) return {};
+        const size_t length = static_cast<size_t>(std::min<uintmax_t>(length_, _size - offset_));
+        // マップの開始位置はページ境界に揃える必要がある。
+        static const auto page_size = static_cast<uintmax_t>(::sysconf(_SC_PAGESIZE));
+        const uintmax_t aligned_offset = offset_ / page_size * page_size;
+        const auto delta = static_cast<size_t>(offset_ - aligned_offset);
+        void* map = ::mmap(nullptr, delta + length, PROT_READ, MAP_PRIVATE, _fd, static_cast<off_t>(aligned_offset));
+        IoStats::add(IoStats::Counter::INPUT_SYSCALLS);
+        if (map != MAP_FAILED) {
+            _map = map;
+            _map_length = delta + length;
+            // セグメントは先頭から順に読まれるため、先読みを積極的に行わせる。
+            ::madvise(_map, _map_length, MADV_SEQUENTIAL);
+            IoStats::add(IoStats::Counter::INPUT_SYSCALLS);
+            IoStats::add(IoStats::Counter::BYTES_MAPPED, length);
+            return {static_cast<const char*>(_map) + delta, length};
+        }
+        // マップに失敗した場合は、内部バッファへの読み込みで代替する。
+    }
+
+    if (_buffer_capacity < length_) {
+        _buffer = std::make_unique_for_overwrite<char[]>(length_);
+        _buffer_capacity = length_;
+    }
+    size_t filled = 0;
+    if (_mappable) {
+        // 通常のファイルは位置を指定して読み込める。
+        while (filled < length_) {
+            const ssize_t result = ::pread(_fd, _buffer.get() + filled, length_ - filled,
+                                           static_cast<off_t>(offset_ + filled));
+            IoStats::add(IoStats::Counter::INPUT_SYSCALLS);
+            if (result <= 0) break;
+            filled += static_cast<size_t>(result);
+        }
+    }
+    else {
+        // パイプなどは先頭から順にしか読み込めないため、offsetまでの内容を読み捨てる。
+        if (offset_ < _position) return {};
+        while (filled < length_) {
+            const bool skipping = _position < offset_;
+            const size_t request = skipping
+                                       ? static_cast<size_t>(std::min<uintmax_t>(offset_ - _position, length_))
+                                       : length_ - filled;
+            const ssize_t result = ::read(_fd, _buffer.get() + (skipping ? 0 : filled), request);
+            IoStats::add(IoStats::Counter::INPUT_SYSCALLS);
+            if (result <= 0) break;
+            _position += static_cast<uintmax_t>(result);
+            if (!skipping) filled += static_cast<size_t>(result);
+        }
+    }
+    IoStats::add(IoStats::Counter::BYTES_READ, filled);
+    return {_buffer.get(), filled};
+}
+
+void InputFile::unmap()
+{
+    if (!_map) return;
+    ::munmap(_map, _map_length);
+    IoStats::add(IoStats::Counter::INPUT_SYSCALLS);
+    _map = nullptr;
+    _map_length = 0;
+}
+
+void InputFile::close()
+{
+    unmap();
+    _in_memory = false;
+    if (_fd < 0) return;
+    ::close(_fd);
+    IoStats::add(IoStats::Counter::INPUT_SYSCALLS);
+    _fd = -1;
+}
+
+#endif
@@ -0,0 +1,85 @@
+/**
+ * @file InputFile.h
+ * @date 26/10/17
+ * @brief メモリマップによる入力ファイルの読み込み
+ * @details 通常のファイルはメモリマップし、読み込んだ範囲をバッファへ複製せずに直接参照させます。
+ *          パイプやデバイスファイルなどマップできないファイルは、内部バッファへ順に読み込みます。
+ *          POSIX以外の環境では、常にstd::ifstreamで内部バッファへ読み込みます。
+ *          ライブラリとして渡されたメモリ上の内容も、同じ手順で読み込めます。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef INPUTFILE_H
+#define INPUTFILE_H
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+
+#ifdef _WIN32
+#include <fstream>
+#endif
+
+
+class InputFile {
+public:
+    InputFile() = default;
+    ~InputFile();
+
+    /**
+     * @brief ファイルを開きます。
+     * @return 開けなかった場合はfalse
+     */
+    bool open(const std::filesystem::path& path_);
+
+    /**
+     * @brief メモリ上の内容を入力とします。read()はdataの範囲を複製せずに返します。
+     * @details dataは閉じるまで有効である必要があります。
+     */
+    void openMemory(std::string_view data_);
+
+    /**
+     * @brief offsetからlengthバイトを取得します。
+     * @details 返す範囲は、次にread()を呼び出すかファイルを閉じるまで有効です。
+     *          マップできないファイルでは、前回読み込んだ範囲より前を読み込むことはできません。
+     * @return 取得した範囲。ファイルの終端に達した場合や読み込みに失敗した場合は、lengthバイトより短くなります。
+     */
+    std::string_view read(uintmax_t offset_, size_t length_);
+
+    /**
+     * @brief 直前のread()がメモリマップによるものであったかを返します。
+     */
+    [[nodiscard]] bool isMapped() const { return _map != nullptr; }
+
+    void close();
+
+    InputFile(const InputFile&) = delete;
+    InputFile(InputFile&&) = delete;
+    InputFile& operator=(const InputFile&) = delete;
+    InputFile& operator=(InputFile&&) = delete;
+
+private:
+    void unmap();
+
+#ifdef _WIN32
+    std::ifstream _stream;
+#else
+    int _fd = -1;
+#endif
+    /// 通常のファイルであればそのサイズ
+    uintmax_t _size = 0;
+    bool _mappable = false;
+    void* _map = nullptr;
+    size_t _map_length = 0;
+    /// マップできないファイルの読み込み先
+    std::unique_ptr<char[]> _buffer;
+    size_t _buffer_capacity = 0;
+    /// マップできないファイルの現在の読み込み位置
+    uintmax_t _position = 0;
+    /// openMemory()で指定された内容
+    std::string_view _memory;
+    bool _in_memory = false;
+};
+
+
+#endif //INPUTFILE_H
@@ -0,0 +1,598 @@
+/**
+ * @file InputPrefetcher.cpp
+ * @date 26/10/17
+ * @brief 小さな入力ファイルの非同期な先読み
+ * @details Linuxではio_uringでstatx・openat・read・closeをまとめて発行し、1回のio_uring_enterで多数のファイルの
+ *          要求を処理します。io_uringはliburingを用いず、システムコールを直接呼び出して使用します。
+ *          io_uringが使用できない環境では、読み込み用のスレッドでopen・pread・closeを並列に行います。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "InputPrefetcher.h"
+
+#include <algorithm>
+#include <chrono>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define FILE_BUNDLER_IO_URING 1
+#include <atomic>
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include "IoStats.h"
+#include "RunContext.h"
+#include "WorkerPool.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    /// THREADSで読み込みを行うスレッド数
+    constexpr unsigned loader_threads = 4;
+    /// io_uringのリングの要素数 (同時に発行する要求の上限)
+    constexpr unsigned ring_entries = 256;
+    /// io_uringで先読みの範囲に補充する最小のファイル数
+    constexpr size_t refill_batch = 64;
+    /// THREADSで状態を取得する場合に、1つのタスクが担当するファイル数
+    constexpr size_t status_chunk_size = 256;
+
+#ifndef _WIN32
+    fs::file_time_type toFileTime(const int64_t seconds_, const int64_t nanoseconds_)
+    {
+        using namespace std::chrono;
+        return file_clock::from_sys(sys_time<nanoseconds>(seconds(seconds_) + nanoseconds(nanoseconds_)));
+    }
+#endif
+
+    /**
+     * @brief ファイルの内容をsizeバイト読み込みます。
+     * @return sizeバイトちょうどを読み込めなかった場合はfalse
+     */
+    bool readWhole(const fs::path& path_, char* buffer_, const uintmax_t size_)
+    {
+#ifdef _WIN32
+        std::ifstream ifs(path_, std::ios::binary);
+        IoStats::add(IoStats::Counter::INPUT_SYSCALLS);
+        if (!ifs) return false;
+        ifs.read(buffer_, static_cast<std::streamsize>(size_));
+        IoStats::add(IoStats::Counter::INPUT_SYSCALLS);
+        IoStats::add(IoStats::Counter::BYTES_READ, static_cast<uint64_t>(ifs.gcount()));
+        return static_cast<uintmax_t>(ifs.gcount()) == size_;
+#else
+        const int fd = ::open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+        IoStats::add(IoStats::Counter::INPUT_SYSCALLS);
+        if (fd < 0) return false;
+        uintmax_t filled = 0;
+        while (filled < size_) {
+            const ssize_t result = ::pread(fd, buffer_ + filled, static_cast<size_t>(size_ - filled),
+                                           static_cast<off_t>(filled));
+            IoStats::add(IoStats::Counter::INPUT_SYSCALLS);
+            if (result <= 0) break;
+            filled += static_cast<uintmax_t>(result);
+        }
+        ::close(fd);
+        IoStats::add(IoStats::Counter::INPUT_SYSCALLS);
+        IoStats::add(IoStats::Counter::BYTES_READ, filled);
+        return filled == size_;
+#endif
+    }
+
+    std::optional<InputPrefetcher::Status> statusOf(const fs::path& path_)
+    {
+#ifdef _WIN32
+        std::error_code ec;
+        const fs::file_status status = fs::status(path_, ec);
+        if (ec) return std::nullopt;
+        InputPrefetcher::Status result;
+        result.regular = fs::is_regular_file(status);
+        if (!result.regular) return result;
+        result.size = fs::file_size(path_, ec);
+        if (!ec) result.mtime = fs::last_write_time(path_, ec);
+        if (ec) return std::nullopt;
+        return result;
+#else
+        struct stat st{};
+        IoStats::add(IoStats::Counter::INPUT_SYSCALLS);
+        if (::stat(path_.c_str(), &st) != 0) return std::nullopt;
+        return InputPrefetcher::Status{
+            static_cast<uintmax_t>(st.st_size), toFileTime(st.st_mtim.tv_sec, st.st_mtim.tv_nsec), S_ISREG(st.st_mode)
+        };
+#endif
+    }
+
+#ifdef FILE_BUNDLER_IO_URING
+    /// user_dataの下位2ビットに格納する、要求の種類
+    enum Operation : uint64_t { OPEN = 0, READ = 1, CLOSE = 2 };
+
+    uint64_t userData(const size_t index_, const Operation operation_)
+    {
+        return static_cast<uint64_t>(index_) << 2 | operation_;
+    }
+#endif
+}
+
+#ifdef FILE_BUNDLER_IO_URING
+
+/// io_uringのSQ・CQをマップし、要求の発行と完了の取り出しを行う。
+class InputPrefetcher::Ring {
+public:
+    explicit Ring(const unsigned entries_)
+    {
+        io_uring_params params{};
+        _fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries_, &params));
+        if (_fd < 0) return;
+        _entries = params.sq_entries;
+        _sq_length = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        _cq_length = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        // 古いカーネルではSQとCQを個別にマップする必要がある。
+        const bool single_map = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_map) _sq_length = _cq_length = std::max(_sq_length, _cq_length);
+        _sq_map = ::mmap(nullptr, _sq_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd,
+                         IORING_OFF_SQ_RING);
+        if (_sq_map == MAP_FAILED) {
+            _sq_map = nullptr;
+            return;
+        }
+        _cq_map = single_map
+                      ? _sq_map
+                      : ::mmap(nullptr, _cq_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd,
+                               IORING_OFF_CQ_RING);
+        if (_cq_map == MAP_FAILED) {
+            _cq_map = nullptr;
+            return;
+        }
+        _sqes_length = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = ::mmap(nullptr, _sqes_length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd,
+                            IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) return;
+        _sqes = static_cast<io_uring_sqe*>(sqes);
+        auto* sq = static_cast<char*>(_sq_map);
+        _sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        _sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        _sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        _sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        auto* cq = static_cast<char*>(_cq_map);
+        _cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        _cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        _cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        _cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        _tail = *_sq_tail;
+    }
+
+    ~Ring()
+    {
+        if (_sqes) ::munmap(_sqes, _sqes_length);
+        if (_cq_map && _cq_map != _sq_map) ::munmap(_cq_map, _cq_length);
+        if (_sq_map) ::munmap(_sq_map, _sq_length);
+        if (_fd >= 0) ::close(_fd);
+    }
+
+    [[nodiscard]] bool valid() const { return _sqes != nullptr; }
+
+    /// 同時に発行できる要求の数 (CQはこの2倍の要素数を持つため、これを超えなければ完了が溢れることはない。)
+    [[nodiscard]] unsigned capacity() const { return _entries; }
+
+    /**
+     * @brief 次に発行する要求を確保します。SQに空きがない場合はnullptrを返します。
+     */
+    io_uring_sqe* next()
+    {
+        if (_tail - std::atomic_ref(*_sq_head).load(std::memory_order_acquire) >= _entries) return nullptr;
+        const unsigned index = _tail & _sq_mask;
+        _sq_array[index] = index;
+        ++_tail;
+        ++_unsubmitted;
+        io_uring_sqe* sqe = &_sqes[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    /**
+     * @brief 確保した要求を発行し、wait個以上の完了を待ちます。
+     * @return io_uring_enterが失敗した場合はfalse
+     */
+    bool submit(const unsigned wait_)
+    {
+        std::atomic_ref(*_sq_tail).store(_tail, std::memory_order_release);
+        for (;;) {
+            const long result = ::syscall(__NR_io_uring_enter, _fd, _unsubmitted, wait_,
+                                          wait_ > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            IoStats::add(IoStats::Counter::INPUT_SYSCALLS);
+            if (result >= 0) {
+                _unsubmitted -= std::min(_unsubmitted, static_cast<unsigned>(result));
+                // 発行のみで中断された場合は、待機をやり直す。
+                if (_unsubmitted == 0 || wait_ == 0) return true;
+                continue;
+            }
+            if (errno != EINTR) return false;
+        }
+    }
+
+    /**
+     * @brief 完了した要求を1つ取り出します。
+     * @return 完了した要求がない場合はfalse
+     */
+    bool pop(io_uring_cqe& cqe_)
+    {
+        const unsigned head = *_cq_head;
+        if (head == std::atomic_ref(*_cq_tail).load(std::memory_order_acquire)) return false;
+        cqe_ = _cqes[head & _cq_mask];
+        std::atomic_ref(*_cq_head).store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    Ring() = delete;
+    Ring(const Ring&) = delete;
+    Ring(Ring&&) = delete;
+    Ring& operator=(const Ring&) = delete;
+    Ring& operator=(Ring&&) = delete;
+
+private:
+    int _fd = -1;
+    unsigned _entries = 0;
+    void* _sq_map = nullptr;
+    size_t _sq_length = 0;
+    void* _cq_map = nullptr;
+    size_t _cq_length = 0;
+    io_uring_sqe* _sqes = nullptr;
+    size_t _sqes_length = 0;
+    unsigned* _sq_head = nullptr;
+    unsigned* _sq_tail = nullptr;
+    unsigned _sq_mask = 0;
+    unsigned* _sq_array = nullptr;
+    unsigned* _cq_head = nullptr;
+    unsigned* _cq_tail = nullptr;
+    unsigned _cq_mask = 0;
+    io_uring_cqe* _cqes = nullptr;
+    /// 書き込み済みのSQの末尾 (submit()でカーネルに公開する。)
+    unsigned _tail = 0;
+    unsigned _unsubmitted = 0;
+};
+
+#else
+
+class InputPrefetcher::Ring {};
+
+#endif
+
+std::vector<std::optional<InputPrefetcher::Status>> InputPrefetcher::queryStatus(const std::vector<fs::path>& paths_,
+                                                                                  WorkerPool& pool_,
+                                                                                  const Backend backend_)
+{
+    std::vector<std::optional<Status>> results(paths_.size());
+#ifdef FILE_BUNDLER_IO_URING
+    if (backend_ == Backend::IO_URING && !paths_.empty()) {
+        if (Ring ring(std::min<size_t>(ring_entries, paths_.size())); ring.valid()) {
+            // 発行中の要求ごとのstatxの格納先。要求の添字を空いている格納先に割り当てる。
+            auto buffers = std::make_unique<struct statx[]>(ring.capacity());
+            std::vector<size_t> owners(ring.capacity());
+            std::vector<unsigned> free_slots(ring.capacity());
+            for (unsigned i = 0; i < ring.capacity(); ++i) free_slots[i] = ring.capacity() - 1 - i;
+            size_t next = 0;
+            bool failed = false;
+            while (!failed && (next < paths_.size() || free_slots.size() < ring.capacity())) {
+                while (next < paths_.size() && !free_slots.empty()) {
+                    io_uring_sqe* sqe = ring.next();
+                    if (!sqe) break;
+                    const unsigned slot = free_slots.back();
+                    free_slots.pop_back();
+                    owners[slot] = next;
+                    sqe->opcode = IORING_OP_STATX;
+                    sqe->fd = AT_FDCWD;
+                    sqe->addr = reinterpret_cast<uintptr_t>(paths_[next].c_str());
+                    sqe->len = STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME;
+                    sqe->off = reinterpret_cast<uintptr_t>(&buffers[slot]);
+                    sqe->statx_flags = AT_STATX_SYNC_AS_STAT;
+                    sqe->user_data = slot;
+                    ++next;
+                }
+                if (!ring.submit(1)) {
+                    failed = true;
+                    break;
+                }
+                io_uring_cqe cqe{};
+                while (ring.pop(cqe)) {
+                    const auto slot = static_cast<unsigned>(cqe.user_data);
+                    const struct statx& stx = buffers[slot];
+                    if (cqe.res == 0) {
+                        results[owners[slot]] = Status{
+                            stx.stx_size, toFileTime(stx.stx_mtime.tv_sec, stx.stx_mtime.tv_nsec), S_ISREG(stx.stx_mode)
+                        };
+                    }
+                    free_slots.push_back(slot);
+                }
+            }
+            if (!failed) return results;
+            // io_uringが途中で使用できなくなった場合は、発行中の要求が書き込む可能性のあるbuffersを解放せずに残し、
+            // 取得できなかったファイルをスレッドで取得し直す。
+            static_cast<void>(buffers.release());
+        }
+    }
+#endif
+    std::vector<std::future<void>> tasks;
+    for (size_t begin = 0; begin < paths_.size(); begin += status_chunk_size) {
+        const size_t end = std::min(paths_.size(), begin + status_chunk_size);
+        tasks.push_back(pool_.submit([&paths_, &results, begin, end] {
+            for (size_t i = begin; i < end; ++i)
+                if (!results[i]) results[i] = statusOf(paths_[i]);
+        }));
+    }
+    for (auto& task : tasks) task.get();
+    return results;
+}
+
+InputPrefetcher::InputPrefetcher(std::vector<fs::path> paths_, std::vector<uintmax_t> sizes_, const size_t max_files_,
+                                 const uintmax_t max_bytes_, const Backend backend_)
+    : _max_files(std::max<size_t>(max_files_, 1)), _max_bytes(max_bytes_), _backend(Backend::THREADS)
+{
+    _files.resize(paths_.size());
+    for (size_t i = 0; i < paths_.size(); ++i) {
+        _files[i].path = std::move(paths_[i]);
+        _files[i].size = sizes_[i];
+    }
+#ifdef FILE_BUNDLER_IO_URING
+    if (backend_ == Backend::IO_URING) {
+        _ring = std::make_unique<Ring>(ring_entries);
+        if (_ring->valid()) {
+            _backend = Backend::IO_URING;
+            _threads.emplace_back([this, context = RunContext::current()] {
+                const RunContext::Scope scope(context);
+                runRing();
+            });
+            return;
+        }
+        _ring.reset();
+    }
+#else
+    static_cast<void>(backend_);
+#endif
+    const auto thread_count = static_cast<unsigned>(std::min<size_t>(loader_threads, _files.size()));
+    // 読み込みの集計は、先読みを開始したスレッドの出力に加算する。
+    for (unsigned i = 0; i < thread_count; ++i) {
+        _threads.emplace_back([this, context = RunContext::current()] {
+            const RunContext::Scope scope(context);
+            runThread();
+        });
+    }
+}
+
+InputPrefetcher::~InputPrefetcher()
+{
+    {
+        std::lock_guard lock(_mutex);
+        _stopping = true;
+    }
+    _changed.notify_all();
+    for (auto& thread : _threads) thread.join();
+}
+
+std::optional<std::string_view> InputPrefetcher::acquire(const size_t index_)
+{
+    std::unique_lock lock(_mutex);
+    File& file = _files[index_];
+    if (file.state == State::PENDING && !isReachable(index_)) {
+        // 解放を待たなければ読み込めないファイルは、呼び出し元で読み込ませる。
+        file.state = State::SKIPPED;
+        return std::nullopt;
+    }
+    // 範囲に空きができるまで補充を控えている読み込みのスレッドに、直ちに補充させる。
+    ++_waiting;
+    _changed.notify_all();
+    _changed.wait(lock, [&] { return file.state != State::PENDING && file.state != State::LOADING; });
+    --_waiting;
+    if (file.state != State::READY) return std::nullopt;
+    return std::string_view(file.buffer.get(), static_cast<size_t>(file.size));
+}
+
+void InputPrefetcher::release(const size_t index_)
+{
+    {
+        std::lock_guard lock(_mutex);
+        File& file = _files[index_];
+        switch (file.state) {
+        case State::PENDING:
+        case State::SKIPPED:
+            file.state = State::RELEASED;
+            break;
+        case State::LOADING:
+            file.released = true;
+            break;
+        case State::READY:
+        case State::FAILED:
+            drop(file);
+            break;
+        case State::RELEASED:
+            break;
+        }
+    }
+    _changed.notify_all();
+}
+
+std::optional<size_t> InputPrefetcher::claimNext()
+{
+    while (_next < _files.size()) {
+        File& file = _files[_next];
+        if (file.state != State::PENDING) {
+            ++_next;
+            continue;
+        }
+        // 1つ目のファイルは、バイト数の上限を超える場合も読み込む。
+        if (_loaded_files >= _max_files || (_loaded_files > 0 && _loaded_bytes + file.size > _max_bytes))
+            return std::nullopt;
+        file.state = State::LOADING;
+        ++_loaded_files;
+        _loaded_bytes += file.size;
+        return _next++;
+    }
+    return std::nullopt;
+}
+
+bool InputPrefetcher::isReachable(const size_t index_) const
+{
+    if (_loaded_files + (index_ - _next) >= _max_files) return false;
+    uintmax_t bytes = _loaded_bytes;
+    for (size_t i = _next; i <= index_; ++i) {
+        if (_files[i].state != State::PENDING) continue;
+        bytes += _files[i].size;
+        // 1つ目のファイルは、バイト数の上限を超える場合も読み込む。(claimNext()を参照)
+        if (bytes > _max_bytes && !(i == _next && _loaded_files == 0)) return false;
+    }
+    return true;
+}
+
+void InputPrefetcher::finish(const size_t index_, const bool succeeded_)
+{
+    File& file = _files[index_];
+    if (file.released) {
+        drop(file);
+        return;
+    }
+    file.state = succeeded_ ? State::READY : State::FAILED;
+    if (!succeeded_) file.buffer.reset();
+}
+
+void InputPrefetcher::drop(File& file_)
+{
+    file_.buffer.reset();
+    file_.state = State::RELEASED;
+    --_loaded_files;
+    _loaded_bytes -= file_.size;
+}
+
+void InputPrefetcher::runThread()
+{
+    for (;;) {
+        std::optional<size_t> index;
+        std::unique_lock lock(_mutex);
+        _changed.wait(lock, [&] {
+            return _stopping || _next >= _files.size() || (index = claimNext()).has_value();
+        });
+        if (!index) return;
+        File& file = _files[*index];
+        lock.unlock();
+        file.buffer = std::make_unique_for_overwrite<char[]>(static_cast<size_t>(file.size));
+        const bool succeeded = readWhole(file.path, file.buffer.get(), file.size);
+        lock.lock();
+        finish(*index, succeeded);
+        lock.unlock();
+        _changed.notify_all();
+    }
+}
+
+void InputPrefetcher::runRing()
+{
+#ifdef FILE_BUNDLER_IO_URING
+    Ring& ring = *_ring;
+    // 読み込み中のファイルごとに、要求を1つずつ(openat→read→close)発行する。
+    std::vector<int> fds(_files.size(), -1);
+    size_t active = 0;
+    auto prepare_read = [&](const size_t index_) {
+        io_uring_sqe* sqe = ring.next();
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = fds[index_];
+        sqe->addr = reinterpret_cast<uintptr_t>(_files[index_].buffer.get());
+        // 1回で読み込める長さを超えるファイルは、読み込みの失敗として扱われる。
+        sqe->len = static_cast<uint32_t>(std::min<uintmax_t>(_files[index_].size, UINT32_MAX));
+        sqe->off = 0;
+        sqe->user_data = userData(index_, READ);
+    };
+    auto prepare_close = [&](const size_t index_) {
+        io_uring_sqe* sqe = ring.next();
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->fd = fds[index_];
+        sqe->user_data = userData(index_, CLOSE);
+    };
+    // 読み込みの成否 (closeの完了時に確定させる。)
+    std::vector<bool> succeeded(_files.size(), false);
+    std::vector<size_t> finished;
+    for (;;) {
+        {
+            std::unique_lock lock(_mutex);
+            for (;;) {
+                // 解放されたファイルを1つずつ補充すると発行の回数が増えるため、範囲に一定の空きができてから
+                // まとめて補充する。(読み込みを待っているファイルがある場合は直ちに補充する。)
+                const size_t batch = std::min<size_t>(refill_batch, _max_files);
+                if (!_stopping &&
+                    (_loaded_files + batch <= _max_files || _files.size() - _next < batch || _waiting > 0)) {
+                    while (active < ring.capacity()) {
+                        const std::optional<size_t> index = claimNext();
+                        if (!index) break;
+                        File& file = _files[*index];
+                        file.buffer = std::make_unique_for_overwrite<char[]>(static_cast<size_t>(file.size));
+                        io_uring_sqe* sqe = ring.next();
+                        sqe->opcode = IORING_OP_OPENAT;
+                        sqe->fd = AT_FDCWD;
+                        sqe->addr = reinterpret_cast<uintptr_t>(file.path.c_str());
+                        sqe->open_flags = O_RDONLY | O_CLOEXEC;
+                        sqe->user_data = userData(*index, OPEN);
+                        ++active;
+                    }
+                }
+                if (active > 0) break;
+                if (_stopping || _next >= _files.size()) return;
+                _changed.wait(lock);
+            }
+        }
+        if (!ring.submit(static_cast<unsigned>(active))) break;
+        io_uring_cqe cqe{};
+        while (ring.pop(cqe)) {
+            const auto index = static_cast<size_t>(cqe.user_data >> 2);
+            switch (static_cast<Operation>(cqe.user_data & 3)) {
+            case OPEN:
+                if (cqe.res < 0) {
+                    finished.push_back(index);
+                    break;
+                }
+                fds[index] = cqe.res;
+                if (_files[index].size == 0) {
+                    succeeded[index] = true;
+                    prepare_close(index);
+                }
+                else { prepare_read(index); }
+                break;
+            case READ:
+                if (cqe.res > 0) IoStats::add(IoStats::Counter::BYTES_READ, static_cast<uint64_t>(cqe.res));
+                // 途中までしか読み込めなかった場合も失敗とし、呼び出し元での読み込みに任せる。
+                succeeded[index] = cqe.res >= 0 && static_cast<uintmax_t>(cqe.res) == _files[index].size;
+                prepare_close(index);
+                break;
+            default:
+                fds[index] = -1;
+                finished.push_back(index);
+                break;
+            }
+        }
+        if (finished.empty()) continue;
+        {
+            std::lock_guard lock(_mutex);
+            for (const size_t index : finished) finish(index, succeeded[index]);
+        }
+        active -= finished.size();
+        finished.clear();
+        _changed.notify_all();
+    }
+    // io_uringが使用できなくなった場合は、発行中の要求が書き込む可能性のあるバッファを解放せずに失敗とし、
+    // 残りのファイルはスレッドと同じ手順で読み込む。
+    {
+        std::lock_guard lock(_mutex);
+        for (size_t i = 0; i < _files.size(); ++i) {
+            if (_files[i].state != State::LOADING) continue;
+            static_cast<void>(_files[i].buffer.release());
+            finish(i, false);
+        }
+    }
+    _changed.notify_all();
+    runThread();
+#endif
+}
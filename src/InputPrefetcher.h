@@ -0,0 +1,165 @@
+/**
+ * @file InputPrefetcher.h
+ * @date 26/10/17
+ * @brief 小さな入力ファイルの非同期な先読み
+ * @details 多数の小さなファイルを入力とする場合に、ファイルごとのシステムコールの往復を待たないよう、
+ *          ファイルの状態の取得と内容の読み込みをまとめて発行します。
+ *          Linuxではio_uringでstatx・openat・read・closeをまとめて発行し、io_uringが使用できない環境では
+ *          スレッドで並列に処理します。
+ *          内容の読み込みは指定された順にエンコードなどの処理に先行して行い、読み込み済みで解放されていない
+ *          ファイルの数とバイト数を一定に制限します。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef INPUTPREFETCHER_H
+#define INPUTPREFETCHER_H
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+class WorkerPool;
+
+
+class InputPrefetcher {
+public:
+    /// 読み込みに用いる方式
+    enum class Backend {
+        /// io_uringでまとめて発行する。(使用できない場合はTHREADSとなります。)
+        IO_URING,
+        /// 読み込み用のスレッドで並列に処理する。
+        THREADS
+    };
+
+    /// ファイルの状態
+    struct Status {
+        uintmax_t size = 0;
+        std::filesystem::file_time_type mtime;
+        /// 通常のファイルであるか (シンボリックリンクは参照先で判定します。)
+        bool regular = false;
+    };
+
+    /**
+     * @brief ファイルの状態をまとめて取得します。
+     * @details io_uringではstatxをまとめて発行し、THREADSではpoolで並列に取得します。
+     * @return pathsと同じ順の状態。取得できなかったファイルはstd::nullopt
+     */
+    [[nodiscard]] static std::vector<std::optional<Status>> queryStatus(
+        const std::vector<std::filesystem::path>& paths_, WorkerPool& pool_, Backend backend_);
+
+    /**
+     * @brief 先読みを開始します。
+     * @param paths_ 読み込むファイル。この順に読み込みます。
+     * @param sizes_ 各ファイルのサイズ (取得済みの状態)
+     * @param max_files_ 読み込み中と、読み込み済みで解放されていないファイルの数の上限
+     * @param max_bytes_ 同じく、バイト数の上限
+     */
+    InputPrefetcher(std::vector<std::filesystem::path> paths_, std::vector<uintmax_t> sizes_, size_t max_files_,
+                    uintmax_t max_bytes_, Backend backend_);
+    ~InputPrefetcher();
+
+    /**
+     * @brief 実際に用いている方式を返します。
+     */
+    [[nodiscard]] Backend backend() const { return _backend; }
+
+    /**
+     * @brief index番目のファイルの内容を取得します。読み込み中の場合は完了を待ちます。
+     * @details 返す範囲はrelease()を呼び出すまで有効です。
+     *          読み込みが始まっていない場合も、他のファイルの解放を待たずに読み込まれるのであれば完了を待ちます。
+     * @return 他のファイルの解放を待たなければ読み込めない場合と、読み込みに失敗した場合(サイズが変化した場合を含む)は
+     *         std::nullopt。
+     *         この場合、呼び出し元でファイルを読み込んでください。
+     */
+    [[nodiscard]] std::optional<std::string_view> acquire(size_t index_);
+
+    /**
+     * @brief index番目のファイルの内容を解放します。各ファイルにつき1度、acquire()の有無にかかわらず呼び出します。
+     * @details 解放したファイルの分だけ、後続のファイルの先読みが進みます。
+     */
+    void release(size_t index_);
+
+    InputPrefetcher() = delete;
+    InputPrefetcher(const InputPrefetcher&) = delete;
+    InputPrefetcher(InputPrefetcher&&) = delete;
+    InputPrefetcher& operator=(const InputPrefetcher&) = delete;
+    InputPrefetcher& operator=(InputPrefetcher&&) = delete;
+
+private:
+    /// io_uringのリング (io_uringが使用できない環境では使用しません。)
+    class Ring;
+
+    enum class State {
+        /// 読み込みが始まっていない。
+        PENDING,
+        LOADING,
+        READY,
+        FAILED,
+        /// 読み込みが始まる前にacquire()またはrelease()が呼ばれた。(以降は読み込まない。)
+        SKIPPED,
+        RELEASED
+    };
+
+    struct File {
+        std::filesystem::path path;
+        uintmax_t size = 0;
+        State state = State::PENDING;
+        /// 読み込み中にrelease()が呼ばれた。
+        bool released = false;
+        std::unique_ptr<char[]> buffer;
+    };
+
+    /**
+     * @brief 次に読み込むファイルを先読みの範囲に加えます。_mutexを保持して呼び出します。
+     * @return 範囲に空きがないか、読み込むファイルがない場合はstd::nullopt
+     */
+    std::optional<size_t> claimNext();
+
+    /**
+     * @brief 読み込みの始まっていないファイルが、いずれかのファイルの解放を待たずに読み込まれるかを返します。
+     * @details 先読みは順に行うため、先行するファイルと合わせて範囲に収まる場合にtrueとなります。
+     *          _mutexを保持して呼び出します。
+     */
+    [[nodiscard]] bool isReachable(size_t index_) const;
+
+    /**
+     * @brief 読み込みの完了を記録します。_mutexを保持して呼び出します。
+     */
+    void finish(size_t index_, bool succeeded_);
+
+    /**
+     * @brief 読み込んだ内容を破棄し、先読みの範囲から除きます。_mutexを保持して呼び出します。
+     */
+    void drop(File& file_);
+
+    /// 読み込み用のスレッドの処理 (THREADS)
+    void runThread();
+
+    /// io_uringの要求の発行と完了の処理を行うスレッドの処理 (IO_URING)
+    void runRing();
+
+    std::vector<File> _files;
+    size_t _max_files;
+    uintmax_t _max_bytes;
+    Backend _backend;
+    std::mutex _mutex;
+    std::condition_variable _changed;
+    /// 次に読み込みを検討するファイル
+    size_t _next = 0;
+    /// 先読みの範囲にあるファイルの数とバイト数
+    size_t _loaded_files = 0;
+    uintmax_t _loaded_bytes = 0;
+    /// acquire()で読み込みの完了を待っている呼び出し元の数
+    size_t _waiting = 0;
+    bool _stopping = false;
+    std::unique_ptr<Ring> _ring;
+    std::vector<std::thread> _threads;
+};
+
+
+#endif //INPUTPREFETCHER_H
@@ -0,0 +1,49 @@
+/**
+ * @file IoStats.cpp
+ * @date 26/10/17
+ * @brief 入出力のシステムコール数とデータの複製量の集計
+ * @details InputFileとOutputSinkが発行したシステムコールの回数と、ユーザー空間のバッファへ複製したバイト数を数えます。
+ *          カウンタの更新はシステムコール単位であり、データ1バイトごとの処理には含まれません。
+ *          集計は出力ごとのインスタンスに対して行い、加算先は現在のスレッドのRunContextで決まります。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "IoStats.h"
+
+#include <algorithm>
+#include <format>
+
+#include "RunContext.h"
+
+namespace {
+    double toMegaBytes(const uint64_t bytes_) { return static_cast<double>(bytes_) / (1024.0 * 1024.0); }
+}
+
+void IoStats::add(const Counter counter_, const uint64_t value_)
+{
+    if (IoStats* stats = RunContext::current().io_stats)
+        stats->_counters[static_cast<size_t>(counter_)].fetch_add(value_, std::memory_order_relaxed);
+}
+
+uint64_t IoStats::get(const Counter counter_) const
+{
+    return _counters[static_cast<size_t>(counter_)].load(std::memory_order_relaxed);
+}
+
+std::string IoStats::report(const uintmax_t input_bytes_) const
+{
+    // 入力が1MBに満たない場合も、1MBあたりの値は1MBとして計算する。
+    const double input_mb = std::max(toMegaBytes(input_bytes_), 1.0);
+    const uint64_t input_syscalls = get(Counter::INPUT_SYSCALLS);
+    const uint64_t output_syscalls = get(Counter::OUTPUT_SYSCALLS);
+    const uint64_t copied = get(Counter::BYTES_READ) + get(Counter::BYTES_BUFFERED);
+    return std::format("入力: {:.2f} MB (マップ: {:.2f} MB, read: {:.2f} MB)\n", toMegaBytes(input_bytes_),
+                       toMegaBytes(get(Counter::BYTES_MAPPED)), toMegaBytes(get(Counter::BYTES_READ))) +
+        std::format("出力: {:.2f} MB (バッファへの複製: {:.2f} MB)\n", toMegaBytes(get(Counter::BYTES_WRITTEN)),
+                    toMegaBytes(get(Counter::BYTES_BUFFERED))) +
+        std::format("システムコール: 入力 {} ({:.2f}/MB), 出力 {} ({:.2f}/MB)\n", input_syscalls,
+                    static_cast<double>(input_syscalls) / input_mb, output_syscalls,
+                    static_cast<double>(output_syscalls) / input_mb) +
+        std::format("ユーザー空間で複製したバイト数: {:.2f} MB ({:.3f} MB/MB)\n", toMegaBytes(copied),
+                    toMegaBytes(copied) / input_mb);
+}
@@ -0,0 +1,62 @@
+/**
+ * @file IoStats.h
+ * @date 26/10/17
+ * @brief 入出力のシステムコール数とデータの複製量の集計
+ * @details InputFileとOutputSinkが発行したシステムコールの回数と、ユーザー空間のバッファへ複製したバイト数を数えます。
+ *          カウンタの更新はシステムコール単位であり、データ1バイトごとの処理には含まれません。
+ *          集計は出力ごとのインスタンスに対して行い、加算先は現在のスレッドのRunContextで決まります。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef IOSTATS_H
+#define IOSTATS_H
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+
+class IoStats {
+public:
+    enum class Counter {
+        /// 入力ファイルに対するシステムコール (open, fstat, mmap, madvise, munmap, read, close, stat, io_uring_enter)
+        INPUT_SYSCALLS,
+        /// 出力ファイルに対するシステムコール (open, write, writev, close)
+        OUTPUT_SYSCALLS,
+        /// メモリマップで参照した入力のバイト数 (複製を伴わない)
+        BYTES_MAPPED,
+        /// readでユーザー空間のバッファに読み込んだ入力のバイト数
+        BYTES_READ,
+        /// 出力のバッファに複製したバイト数
+        BYTES_BUFFERED,
+        /// 出力ファイルに書き込んだバイト数
+        BYTES_WRITTEN,
+        COUNT
+    };
+
+    IoStats() = default;
+
+    /**
+     * @brief 現在のスレッドのRunContextの集計先に加算します。集計先がない場合は何もしません。
+     */
+    static void add(Counter counter_, uint64_t value_ = 1);
+
+    [[nodiscard]] uint64_t get(Counter counter_) const;
+
+    /**
+     * @brief 集計結果を入力1MBあたりの値とともに表示用の文字列にします。
+     * @param input_bytes_ バンドルしたファイルの合計サイズ
+     */
+    [[nodiscard]] std::string report(uintmax_t input_bytes_) const;
+
+    IoStats(const IoStats&) = delete;
+    IoStats(IoStats&&) = delete;
+    IoStats& operator=(const IoStats&) = delete;
+    IoStats& operator=(IoStats&&) = delete;
+
+private:
+    std::array<std::atomic<uint64_t>, static_cast<size_t>(Counter::COUNT)> _counters{};
+};
+
+
+#endif //IOSTATS_H
@@ -0,0 +1,62 @@
+/**
+ * @file JobsFile.cpp
+ * @date 26/10/17
+ * @brief --jobs-fileで指定する、複数の出力を記述したファイルの読み込み
+ * @details 1行に1つの出力(ジョブ)を、file-bundlerの引数と同じ形式で記述します。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "JobsFile.h"
+
+#include <fstream>
+
+bool JobsFile::load(const std::filesystem::path& path_, std::vector<Job>& jobs_, size_t& error_line_)
+{
+    jobs_.clear();
+    error_line_ = 0;
+    std::ifstream ifs(path_, std::ios::binary);
+    if (!ifs) return false;
+    std::string line;
+    for (size_t number = 1; std::getline(ifs, line); ++number) {
+        if (line.ends_with('\r')) line.pop_back();
+        const size_t first = line.find_first_not_of(" \t");
+        if (first == std::string::npos || line[first] == '#') continue;
+        Job job{number, {}};
+        if (!splitArguments(line, job.arguments)) {
+            error_line_ = number;
+            return false;
+        }
+        jobs_.push_back(std::move(job));
+    }
+    return true;
+}
+
+bool JobsFile::splitArguments(const std::string_view line_, std::vector<std::string>& arguments_)
+{
+    std::string argument;
+    // 引用符で囲まれた空の引数("")も1つの引数とする。
+    bool in_argument = false;
+    char quote = 0;
+    for (size_t i = 0; i < line_.size(); ++i) {
+        const char c = line_[i];
+        if (quote != 0) {
+            if (c == quote) { quote = 0; }
+            else if (quote == '"' && c == '\\' && i + 1 < line_.size() && (line_[i + 1] == '"' || line_[i + 1] == '\\'))
+                argument += line_[++i];
+            else { argument += c; }
+            continue;
+        }
+        if (c == ' ' || c == '\t') {
+            if (in_argument) arguments_.push_back(std::move(argument));
+            argument.clear();
+            in_argument = false;
+            continue;
+        }
+        in_argument = true;
+        if (c == '"' || c == '\'') quote = c;
+        else argument += c;
+    }
+    if (quote != 0) return false;
+    if (in_argument) arguments_.push_back(std::move(argument));
+    return true;
+}
@@ -0,0 +1,49 @@
+/**
+ * @file JobsFile.h
+ * @date 26/10/17
+ * @brief --jobs-fileで指定する、複数の出力を記述したファイルの読み込み
+ * @details 1行に1つの出力(ジョブ)を、file-bundlerの引数と同じ形式で記述します。
+ *          引数は空白で区切り、空白を含む引数は"または'で囲みます。("で囲んだ中では\"と\\を使用できます。)
+ *          空行と、#から始まる行は無視します。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef JOBSFILE_H
+#define JOBSFILE_H
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+class JobsFile {
+public:
+    /// 1つの出力の記述
+    struct Job {
+        /// 記述された行番号 (1から)
+        size_t line;
+        std::vector<std::string> arguments;
+    };
+
+    /**
+     * @brief ファイルを読み込みます。
+     * @param error_line_ 形式が不正な場合に、その行番号を格納する。(ファイルを読み込めない場合は0)
+     * @return ファイルを読み込めないか、形式が不正な場合はfalse
+     */
+    static bool load(const std::filesystem::path& path_, std::vector<Job>& jobs_, size_t& error_line_);
+
+    /**
+     * @brief 1行を引数に分割します。
+     * @return 引用符が閉じられていない場合はfalse
+     */
+    static bool splitArguments(std::string_view line_, std::vector<std::string>& arguments_);
+
+    JobsFile() = delete;
+    JobsFile(const JobsFile&) = delete;
+    JobsFile(JobsFile&&) = delete;
+    JobsFile& operator=(const JobsFile&) = delete;
+    JobsFile& operator=(JobsFile&&) = delete;
+};
+
+
+#endif //JOBSFILE_H
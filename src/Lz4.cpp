@@ -0,0 +1,211 @@
+/**
+ * @file Lz4.cpp
+ * @date 26/10/17
+ * @brief LZ4ブロック形式の圧縮・展開
+ * @details 外部ライブラリに依存しないLZ4ブロック形式の実装です。
+ *          圧縮したリソースは、セグメントごとに独立して圧縮したブロックを連結したストリームとして格納します。
+ *          ストリームの各ブロックは4バイトのヘッダ(リトルエンディアン)で始まります。
+ *          ヘッダの下位31ビットはブロックのバイト数、最上位ビットは圧縮せずに格納したブロックであることを表します。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "Lz4.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+namespace {
+    using Byte = unsigned char;
+
+    /// 一致として扱う最小の長さ
+    constexpr size_t min_match = 4;
+    /// ブロックの末尾のこのバイト数は、必ずリテラルとして格納する。(LZ4の仕様)
+    constexpr size_t last_literals = 5;
+    /// 一致の開始位置は、ブロックの末尾からこのバイト数より前でなければならない。(LZ4の仕様)
+    constexpr size_t match_find_limit = 12;
+    constexpr size_t max_distance = 65535;
+    constexpr int hash_log = 14;
+
+    uint32_t read32(const Byte* p_)
+    {
+        uint32_t value;
+        std::memcpy(&value, p_, sizeof(value));
+        return value;
+    }
+
+    uint32_t hashSequence(const uint32_t sequence_) { return sequence_ * 2654435761u >> (32 - hash_log); }
+
+    /// 15以上の長さを、255ずつの追加バイトとして書き込む。
+    Byte* writeLength(Byte* op_, size_t length_)
+    {
+        for (; length_ >= 255; length_ -= 255) *op_++ = 255;
+        *op_++ = static_cast<Byte>(length_);
+        return op_;
+    }
+
+    Byte* writeSequence(Byte* op_, const Byte* literal_, const size_t literal_length_, const size_t offset_,
+                        const size_t match_length_)
+    {
+        Byte* token = op_++;
+        *token = static_cast<Byte>(std::min<size_t>(literal_length_, 15) << 4);
+        if (literal_length_ >= 15) op_ = writeLength(op_, literal_length_ - 15);
+        std::memcpy(op_, literal_, literal_length_);
+        op_ += literal_length_;
+        if (match_length_ == 0) return op_;
+        *op_++ = static_cast<Byte>(offset_);
+        *op_++ = static_cast<Byte>(offset_ >> 8);
+        const size_t match_code = match_length_ - min_match;
+        *token |= static_cast<Byte>(std::min<size_t>(match_code, 15));
+        if (match_code >= 15) op_ = writeLength(op_, match_code - 15);
+        return op_;
+    }
+
+    /// 15以上の長さの追加バイトを読み込む。終端に達した場合はfalseを返す。
+    bool readLength(const Byte*& ip_, const Byte* end_, size_t& length_)
+    {
+        Byte b;
+        do {
+            if (ip_ == end_) return false;
+            b = *ip_++;
+            length_ += b;
+        }
+        while (b == 255);
+        return true;
+    }
+}
+
+size_t Lz4::compress(const char* data_, const size_t size_, char* dst_)
+{
+    const auto* const src = reinterpret_cast<const Byte*>(data_);
+    const Byte* const end = src + size_;
+    auto* op = reinterpret_cast<Byte*>(dst_);
+    const Byte* anchor = src;
+
+    if (size_ > match_find_limit) {
+        // 4バイトの列のハッシュから、その列が直前に現れた位置(srcからのオフセット)を引く表
+        const auto table = std::make_unique<uint32_t[]>(size_t{1} << hash_log);
+        const Byte* const match_limit = end - last_literals;
+        const Byte* const find_limit = end - match_find_limit;
+        const Byte* ip = src + 1;
+        table[hashSequence(read32(src))] = 0;
+        // 一致が見つからない間は、探索の間隔を徐々に広げる。
+        unsigned misses = 0;
+        while (ip < find_limit) {
+            const uint32_t sequence = read32(ip);
+            const uint32_t h = hashSequence(sequence);
+            const Byte* ref = src + table[h];
+            table[h] = static_cast<uint32_t>(ip - src);
+            if (ref >= ip || static_cast<size_t>(ip - ref) > max_distance || read32(ref) != sequence) {
+                ip += 1 + (misses++ >> 6);
+                continue;
+            }
+            misses = 0;
+            // 一致を前方へ伸ばす。
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                --ip;
+                --ref;
+            }
+            size_t length = min_match;
+            while (ip + length < match_limit && ip[length] == ref[length]) ++length;
+            op = writeSequence(op, anchor, static_cast<size_t>(ip - anchor), static_cast<size_t>(ip - ref), length);
+            ip += length;
+            anchor = ip;
+            if (ip < find_limit) table[hashSequence(read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - src);
+        }
+    }
+    // 最後のシーケンスはリテラルのみとなる。
+    op = writeSequence(op, anchor, static_cast<size_t>(end - anchor), 0, 0);
+    return static_cast<size_t>(op - reinterpret_cast<Byte*>(dst_));
+}
+
+bool Lz4::decompress(const char* data_, const size_t size_, char* dst_, const size_t capacity_, size_t& written_)
+{
+    const auto* ip = reinterpret_cast<const Byte*>(data_);
+    const Byte* const end = ip + size_;
+    auto* const out_begin = reinterpret_cast<Byte*>(dst_);
+    Byte* op = out_begin;
+    Byte* const out_end = op + capacity_;
+
+    while (ip < end) {
+        const Byte token = *ip++;
+        size_t literal_length = token >> 4;
+        if (literal_length == 15 && !readLength(ip, end, literal_length)) return false;
+        if (static_cast<size_t>(end - ip) < literal_length || static_cast<size_t>(out_end - op) < literal_length)
+            return false;
+        std::memcpy(op, ip, literal_length);
+        ip += literal_length;
+        op += literal_length;
+        // 最後のシーケンスはリテラルのみ
+        if (ip == end) break;
+
+        if (end - ip < 2) return false;
+        const size_t offset = ip[0] | static_cast<size_t>(ip[1]) << 8;
+        ip += 2;
+        size_t match_length = (token & 15u) + min_match;
+        if ((token & 15u) == 15 && !readLength(ip, end, match_length)) return false;
+        if (offset == 0 || static_cast<size_t>(op - out_begin) < offset ||
+            static_cast<size_t>(out_end - op) < match_length)
+            return false;
+        const Byte* match = op - offset;
+        if (offset >= match_length) {
+            std::memcpy(op, match, match_length);
+            op += match_length;
+        }
+        else {
+            // 一致の範囲が書き込み中の範囲と重なる場合は、1バイトずつ複製する。
+            for (size_t i = 0; i < match_length; ++i) *op++ = *match++;
+        }
+    }
+    written_ = static_cast<size_t>(op - out_begin);
+    return true;
+}
+
+void Lz4::appendBlock(std::string& stream_, const char* data_, const size_t size_)
+{
+    const size_t header_offset = stream_.size();
+    stream_.resize(header_offset + BLOCK_HEADER_SIZE + compressBound(size_));
+    stream_.resize(header_offset + writeBlock(data_, size_, stream_.data() + header_offset));
+}
+
+size_t Lz4::writeBlock(const char* data_, const size_t size_, char* dst_)
+{
+    size_t length = compress(data_, size_, dst_ + BLOCK_HEADER_SIZE);
+    uint32_t header = static_cast<uint32_t>(length);
+    if (length >= size_) {
+        std::memcpy(dst_ + BLOCK_HEADER_SIZE, data_, size_);
+        length = size_;
+        header = static_cast<uint32_t>(size_) | RAW_BLOCK_FLAG;
+    }
+    for (size_t i = 0; i < BLOCK_HEADER_SIZE; ++i)
+        dst_[i] = static_cast<char>(header >> (i * 8));
+    return BLOCK_HEADER_SIZE + length;
+}
+
+bool Lz4::decompressStream(const char* data_, const size_t size_, char* dst_, const size_t dst_size_)
+{
+    const auto* ip = reinterpret_cast<const Byte*>(data_);
+    const Byte* const end = ip + size_;
+    size_t written = 0;
+    while (static_cast<size_t>(end - ip) >= BLOCK_HEADER_SIZE) {
+        const uint32_t header = ip[0] | static_cast<uint32_t>(ip[1]) << 8 | static_cast<uint32_t>(ip[2]) << 16 |
+            static_cast<uint32_t>(ip[3]) << 24;
+        ip += BLOCK_HEADER_SIZE;
+        const size_t length = header & ~RAW_BLOCK_FLAG;
+        if (static_cast<size_t>(end - ip) < length) return false;
+        if (header & RAW_BLOCK_FLAG) {
+            if (dst_size_ - written < length) return false;
+            std::memcpy(dst_ + written, ip, length);
+            written += length;
+        }
+        else {
+            // ブロックの展開後のサイズは記録しないため、残りの領域を上限として展開する。
+            size_t block_size = 0;
+            if (!decompress(reinterpret_cast<const char*>(ip), length, dst_ + written, dst_size_ - written, block_size))
+                return false;
+            written += block_size;
+        }
+        ip += length;
+    }
+    return ip == end && written == dst_size_;
+}
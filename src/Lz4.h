@@ -0,0 +1,67 @@
+/**
+ * @file Lz4.h
+ * @date 26/10/17
+ * @brief LZ4ブロック形式の圧縮・展開
+ * @details 外部ライブラリに依存しないLZ4ブロック形式の実装です。
+ *          圧縮したリソースは、セグメントごとに独立して圧縮したブロックを連結したストリームとして格納します。
+ *          ストリームの各ブロックは4バイトのヘッダ(リトルエンディアン)で始まります。
+ *          ヘッダの下位31ビットはブロックのバイト数、最上位ビットは圧縮せずに格納したブロックであることを表します。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef LZ4_H
+#define LZ4_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+class Lz4 {
+public:
+    /// ストリームのブロックのヘッダのバイト数
+    static constexpr size_t BLOCK_HEADER_SIZE = 4;
+    /// ブロックのヘッダで、圧縮せずに格納したことを表すビット
+    static constexpr uint32_t RAW_BLOCK_FLAG = 0x80000000u;
+
+    /**
+     * @brief sizeバイトの入力を圧縮した結果の最大バイト数を返します。
+     */
+    static constexpr size_t compressBound(const size_t size_) { return size_ + size_ / 255 + 16; }
+
+    /**
+     * @brief dataをLZ4ブロック形式で圧縮し、dstに書き込みます。
+     * @details dstにはcompressBound(size_)以上の領域が必要です。
+     * @return 書き込んだバイト数
+     */
+    static size_t compress(const char* data_, size_t size_, char* dst_);
+
+    /**
+     * @brief LZ4ブロック形式のデータを展開し、dstに書き込みます。
+     * @param capacity_ dstの大きさ
+     * @param written_ 展開後のバイト数
+     * @return 展開後のサイズがcapacityを超える場合や、不正なデータの場合はfalse
+     */
+    static bool decompress(const char* data_, size_t size_, char* dst_, size_t capacity_, size_t& written_);
+
+    /**
+     * @brief dataを圧縮したブロックをヘッダとともにstreamの末尾に追加します。
+     * @details 圧縮しても小さくならない場合は、圧縮せずに格納します。
+     */
+    static void appendBlock(std::string& stream_, const char* data_, size_t size_);
+
+    /**
+     * @brief dataを圧縮したブロックをヘッダとともにdstに書き込みます。
+     * @details dstにはBLOCK_HEADER_SIZE + compressBound(size_)バイト以上の領域が必要です。
+     * @return 書き込んだバイト数
+     */
+    static size_t writeBlock(const char* data_, size_t size_, char* dst_);
+
+    /**
+     * @brief appendBlockで作成したストリームを展開し、dstに書き込みます。
+     * @return 展開後のサイズの合計がちょうどdst_sizeバイトにならなかった場合や、不正なデータの場合はfalse
+     */
+    static bool decompressStream(const char* data_, size_t size_, char* dst_, size_t dst_size_);
+};
+
+
+#endif //LZ4_H
@@ -0,0 +1,120 @@
+/**
+ * @file Manifest.cpp
+ * @date 26/10/17
+ * @brief インクリメンタルビルド用のマニフェスト
+ * @details 前回の実行で登録した入力ファイルの情報と、生成したデータ部分の出力ファイル上の位置を記録します。
+ *          入力ファイルが変更されていなければ、前回の出力からデータ部分を再利用できます。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "Manifest.h"
+
+#include <format>
+#include <fstream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+    /// マニフェストの形式が変わった場合は更新すること。
+    constexpr auto manifest_signature = "file-bundler-manifest 3";
+}
+
+bool Manifest::load(const fs::path& path_)
+{
+    _options = 0;
+    _entries.clear();
+    _outputs.clear();
+    std::ifstream ifs(path_, std::ios::binary);
+    if (!ifs) return false;
+
+    std::string line;
+    if (!std::getline(ifs, line) || line != manifest_signature) return false;
+    // 各行は「種別 値...」の形式。パスは空白を含み得るため、常に行の最後に置く。
+    while (std::getline(ifs, line)) {
+        std::istringstream iss(line);
+        std::string kind;
+        iss >> kind;
+        if (kind == "options") { iss >> _options; }
+        else if (kind == "output") {
+            std::string name;
+            Output output;
+            iss >> name >> output.size >> output.mtime;
+            _outputs.insert_or_assign(std::move(name), output);
+        }
+        else if (kind == "entry") {
+            std::string name, path;
+            Entry entry;
+            iss >> name >> entry.size >> entry.mtime >> std::hex >> entry.hash >> entry.crc >> std::dec
+                >> entry.fragment_file >> entry.fragment_offset >> entry.fragment_length >> entry.compress
+                >> entry.stored_size;
+            iss.get();
+            std::getline(iss, path);
+            entry.path = fs::path(path);
+            _entries.insert_or_assign(std::move(name), std::move(entry));
+        }
+        else { iss.setstate(std::ios::failbit); }
+        if (iss.fail()) {
+            _entries.clear();
+            _outputs.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Manifest::save(const fs::path& path_) const
+{
+    std::ofstream ofs(path_, std::ios::binary);
+    if (!ofs) return false;
+    ofs << manifest_signature << '\n';
+    ofs << std::format("options {}\n", _options);
+    for (const auto& [name, output] : _outputs)
+        ofs << std::format("output {} {} {}\n", name, output.size, output.mtime);
+    for (const auto& [name, entry] : _entries) {
+        ofs << std::format("entry {} {} {} {:016x} {:08x} {} {} {} {:d} {} {}\n", name, entry.size, entry.mtime,
+                           entry.hash, entry.crc, entry.fragment_file, entry.fragment_offset, entry.fragment_length,
+                           entry.compress, entry.stored_size, entry.path.generic_string());
+    }
+    ofs.close();
+    return !ofs.fail();
+}
+
+const Manifest::Entry* Manifest::findEntry(const std::string& name_) const
+{
+    const auto it = _entries.find(name_);
+    return it == _entries.end() ? nullptr : &it->second;
+}
+
+void Manifest::setEntry(const std::string& name_, Entry entry_) { _entries.insert_or_assign(name_, std::move(entry_)); }
+
+bool Manifest::isOutputUnchanged(const std::string& name_, const fs::path& output_dir_) const
+{
+    const auto it = _outputs.find(name_);
+    if (it == _outputs.end()) return false;
+    std::error_code ec;
+    const fs::path path = output_dir_ / name_;
+    const auto size = fs::file_size(path, ec);
+    if (ec) return false;
+    const auto mtime = fs::last_write_time(path, ec);
+    if (ec) return false;
+    return size == it->second.size && toMtime(mtime) == it->second.mtime;
+}
+
+bool Manifest::recordOutput(const std::string& name_, const fs::path& output_dir_)
+{
+    std::error_code ec;
+    const fs::path path = output_dir_ / name_;
+    Output output;
+    output.size = fs::file_size(path, ec);
+    if (ec) return false;
+    output.mtime = toMtime(fs::last_write_time(path, ec));
+    if (ec) return false;
+    _outputs.insert_or_assign(name_, output);
+    return true;
+}
+
+int64_t Manifest::toMtime(const fs::file_time_type time_)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time_.time_since_epoch()).count();
+}
@@ -0,0 +1,96 @@
+/**
+ * @file Manifest.h
+ * @date 26/10/17
+ * @brief インクリメンタルビルド用のマニフェスト
+ * @details 前回の実行で登録した入力ファイルの情報と、生成したデータ部分の出力ファイル上の位置を記録します。
+ *          入力ファイルが変更されていなければ、前回の出力からデータ部分を再利用できます。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef MANIFEST_H
+#define MANIFEST_H
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+
+
+class Manifest {
+public:
+    /// 出力先ディレクトリに保存されるマニフェストのファイル名
+    static constexpr auto FILE_NAME = ".file-bundler-manifest";
+
+    /// 入力ファイル1つ分の記録
+    struct Entry {
+        std::filesystem::path path;
+        uintmax_t size = 0;
+        int64_t mtime = 0;
+        uint64_t hash = 0;
+        /// 内容のCRC32C (--hashを指定しなかった場合は0)
+        uint32_t crc = 0;
+        /// データ部分(配列初期化子の{}の内側)を書き込んだ出力ファイル名
+        std::string fragment_file;
+        uintmax_t fragment_offset = 0;
+        uintmax_t fragment_length = 0;
+        /// 圧縮の対象であったか
+        bool compress = false;
+        /// 圧縮して格納した場合は、圧縮後のサイズ(ZSIZE_～)。圧縮せずに格納した場合は0
+        uintmax_t stored_size = 0;
+    };
+
+    /// 出力ファイル1つ分の記録
+    struct Output {
+        uintmax_t size = 0;
+        int64_t mtime = 0;
+    };
+
+    /**
+     * @brief マニフェストを読み込みます。
+     * @return ファイルが存在しないか、形式が不正な場合はfalse (内容は空になります。)
+     */
+    bool load(const std::filesystem::path& path_);
+
+    /**
+     * @brief マニフェストを保存します。
+     * @return 書き込みに失敗した場合はfalse
+     */
+    [[nodiscard]] bool save(const std::filesystem::path& path_) const;
+
+    /**
+     * @brief 生成時の設定を表す値を取得・設定します。設定が異なる場合、記録されたデータ部分は再利用できません。
+     */
+    [[nodiscard]] int options() const { return _options; }
+    void setOptions(const int options_) { _options = options_; }
+
+    /**
+     * @brief 定数名に対応する記録を返します。存在しない場合はnullptrを返します。
+     */
+    [[nodiscard]] const Entry* findEntry(const std::string& name_) const;
+    void setEntry(const std::string& name_, Entry entry_);
+
+    /**
+     * @brief 出力ファイルが前回の実行から変更されていないかを確認します。
+     * @param name_ 出力ファイル名
+     * @param output_dir_ 出力先ディレクトリ
+     */
+    [[nodiscard]] bool isOutputUnchanged(const std::string& name_, const std::filesystem::path& output_dir_) const;
+
+    /**
+     * @brief 出力ファイルの現在の状態を記録します。
+     * @return ファイルの状態が取得できなかった場合はfalse
+     */
+    bool recordOutput(const std::string& name_, const std::filesystem::path& output_dir_);
+
+    /**
+     * @brief ファイルの更新日時を、マニフェストに記録する整数値として取得します。
+     */
+    static int64_t toMtime(std::filesystem::file_time_type time_);
+
+private:
+    int _options = 0;
+    std::map<std::string, Entry> _entries;
+    std::map<std::string, Output> _outputs;
+};
+
+
+#endif //MANIFEST_H
@@ -0,0 +1,97 @@
+/**
+ * @file OutputFile.cpp
+ * @date 26/10/17
+ * @brief 内容が変化した場合にのみ置き換えられる出力ファイル
+ * @details 一時ファイルに書き込み、commit()の時点で既存のファイルと内容を比較します。
+ *          内容が同一であれば既存のファイルを更新しないため、更新日時が変化せず再コンパイルを避けられます。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "OutputFile.h"
+
+#include <algorithm>
+
+#include "InputFile.h"
+#include "Trace.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    bool isSameContent(const fs::path& lhs_, const fs::path& rhs_)
+    {
+        std::error_code ec;
+        const auto lhs_size = fs::file_size(lhs_, ec);
+        if (ec) return false;
+        const auto rhs_size = fs::file_size(rhs_, ec);
+        if (ec || lhs_size != rhs_size) return false;
+
+        InputFile lhs, rhs;
+        if (!lhs.open(lhs_) || !rhs.open(rhs_)) return false;
+        constexpr size_t segment_size = 1024 * 1024;
+        for (uintmax_t offset = 0; offset < lhs_size; offset += segment_size) {
+            const auto length = static_cast<size_t>(std::min<uintmax_t>(segment_size, lhs_size - offset));
+            const std::string_view lhs_data = lhs.read(offset, length);
+            const std::string_view rhs_data = rhs.read(offset, length);
+            if (lhs_data.size() != length || lhs_data != rhs_data) return false;
+        }
+        return true;
+    }
+}
+
+OutputFile::OutputFile(fs::path path_)
+    : _path(std::move(path_)), _temp_path(_path), _stream(&_sink)
+{
+    _temp_path += ".tmp";
+}
+
+OutputFile::~OutputFile() { if (_pending) discard(); }
+
+bool OutputFile::open()
+{
+    _stream.clear();
+    _pending = _sink.open(_temp_path);
+    _write_failed = false;
+    if (!_pending) _stream.setstate(std::ios::failbit);
+    return _pending;
+}
+
+void OutputFile::close()
+{
+    if (!_sink.isOpen()) return;
+    const bool closed = _sink.close();
+    _write_failed = _write_failed || !closed || _stream.fail();
+}
+
+bool OutputFile::commit()
+{
+    if (!_pending) return false;
+    Trace::Span span("commit");
+    close();
+    if (_write_failed) {
+        discard();
+        return false;
+    }
+    _pending = false;
+    std::error_code ec;
+    if (isSameContent(_temp_path, _path)) {
+        fs::remove(_temp_path, ec);
+        _changed = false;
+        return true;
+    }
+    fs::rename(_temp_path, _path, ec);
+    if (ec) {
+        fs::remove(_temp_path, ec);
+        return false;
+    }
+    _changed = true;
+    return true;
+}
+
+void OutputFile::discard()
+{
+    if (!_pending) return;
+    _pending = false;
+    _sink.close();
+    std::error_code ec;
+    fs::remove(_temp_path, ec);
+}
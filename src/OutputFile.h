@@ -0,0 +1,75 @@
+/**
+ * @file OutputFile.h
+ * @date 26/10/17
+ * @brief 内容が変化した場合にのみ置き換えられる出力ファイル
+ * @details 一時ファイルに書き込み、commit()の時点で既存のファイルと内容を比較します。
+ *          内容が同一であれば既存のファイルを更新しないため、更新日時が変化せず再コンパイルを避けられます。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef OUTPUTFILE_H
+#define OUTPUTFILE_H
+#include <filesystem>
+#include <ostream>
+
+#include "OutputSink.h"
+
+
+class OutputFile {
+public:
+    explicit OutputFile(std::filesystem::path path_);
+    ~OutputFile();
+
+    /**
+     * @brief 一時ファイルを開きます。
+     * @return 開けなかった場合はfalse
+     */
+    bool open();
+
+    [[nodiscard]] bool isOpen() const { return _sink.isOpen(); }
+
+    std::ostream& stream() { return _stream; }
+
+    const std::filesystem::path& path() const { return _path; }
+
+    /**
+     * @brief 一時ファイルを閉じます。出力先への反映はcommit()で行います。
+     */
+    void close();
+
+    /**
+     * @brief 書き込んだ内容を出力先に反映します。
+     * @details 既存のファイルと内容が同一の場合は、既存のファイルを変更しません。
+     * @return 書き込みに失敗した場合はfalse
+     */
+    bool commit();
+
+    /**
+     * @brief 書き込んだ内容を破棄します。既存のファイルは変更されません。
+     */
+    void discard();
+
+    /**
+     * @brief 直前のcommit()で出力先が更新されたかを返します。
+     */
+    [[nodiscard]] bool isChanged() const { return _changed; }
+
+    OutputFile() = delete;
+    OutputFile(const OutputFile&) = delete;
+    OutputFile(OutputFile&&) = delete;
+    OutputFile& operator=(const OutputFile&) = delete;
+    OutputFile& operator=(OutputFile&&) = delete;
+
+private:
+    std::filesystem::path _path;
+    std::filesystem::path _temp_path;
+    OutputSink _sink;
+    std::ostream _stream;
+    /// 一時ファイルが存在し、まだ反映も破棄もされていない
+    bool _pending = false;
+    bool _write_failed = false;
+    bool _changed = false;
+};
+
+
+#endif //OUTPUTFILE_H
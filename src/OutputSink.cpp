@@ -0,0 +1,155 @@
+/**
+ * @file OutputSink.cpp
+ * @date 26/10/17
+ * @brief 大きなバッファを持つ出力ファイルのストリームバッファ
+ * @details 小さな書き込みは1MiBのバッファにまとめ、バッファが一杯になるか閉じる時点でのみ書き出します。
+ *          バッファの大きさの半分以上の書き込みはバッファへ複製せず、バッファの内容と合わせてwritevで直接書き出します。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "OutputSink.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#include "IoStats.h"
+#include "Trace.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    /// 1回のシステムコールで書き込む最大のバイト数 (32bitのサイズ引数でも扱える大きさ)
+    constexpr size_t max_write_size = 1u << 30;
+
+    /// sizeバイトをすべて書き込む。
+    bool writeAll(const int fd_, const char* data_, size_t size_)
+    {
+        while (size_ > 0) {
+            const size_t request = std::min(size_, max_write_size);
+#ifdef _WIN32
+            const int result = ::_write(fd_, data_, static_cast<unsigned>(request));
+#else
+            const ssize_t result = ::write(fd_, data_, request);
+#endif
+            IoStats::add(IoStats::Counter::OUTPUT_SYSCALLS);
+            if (result <= 0) return false;
+            data_ += result;
+            size_ -= static_cast<size_t>(result);
+            IoStats::add(IoStats::Counter::BYTES_WRITTEN, static_cast<uint64_t>(result));
+        }
+        return true;
+    }
+}
+
+OutputSink::~OutputSink() { close(); }
+
+bool OutputSink::open(const fs::path& path_)
+{
+    close();
+#ifdef _WIN32
+    _fd = ::_wopen(path_.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    _fd = ::open(path_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+#endif
+    IoStats::add(IoStats::Counter::OUTPUT_SYSCALLS);
+    if (_fd < 0) return false;
+    if (!_buffer) _buffer = std::make_unique_for_overwrite<char[]>(BUFFER_SIZE);
+    setp(_buffer.get(), _buffer.get() + BUFFER_SIZE);
+    _written = 0;
+    _failed = false;
+    return true;
+}
+
+bool OutputSink::close()
+{
+    if (_fd < 0) return !_failed;
+    writeOut(nullptr, 0);
+#ifdef _WIN32
+    ::_close(_fd);
+#else
+    ::close(_fd);
+#endif
+    IoStats::add(IoStats::Counter::OUTPUT_SYSCALLS);
+    _fd = -1;
+    setp(nullptr, nullptr);
+    return !_failed;
+}
+
+bool OutputSink::writeOut(const char* data_, const size_t size_)
+{
+    const auto buffered = static_cast<size_t>(pptr() - pbase());
+    if (_fd < 0 || _failed) return false;
+    Trace::Span span("flush");
+    span.setBytes(0, buffered + size_);
+    bool success;
+#ifdef _WIN32
+    success = writeAll(_fd, pbase(), buffered) && writeAll(_fd, data_, size_);
+#else
+    if (buffered > 0 && size_ > 0 && size_ <= max_write_size) {
+        // バッファの内容と大きな書き込みを1回のシステムコールで書き出す。
+        iovec iov[2] = {{pbase(), buffered}, {const_cast<char*>(data_), size_}};
+        const ssize_t result = ::writev(_fd, iov, 2);
+        IoStats::add(IoStats::Counter::OUTPUT_SYSCALLS);
+        const size_t total = buffered + size_;
+        if (result < 0) { success = false; }
+        else {
+            IoStats::add(IoStats::Counter::BYTES_WRITTEN, static_cast<uint64_t>(result));
+            // 一部のみ書き込まれた場合は、残りを書き込む。
+            const auto written = static_cast<size_t>(result);
+            success = written >= buffered
+                          ? writeAll(_fd, data_ + (written - buffered), total - written)
+                          : writeAll(_fd, pbase() + written, buffered - written) && writeAll(_fd, data_, size_);
+        }
+    }
+    else { success = writeAll(_fd, pbase(), buffered) && writeAll(_fd, data_, size_); }
+#endif
+    _written += buffered + size_;
+    setp(_buffer.get(), _buffer.get() + BUFFER_SIZE);
+    _failed = !success;
+    return success;
+}
+
+OutputSink::int_type OutputSink::overflow(const int_type c_)
+{
+    if (!writeOut(nullptr, 0)) return traits_type::eof();
+    if (traits_type::eq_int_type(c_, traits_type::eof())) return traits_type::not_eof(c_);
+    *pptr() = traits_type::to_char_type(c_);
+    pbump(1);
+    return c_;
+}
+
+std::streamsize OutputSink::xsputn(const char* s_, const std::streamsize n_)
+{
+    const auto size = static_cast<size_t>(n_);
+    const auto available = static_cast<size_t>(epptr() - pptr());
+    // 大きな書き込みはバッファを経由せずに書き出す。
+    if (size >= BUFFER_SIZE / 2) return writeOut(s_, size) ? n_ : 0;
+    if (size > available && !writeOut(nullptr, 0)) return 0;
+    std::memcpy(pptr(), s_, size);
+    pbump(static_cast<int>(size));
+    IoStats::add(IoStats::Counter::BYTES_BUFFERED, size);
+    return n_;
+}
+
+int OutputSink::sync()
+{
+    // 明示的なflushでも書き出さず、バッファが一杯になるか閉じる時点でまとめて書き出す。
+    return _failed ? -1 : 0;
+}
+
+OutputSink::pos_type OutputSink::seekoff(const off_type off_, const std::ios_base::seekdir dir_,
+                                         const std::ios_base::openmode which_)
+{
+    // tellp()による現在位置の取得のみに対応する。
+    if (off_ != 0 || dir_ != std::ios_base::cur || !(which_ & std::ios_base::out)) return {off_type(-1)};
+    return {static_cast<off_type>(_written + static_cast<uintmax_t>(pptr() - pbase()))};
+}
@@ -0,0 +1,63 @@
+/**
+ * @file OutputSink.h
+ * @date 26/10/17
+ * @brief 大きなバッファを持つ出力ファイルのストリームバッファ
+ * @details 小さな書き込みは1MiBのバッファにまとめ、バッファが一杯になるか閉じる時点でのみ書き出します。
+ *          バッファの大きさの半分以上の書き込みはバッファへ複製せず、バッファの内容と合わせてwritevで直接書き出します。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef OUTPUTSINK_H
+#define OUTPUTSINK_H
+#include <filesystem>
+#include <memory>
+#include <streambuf>
+
+
+class OutputSink : public std::streambuf {
+public:
+    static constexpr size_t BUFFER_SIZE = 1024 * 1024;
+
+    OutputSink() = default;
+    ~OutputSink() override;
+
+    /**
+     * @brief ファイルを作成して開きます。既存のファイルは切り詰められます。
+     * @return 開けなかった場合はfalse
+     */
+    bool open(const std::filesystem::path& path_);
+
+    [[nodiscard]] bool isOpen() const { return _fd >= 0; }
+
+    /**
+     * @brief バッファの内容を書き出して閉じます。
+     * @return 書き込みに失敗していた場合はfalse
+     */
+    bool close();
+
+    OutputSink(const OutputSink&) = delete;
+    OutputSink(OutputSink&&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+    OutputSink& operator=(OutputSink&&) = delete;
+
+protected:
+    int_type overflow(int_type c_) override;
+    std::streamsize xsputn(const char* s_, std::streamsize n_) override;
+    int sync() override;
+    pos_type seekoff(off_type off_, std::ios_base::seekdir dir_, std::ios_base::openmode which_) override;
+
+private:
+    /**
+     * @brief バッファの内容とdataを続けて書き出します。
+     */
+    bool writeOut(const char* data_, size_t size_);
+
+    int _fd = -1;
+    std::unique_ptr<char[]> _buffer;
+    /// ファイルに書き出したバイト数
+    uintmax_t _written = 0;
+    bool _failed = false;
+};
+
+
+#endif //OUTPUTSINK_H
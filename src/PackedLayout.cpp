@@ -0,0 +1,61 @@
+/**
+ * @file PackedLayout.cpp
+ * @date 26/10/17
+ * @brief すべてのファイルを1つの配列に連結する出力(--pack)の生成
+ * @details ファイルごとの配列の代わりに、すべてのファイルを定数名の順に連結した配列file_bundler_blobと、
+ *          各ファイルのオフセットとサイズの表file_bundler_pack_tableを生成します。
+ *          F_～とSIZE_～はfile_bundler_blob内の位置とサイズを表すマクロとなるため、
+ *          ファイル数によらずシンボルは2つのみとなり、リンク時の処理が軽減されます。
+ *          各ファイルは指定した境界に配置し、間は0で埋めます。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "PackedLayout.h"
+
+#include <format>
+
+bool PackedLayout::isValidAlignment(const unsigned alignment_)
+{
+    return alignment_ > 0 && alignment_ <= MAX_ALIGNMENT && (alignment_ & (alignment_ - 1)) == 0;
+}
+
+std::string PackedLayout::declarations(const unsigned alignment_, const uintmax_t length_, const size_t count_)
+{
+    std::string result = "// すべてのファイルを連結したデータ (各ファイルはFILE_BUNDLER_PACK_ALIGNMENTバイト境界に配置)\n" +
+        std::format("#define FILE_BUNDLER_PACK_ALIGNMENT {}\n", alignment_) +
+        std::format("#define FILE_BUNDLER_PACK_LENGTH {}\n", length_) +
+        std::format("#define FILE_BUNDLER_PACK_COUNT {}\n", count_) +
+        "#if defined(__cplusplus)\n"
+        "#define FILE_BUNDLER_PACK_ALIGNED alignas(FILE_BUNDLER_PACK_ALIGNMENT)\n"
+        "#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L\n"
+        "#define FILE_BUNDLER_PACK_ALIGNED _Alignas(FILE_BUNDLER_PACK_ALIGNMENT)\n"
+        "#elif defined(_MSC_VER)\n"
+        "#define FILE_BUNDLER_PACK_ALIGNED __declspec(align(FILE_BUNDLER_PACK_ALIGNMENT))\n"
+        "#else\n"
+        "#define FILE_BUNDLER_PACK_ALIGNED __attribute__((aligned(FILE_BUNDLER_PACK_ALIGNMENT)))\n"
+        "#endif\n"
+        // 要素数を宣言するため、C++ではF_～をコンパイル時の定数式としても扱える。
+        "extern const char file_bundler_blob[FILE_BUNDLER_PACK_LENGTH];\n";
+    // 各ファイルのオフセットとサイズ (定数名の順)
+    if (count_ > 0) result += "extern const unsigned long long file_bundler_pack_table[FILE_BUNDLER_PACK_COUNT][2];\n";
+    return result + "\n\n";
+}
+
+std::string PackedLayout::accessor(const std::string& name_, const uintmax_t offset_, const uintmax_t size_)
+{
+    return std::format("#define SIZE_{} {}ULL\n", name_, size_) +
+        std::format("#define F_{} (file_bundler_blob + {})\n\n\n", name_, offset_);
+}
+
+std::string PackedLayout::blobBegin()
+{
+    return "FILE_BUNDLER_PACK_ALIGNED const char file_bundler_blob[FILE_BUNDLER_PACK_LENGTH] =";
+}
+
+std::string PackedLayout::table(const std::vector<TableEntry>& entries_)
+{
+    if (entries_.empty()) return {};
+    std::string result = "const unsigned long long file_bundler_pack_table[FILE_BUNDLER_PACK_COUNT][2] = {\n";
+    for (const auto& [offset, size] : entries_) result += std::format("    {{{}, {}}},\n", offset, size);
+    return result + "};\n\n\n";
+}
@@ -0,0 +1,64 @@
+/**
+ * @file PackedLayout.h
+ * @date 26/10/17
+ * @brief すべてのファイルを1つの配列に連結する出力(--pack)の生成
+ * @details ファイルごとの配列の代わりに、すべてのファイルを定数名の順に連結した配列file_bundler_blobと、
+ *          各ファイルのオフセットとサイズの表file_bundler_pack_tableを生成します。
+ *          F_～とSIZE_～はfile_bundler_blob内の位置とサイズを表すマクロとなるため、
+ *          ファイル数によらずシンボルは2つのみとなり、リンク時の処理が軽減されます。
+ *          各ファイルは指定した境界に配置し、間は0で埋めます。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef PACKEDLAYOUT_H
+#define PACKEDLAYOUT_H
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+class PackedLayout {
+public:
+    /// 指定できる境界の最大値
+    static constexpr unsigned MAX_ALIGNMENT = 4096;
+
+    /// file_bundler_pack_tableの1要素 (オフセット、サイズ)
+    using TableEntry = std::pair<uintmax_t, uintmax_t>;
+
+    /**
+     * @brief alignmentが1以上MAX_ALIGNMENT以下の2のべき乗であるかを返します。
+     */
+    static bool isValidAlignment(unsigned alignment_);
+
+    static uintmax_t alignUp(const uintmax_t offset_, const unsigned alignment_)
+    {
+        return (offset_ + alignment_ - 1) / alignment_ * alignment_;
+    }
+
+    /**
+     * @brief ヘッダファイルに書き込む、file_bundler_blobとfile_bundler_pack_tableの宣言を返します。
+     * @param length_ file_bundler_blobの要素数 (末尾の余白と、文字列リテラルのNUL文字を含む)
+     * @param count_ ファイル数 (別名を含む)
+     */
+    static std::string declarations(unsigned alignment_, uintmax_t length_, size_t count_);
+
+    /**
+     * @brief 1ファイル分のF_～とSIZE_～のマクロを返します。
+     */
+    static std::string accessor(const std::string& name_, uintmax_t offset_, uintmax_t size_);
+
+    /**
+     * @brief file_bundler_blobの定義の、データ部分の前までを返します。(C言語のソースファイル用)
+     */
+    static std::string blobBegin();
+
+    /**
+     * @brief file_bundler_pack_tableの定義を返します。(C言語のソースファイル用)
+     * @details ファイルが存在しない場合は空文字列を返します。
+     */
+    static std::string table(const std::vector<TableEntry>& entries_);
+};
+
+
+#endif //PACKEDLAYOUT_H
@@ -0,0 +1,88 @@
+/**
+ * @file PhaseTimer.cpp
+ * @date 26/10/17
+ * @brief FileBundler::bundleの処理段階ごとの所要時間の集計
+ * @details 段階の切り替え時に時刻を取得して経過時間を加算するため、計測の負荷は段階の数にのみ比例します。
+ *          区間を入れ子にした場合は、内側の区間の間は外側の段階の計測を中断します。(各段階の時間は排他的です。)
+ *          Traceの記録中は、各段階を入れ子を含めた区間としても記録します。
+ *          集計は出力ごとのインスタンスに対して行い、加算先は区間を構築したスレッドのRunContextで決まります。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "PhaseTimer.h"
+
+#include "RunContext.h"
+#include "Trace.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    /// このスレッドで最も内側の区間
+    thread_local PhaseTimer::Scope* current_scope = nullptr;
+
+    void recordTrace(const PhaseTimer::Phase phase_, const Clock::time_point start_, const Clock::time_point end_)
+    {
+        if (Trace* trace = Trace::current()) trace->record(PhaseTimer::name(phase_).data(), {}, start_, end_);
+    }
+}
+
+PhaseTimer::Scope::Scope(const Phase phase_)
+    : _timer(RunContext::current().phase_timer), _phase(phase_), _outer(current_scope), _start(Clock::now()),
+      _phase_start(_start)
+{
+    if (_outer) {
+        if (_outer->_timer) _outer->_timer->add(_outer->_phase, _outer->_start, _start);
+        _outer->_start = _start;
+    }
+    current_scope = this;
+}
+
+PhaseTimer::Scope::~Scope()
+{
+    const auto now = Clock::now();
+    if (_timer) _timer->add(_phase, _start, now);
+    recordTrace(_phase, _phase_start, now);
+    current_scope = _outer;
+    if (_outer) _outer->_start = now;
+}
+
+void PhaseTimer::Scope::switchTo(const Phase phase_)
+{
+    const auto now = Clock::now();
+    if (_timer) _timer->add(_phase, _start, now);
+    recordTrace(_phase, _phase_start, now);
+    _phase = phase_;
+    _start = now;
+    _phase_start = now;
+}
+
+void PhaseTimer::add(const Phase phase_, const Clock::time_point start_, const Clock::time_point end_)
+{
+    _elapsed_ns[static_cast<size_t>(phase_)].fetch_add(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(end_ - start_).count(), std::memory_order_relaxed);
+}
+
+double PhaseTimer::seconds(const Phase phase_) const
+{
+    return static_cast<double>(_elapsed_ns[static_cast<size_t>(phase_)].load(std::memory_order_relaxed)) / 1e9;
+}
+
+std::string_view PhaseTimer::name(const Phase phase_)
+{
+    switch (phase_) {
+    case Phase::REGISTRATION:
+        return "registration";
+    case Phase::TRANSFORM:
+        return "transform";
+    case Phase::SIZE_QUERY:
+        return "size_query";
+    case Phase::HASH:
+        return "hash";
+    case Phase::ENCODE:
+        return "encode";
+    case Phase::WRITE:
+        return "write";
+    default:
+        return "";
+    }
+}
@@ -0,0 +1,88 @@
+/**
+ * @file PhaseTimer.h
+ * @date 26/10/17
+ * @brief FileBundler::bundleの処理段階ごとの所要時間の集計
+ * @details 段階の切り替え時に時刻を取得して経過時間を加算するため、計測の負荷は段階の数にのみ比例します。
+ *          区間を入れ子にした場合は、内側の区間の間は外側の段階の計測を中断します。(各段階の時間は排他的です。)
+ *          Traceの記録中は、各段階を入れ子を含めた区間としても記録します。
+ *          集計は出力ごとのインスタンスに対して行い、加算先は区間を構築したスレッドのRunContextで決まります。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef PHASETIMER_H
+#define PHASETIMER_H
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+
+class PhaseTimer {
+public:
+    enum class Phase {
+        /// バンドル対象のファイルの登録と上書きの確認
+        REGISTRATION,
+        /// テキスト変換(コメントの除去など)と、変換後のファイルの書き込み
+        TRANSFORM,
+        /// 入力ファイルのサイズと更新日時の取得
+        SIZE_QUERY,
+        /// 重複の検出と再利用の判定のための内容ハッシュの計算
+        HASH,
+        /// 書き込みがエンコード(圧縮・ハッシュ・読み込み)の完了を待った時間
+        ENCODE,
+        /// 出力ファイルへの書き込みと反映
+        WRITE,
+        COUNT
+    };
+
+    /**
+     * @brief 構築からswitchToまたは破棄までの時間を段階に加算する区間です。
+     */
+    class Scope {
+    public:
+        explicit Scope(Phase phase_);
+        ~Scope();
+
+        /**
+         * @brief ここまでの時間を現在の段階に加算し、以降をphaseの時間として計測します。
+         */
+        void switchTo(Phase phase_);
+
+        Scope(const Scope&) = delete;
+        Scope(Scope&&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        Scope& operator=(Scope&&) = delete;
+
+    private:
+        /// 加算先 (集計しない場合はnullptr)
+        PhaseTimer* _timer;
+        Phase _phase;
+        Scope* _outer;
+        std::chrono::steady_clock::time_point _start;
+        /// 段階の開始時刻 (入れ子の区間による中断を含む。Traceの記録に用いる。)
+        std::chrono::steady_clock::time_point _phase_start;
+    };
+
+    PhaseTimer() = default;
+
+    /**
+     * @brief 段階の所要時間(秒)を返します。
+     */
+    [[nodiscard]] double seconds(Phase phase_) const;
+
+    [[nodiscard]] static std::string_view name(Phase phase_);
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer(PhaseTimer&&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(PhaseTimer&&) = delete;
+
+private:
+    void add(Phase phase_, std::chrono::steady_clock::time_point start_, std::chrono::steady_clock::time_point end_);
+
+    std::array<std::atomic<int64_t>, static_cast<size_t>(Phase::COUNT)> _elapsed_ns{};
+};
+
+
+#endif //PHASETIMER_H
@@ -0,0 +1,174 @@
+/**
+ * @file ResourceIndex.cpp
+ * @date 26/10/17
+ * @brief ファイル名からリソースを検索する索引の生成
+ * @details ファイル名の集合に対する最小完全ハッシュを生成時に構築し、定数時間で検索する
+ *          resource_find(const char* name, size_t length)をresource.hに書き込みます。
+ *          C++としてコンパイルした場合はテーブルと検索関数がconstexprとなり、
+ *          リテラルのファイル名による検索はコンパイル時に解決できます。(C++14以降)
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "ResourceIndex.h"
+
+#include <algorithm>
+#include <format>
+#include <numeric>
+
+namespace {
+    /**
+     * @brief C言語の文字列リテラルとして書き込めるよう、ファイル名をエスケープします。
+     * @details 英数字と一部の記号以外は8進数のエスケープシーケンスとします。("?"はトライグラフを避けるため)
+     */
+    std::string toStringLiteral(const std::string_view str_)
+    {
+        std::string result = "\"";
+        for (const char c : str_) {
+            const auto byte = static_cast<unsigned char>(c);
+            if (byte == '"' || byte == '\\' || byte == '?' || byte < 0x20 || byte >= 0x7f) {
+                const char escape[] = {
+                    '\\', static_cast<char>('0' + (byte >> 6)), static_cast<char>('0' + (byte >> 3 & 7)),
+                    static_cast<char>('0' + (byte & 7))
+                };
+                result.append(escape, sizeof(escape));
+            }
+            else result += c;
+        }
+        return result + "\"";
+    }
+}
+
+std::vector<int32_t> ResourceIndex::build(const std::vector<std::string_view>& keys_)
+{
+    const size_t n = keys_.size();
+    if (n == 0) return {};
+
+    // 1段目のハッシュでキーをバケットに分け、キーの多いバケットから順にシードを探す。
+    std::vector<std::vector<size_t>> buckets(n);
+    for (size_t i = 0; i < n; ++i) buckets[hash(keys_[i], 0) % n].push_back(i);
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), size_t{0});
+    std::ranges::stable_sort(order, std::ranges::greater{}, [&](const size_t b_) { return buckets[b_].size(); });
+
+    std::vector<int32_t> seeds(n, 0);
+    std::vector<bool> occupied(n, false);
+    std::vector<size_t> slots;
+    size_t next = 0;
+    for (; next < n && buckets[order[next]].size() > 1; ++next) {
+        const auto& bucket = buckets[order[next]];
+        for (int32_t seed = 1;; ++seed) {
+            slots.clear();
+            bool placed = true;
+            for (const size_t key : bucket) {
+                const size_t s = hash(keys_[key], static_cast<uint32_t>(seed)) % n;
+                if (occupied[s] || std::ranges::find(slots, s) != slots.end()) {
+                    placed = false;
+                    break;
+                }
+                slots.push_back(s);
+            }
+            if (!placed) continue;
+            for (const size_t s : slots) occupied[s] = true;
+            seeds[order[next]] = seed;
+            break;
+        }
+    }
+    // キーが1つのバケットは、空いている位置を直接指定する。
+    size_t free_slot = 0;
+    for (; next < n && buckets[order[next]].size() == 1; ++next) {
+        while (occupied[free_slot]) ++free_slot;
+        occupied[free_slot] = true;
+        seeds[order[next]] = -static_cast<int32_t>(free_slot) - 1;
+    }
+    return seeds;
+}
+
+size_t ResourceIndex::slot(const std::vector<int32_t>& seeds_, const std::string_view key_)
+{
+    const size_t n = seeds_.size();
+    const int32_t seed = seeds_[hash(key_, 0) % n];
+    return seed < 0 ? static_cast<size_t>(-static_cast<int64_t>(seed) - 1) : hash(key_, static_cast<uint32_t>(seed)) % n;
+}
+
+std::string ResourceIndex::definitions(const std::vector<Entry>& entries_)
+{
+    std::string result =
+        "#include <stddef.h>\n"
+        "#include <stdint.h>\n\n"
+        "// resource_find: ファイル名からリソースを検索する索引 (最小完全ハッシュ)\n"
+        "#ifdef __cplusplus\n"
+        "#define FILE_BUNDLER_INDEX_DATA constexpr\n"
+        "#define FILE_BUNDLER_INDEX_FUNC constexpr\n"
+        "#else\n"
+        "#define FILE_BUNDLER_INDEX_DATA static const\n"
+        "#define FILE_BUNDLER_INDEX_FUNC static inline\n"
+        "#endif\n\n"
+        "typedef struct file_bundler_resource {\n"
+        "    const char* name;\n"
+        "    size_t name_length;\n"
+        "    // ファイルの内容 (圧縮の対象のファイルではNULL)\n"
+        "    const char* data;\n"
+        "    unsigned long long size;\n"
+        "    // 圧縮の対象のファイルのアクセサR_～ (それ以外のファイルではNULL)\n"
+        "    const char* (*load)(char* buffer);\n"
+        "} file_bundler_resource;\n\n";
+
+    if (entries_.empty()) {
+        return result + "FILE_BUNDLER_INDEX_FUNC const file_bundler_resource* resource_find(const char* name, size_t length)\n"
+            "{\n"
+            "    (void)name;\n"
+            "    (void)length;\n"
+            "    return NULL;\n"
+            "}\n\n\n";
+    }
+
+    std::vector<std::string_view> keys;
+    keys.reserve(entries_.size());
+    for (const auto& entry : entries_) keys.emplace_back(entry.name);
+    const std::vector<int32_t> seeds = build(keys);
+    std::vector<const Entry*> table(entries_.size());
+    for (const auto& entry : entries_) table[slot(seeds, entry.name)] = &entry;
+
+    const size_t n = entries_.size();
+    result += std::format("#define FILE_BUNDLER_INDEX_SIZE {}\n\n", n);
+    result += std::format("FILE_BUNDLER_INDEX_DATA int32_t file_bundler_index_seeds[{}] = {{", n);
+    for (size_t i = 0; i < n; ++i) result += std::format("{}{}{}", i == 0 ? "" : ",", i % 16 == 0 ? "\n    " : " ", seeds[i]);
+    result += "\n};\n\n";
+    result += std::format("FILE_BUNDLER_INDEX_DATA file_bundler_resource file_bundler_index[{}] = {{\n", n);
+    for (const Entry* entry : table) {
+        result += std::format("    {{{}, {}, {}, {}ULL, {}}},\n", toStringLiteral(entry->name), entry->name.size(),
+                              entry->accessor ? "NULL" : "F_" + entry->constant, entry->size,
+                              entry->accessor ? "R_" + entry->constant : "NULL");
+    }
+    result += "};\n\n";
+    result += "FILE_BUNDLER_INDEX_FUNC uint32_t file_bundler_index_hash(const char* name, size_t length, uint32_t seed)\n"
+        "{\n"
+        "    uint32_t h = 2166136261u ^ seed;\n"
+        "    size_t i = 0;\n"
+        "    for (; i < length; ++i) {\n"
+        "        h ^= (unsigned char)name[i];\n"
+        "        h *= 16777619u;\n"
+        "    }\n"
+        "    h ^= h >> 16;\n"
+        "    h *= 0x85ebca6bu;\n"
+        "    h ^= h >> 13;\n"
+        "    h *= 0xc2b2ae35u;\n"
+        "    h ^= h >> 16;\n"
+        "    return h;\n"
+        "}\n\n"
+        "// ファイル名(lengthバイト)のリソースを返します。存在しない場合はNULLを返します。\n"
+        "FILE_BUNDLER_INDEX_FUNC const file_bundler_resource* resource_find(const char* name, size_t length)\n"
+        "{\n"
+        "    const int32_t seed = file_bundler_index_seeds[file_bundler_index_hash(name, length, 0) % FILE_BUNDLER_INDEX_SIZE];\n"
+        "    const file_bundler_resource* entry = &file_bundler_index[seed < 0\n"
+        "        ? (size_t)(-(int64_t)seed - 1)\n"
+        "        : file_bundler_index_hash(name, length, (uint32_t)seed) % FILE_BUNDLER_INDEX_SIZE];\n"
+        "    size_t i = 0;\n"
+        "    if (entry->name_length != length) return NULL;\n"
+        "    for (; i < length; ++i) {\n"
+        "        if (entry->name[i] != name[i]) return NULL;\n"
+        "    }\n"
+        "    return entry;\n"
+        "}\n\n\n";
+    return result;
+}
@@ -0,0 +1,70 @@
+/**
+ * @file ResourceIndex.h
+ * @date 26/10/17
+ * @brief ファイル名からリソースを検索する索引の生成
+ * @details ファイル名の集合に対する最小完全ハッシュを生成時に構築し、定数時間で検索する
+ *          resource_find(const char* name, size_t length)をresource.hに書き込みます。
+ *          C++としてコンパイルした場合はテーブルと検索関数がconstexprとなり、
+ *          リテラルのファイル名による検索はコンパイル時に解決できます。(C++14以降)
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef RESOURCEINDEX_H
+#define RESOURCEINDEX_H
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+class ResourceIndex {
+public:
+    /// 索引に登録するリソース
+    struct Entry {
+        /// 検索に用いるファイル名
+        std::string name;
+        /// 定数名 (SIZE_～, F_～, R_～の～の部分)
+        std::string constant;
+        uintmax_t size = 0;
+        /// 圧縮の対象のファイルの場合はtrue (F_～の代わりにアクセサR_～を登録します。)
+        bool accessor = false;
+    };
+
+    /**
+     * @brief 生成するコードと同一のハッシュ関数です。(FNV-1aの結果をmurmur3の最終化関数で撹拌します。)
+     */
+    static constexpr uint32_t hash(const std::string_view key_, const uint32_t seed_)
+    {
+        uint32_t h = 2166136261u ^ seed_;
+        for (const char c : key_) {
+            h ^= static_cast<unsigned char>(c);
+            h *= 16777619u;
+        }
+        h ^= h >> 16;
+        h *= 0x85ebca6bu;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35u;
+        h ^= h >> 16;
+        return h;
+    }
+
+    /**
+     * @brief keysに対する最小完全ハッシュのシード表を構築します。
+     * @details 表の大きさはkeysの数と同一です。キーkの位置は、s = seeds[hash(k, 0) % n]として
+     *          sが負であれば-s-1、それ以外はhash(k, s) % nです。keysに重複があってはなりません。
+     */
+    static std::vector<int32_t> build(const std::vector<std::string_view>& keys_);
+
+    /**
+     * @brief buildで構築したシード表によるキーの位置を返します。
+     */
+    static size_t slot(const std::vector<int32_t>& seeds_, std::string_view key_);
+
+    /**
+     * @brief ヘッダファイルに書き込む索引の定義を返します。リソースの宣言または定義の後に書き込みます。
+     */
+    static std::string definitions(const std::vector<Entry>& entries_);
+};
+
+
+#endif //RESOURCEINDEX_H
@@ -0,0 +1,25 @@
+/**
+ * @file RunContext.cpp
+ * @date 26/10/17
+ * @brief 1回の出力の集計と記録の対象
+ * @details IoStats・PhaseTimerの集計とTraceの記録は、現在のスレッドで有効なRunContextの対象に対して行います。
+ *          WorkerPoolのタスクと先読みのスレッドは、登録・作成したスレッドの対象を引き継ぐため、
+ *          同時に行われる複数の出力(スレッドプールを共有する場合を含む)の集計は混ざりません。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "RunContext.h"
+
+namespace {
+    thread_local RunContext current_context;
+}
+
+const RunContext& RunContext::current() { return current_context; }
+
+RunContext::Scope::Scope(const RunContext& context_)
+    : _previous(current_context)
+{
+    current_context = context_;
+}
+
+RunContext::Scope::~Scope() { current_context = _previous; }
@@ -0,0 +1,53 @@
+/**
+ * @file RunContext.h
+ * @date 26/10/17
+ * @brief 1回の出力の集計と記録の対象
+ * @details IoStats・PhaseTimerの集計とTraceの記録は、現在のスレッドで有効なRunContextの対象に対して行います。
+ *          WorkerPoolのタスクと先読みのスレッドは、登録・作成したスレッドの対象を引き継ぐため、
+ *          同時に行われる複数の出力(スレッドプールを共有する場合を含む)の集計は混ざりません。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef RUNCONTEXT_H
+#define RUNCONTEXT_H
+
+class IoStats;
+class PhaseTimer;
+class Trace;
+
+
+struct RunContext {
+    /// 入出力の集計先 (集計しない場合はnullptr)
+    IoStats* io_stats = nullptr;
+    /// 処理段階の集計先 (集計しない場合はnullptr)
+    PhaseTimer* phase_timer = nullptr;
+    /// 処理区間の記録先 (記録しない場合はnullptr)
+    Trace* trace = nullptr;
+
+    /**
+     * @brief 現在のスレッドで有効な対象を返します。
+     */
+    [[nodiscard]] static const RunContext& current();
+
+    class Scope;
+};
+
+/**
+ * @brief 構築から破棄までの間、現在のスレッドで有効な対象をcontextにします。
+ */
+class RunContext::Scope {
+public:
+    explicit Scope(const RunContext& context_);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope(Scope&&) = delete;
+    Scope& operator=(const Scope&) = delete;
+    Scope& operator=(Scope&&) = delete;
+
+private:
+    RunContext _previous;
+};
+
+
+#endif //RUNCONTEXT_H
@@ -0,0 +1,140 @@
+/**
+ * @file Trace.cpp
+ * @date 26/10/17
+ * @brief 処理区間の記録とChrome trace-event形式での出力
+ * @details 記録は出力ごとのインスタンスに対して行い、記録先は現在のスレッドのRunContextで決まります。
+ *          記録はスレッドごとのバッファに追加するため、ワーカー間で競合しません。
+ *          記録していない間、Spanの構築と破棄はRunContextを1回読み込むのみです。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "Trace.h"
+
+#include <atomic>
+#include <format>
+#include <fstream>
+
+#include "RunContext.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Event {
+        const char* name;
+        std::string detail;
+        Clock::time_point start;
+        Clock::time_point end;
+        uint64_t bytes_in;
+        uint64_t bytes_out;
+    };
+
+    /// インスタンスの識別子の採番
+    std::atomic<uint64_t> next_id{1};
+
+    std::string escapeJson(const std::string_view str_)
+    {
+        std::string result;
+        result.reserve(str_.size());
+        for (const char c : str_) {
+            if (c == '"' || c == '\\') {
+                result += '\\';
+                result += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20) { result += std::format("\\u{:04x}", static_cast<int>(c)); }
+            else { result += c; }
+        }
+        return result;
+    }
+
+    double toMicroseconds(const Clock::duration duration_)
+    {
+        return std::chrono::duration<double, std::micro>(duration_).count();
+    }
+}
+
+/// スレッドごとの記録先。スレッドの終了後も書き出せるよう、インスタンスの破棄まで保持する。
+struct Trace::Buffer {
+    std::mutex mutex;
+    std::vector<Event> events;
+    uint32_t tid = 0;
+    bool main_thread = false;
+};
+
+Trace::Trace()
+    : _id(next_id.fetch_add(1, std::memory_order_relaxed)), _origin(Clock::now()),
+      _main_thread_id(std::this_thread::get_id())
+{
+}
+
+Trace::~Trace() = default;
+
+Trace* Trace::current() { return RunContext::current().trace; }
+
+bool Trace::write(const fs::path& path_) const
+{
+    std::ofstream ofs(path_, std::ios::binary);
+    if (!ofs) return false;
+    ofs << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    const std::lock_guard lock(_mutex);
+    for (const auto& buffer : _buffers) {
+        const std::lock_guard buffer_lock(buffer->mutex);
+        if (buffer->events.empty()) continue;
+        ofs << (first ? "" : ",\n")
+            << std::format(R"({{"name":"thread_name","ph":"M","pid":1,"tid":{},"args":{{"name":"{}"}}}})",
+                           buffer->tid, buffer->main_thread ? "main" : std::format("worker {}", buffer->tid));
+        first = false;
+        for (const auto& event : buffer->events) {
+            const double duration = toMicroseconds(event.end - event.start);
+            ofs << std::format(R"(,
+{{"name":"{}","cat":"file-bundler","ph":"X","pid":1,"tid":{},"ts":{:.3f},"dur":{:.3f},"args":{{)",
+                               event.name, buffer->tid, toMicroseconds(event.start - _origin), duration);
+            ofs << std::format(R"("detail":"{}","bytes_in":{},"bytes_out":{})", escapeJson(event.detail),
+                               event.bytes_in, event.bytes_out);
+            // 入力のスループット (MB/s)
+            if (event.bytes_in > 0 && duration > 0)
+                ofs << std::format(R"(,"mb_s":{:.3f})", static_cast<double>(event.bytes_in) / duration);
+            ofs << "}}";
+        }
+    }
+    ofs << "\n]}\n";
+    return static_cast<bool>(ofs);
+}
+
+void Trace::Span::begin(const char* name_, const std::string_view detail_)
+{
+    _name = name_;
+    _detail = detail_;
+    _start = Clock::now();
+}
+
+void Trace::Span::end() { _trace->record(_name, _detail, _start, Clock::now(), _bytes_in, _bytes_out); }
+
+void Trace::record(const char* name_, const std::string_view detail_, const Clock::time_point start_,
+                   const Clock::time_point end_, const uint64_t bytes_in_, const uint64_t bytes_out_)
+{
+    Buffer& buffer = localBuffer();
+    const std::lock_guard lock(buffer.mutex);
+    buffer.events.push_back({name_, std::string(detail_), start_, end_, bytes_in_, bytes_out_});
+}
+
+Trace::Buffer& Trace::localBuffer()
+{
+    // このスレッドが最後に記録したインスタンスの識別子とバッファ
+    static thread_local uint64_t local_trace_id = 0;
+    static thread_local Buffer* local_buffer = nullptr;
+    // 同じスレッドが続けて記録する場合は、登録済みのバッファを検索せずに用いる。
+    if (local_trace_id == _id) return *local_buffer;
+    const std::lock_guard lock(_mutex);
+    Buffer*& buffer = _thread_buffers[std::this_thread::get_id()];
+    if (!buffer) {
+        buffer = _buffers.emplace_back(std::make_unique<Buffer>()).get();
+        buffer->tid = static_cast<uint32_t>(_buffers.size());
+        buffer->main_thread = std::this_thread::get_id() == _main_thread_id;
+    }
+    local_trace_id = _id;
+    local_buffer = buffer;
+    return *buffer;
+}
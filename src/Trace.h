@@ -0,0 +1,112 @@
+/**
+ * @file Trace.h
+ * @date 26/10/17
+ * @brief 処理区間の記録とChrome trace-event形式での出力
+ * @details 記録は出力ごとのインスタンスに対して行い、記録先は現在のスレッドのRunContextで決まります。
+ *          記録はスレッドごとのバッファに追加するため、ワーカー間で競合しません。
+ *          記録していない間、Spanの構築と破棄はRunContextを1回読み込むのみです。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+
+class Trace {
+public:
+    /**
+     * @brief 記録を開始します。構築したスレッドをメインスレッドとして表示します。
+     */
+    Trace();
+    ~Trace();
+
+    /**
+     * @brief 現在のスレッドのRunContextの記録先を返します。記録していない場合はnullptrを返します。
+     */
+    [[nodiscard]] static Trace* current();
+
+    /**
+     * @brief 記録した区間をChrome trace-event形式のJSONとしてpathに書き込みます。
+     * @return 書き込みに失敗した場合はfalse
+     */
+    bool write(const std::filesystem::path& path_) const;
+
+    /**
+     * @brief 計測済みの区間を、呼び出したスレッドのバッファに記録します。
+     */
+    void record(const char* name_, std::string_view detail_, std::chrono::steady_clock::time_point start_,
+                       std::chrono::steady_clock::time_point end_, uint64_t bytes_in_ = 0, uint64_t bytes_out_ = 0);
+
+    /**
+     * @brief 構築から破棄までを1つの区間として記録します。
+     * @details nameは静的な文字列である必要があります。detailは記録する場合にのみ複製されます。
+     */
+    class Span {
+    public:
+        explicit Span(const char* name_, const std::string_view detail_ = {}) : _trace(current())
+        {
+            if (_trace) begin(name_, detail_);
+        }
+
+        ~Span() { if (_trace) end(); }
+
+        /**
+         * @brief 区間で処理した入力と出力のバイト数を記録します。
+         */
+        void setBytes(const uint64_t bytes_in_, const uint64_t bytes_out_)
+        {
+            _bytes_in = bytes_in_;
+            _bytes_out = bytes_out_;
+        }
+
+        Span(const Span&) = delete;
+        Span(Span&&) = delete;
+        Span& operator=(const Span&) = delete;
+        Span& operator=(Span&&) = delete;
+
+    private:
+        void begin(const char* name_, std::string_view detail_);
+        void end();
+
+        Trace* _trace;
+        const char* _name = nullptr;
+        std::string _detail;
+        std::chrono::steady_clock::time_point _start;
+        uint64_t _bytes_in = 0;
+        uint64_t _bytes_out = 0;
+    };
+
+    Trace(const Trace&) = delete;
+    Trace(Trace&&) = delete;
+    Trace& operator=(const Trace&) = delete;
+    Trace& operator=(Trace&&) = delete;
+
+private:
+    struct Buffer;
+
+    /**
+     * @brief 呼び出したスレッドのバッファを返します。初回の呼び出しで作成します。
+     */
+    Buffer& localBuffer();
+
+    /// インスタンスの識別子 (スレッドごとのバッファの参照の検証に用いる。アドレスと異なり再利用されない。)
+    const uint64_t _id;
+    const std::chrono::steady_clock::time_point _origin;
+    const std::thread::id _main_thread_id;
+    mutable std::mutex _mutex;
+    std::vector<std::unique_ptr<Buffer>> _buffers;
+    std::map<std::thread::id, Buffer*> _thread_buffers;
+};
+
+
+#endif //TRACE_H
@@ -0,0 +1,313 @@
+/**
+ * @file Transform.cpp
+ * @date 26/10/17
+ * @brief エンコードの前にファイルの内容を変換するテキスト変換
+ * @details コメントの除去や空白の除去などの変換を、任意の位置で区切ったチャンクごとに行います。
+ *          チャンクの境界をまたぐコメントや文字列リテラルは、状態を引き継いで処理します。
+ *          区切り文字(コメントや引用符の開始など)の検索は、SSE2が利用できる場合は16バイト単位で行います。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "Transform.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FILE_BUNDLER_TRANSFORM_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+    /**
+     * @brief 区切り文字の集合と、その最初の出現位置の検索
+     * @details 変換の大部分はコメントや文字列の外側をそのまま複製する処理のため、
+     *          区切り文字までを一括で検索・複製することで1バイトごとの分岐を避けます。
+     */
+    class DelimiterSet {
+    public:
+        static constexpr size_t MAX_DELIMITERS = 8;
+
+        explicit DelimiterSet(const std::string_view delimiters_)
+        {
+            for (const char c : delimiters_) _table[static_cast<unsigned char>(c)] = true;
+#ifdef FILE_BUNDLER_TRANSFORM_SSE2
+            _count = std::min(delimiters_.size(), MAX_DELIMITERS);
+            for (size_t i = 0; i < _count; ++i) _vectors[i] = _mm_set1_epi8(delimiters_[i]);
+#endif
+        }
+
+        /**
+         * @brief [begin, end)で最初に現れる区切り文字の位置を返します。存在しない場合はendを返します。
+         */
+        [[nodiscard]] const char* find(const char* begin_, const char* const end_) const
+        {
+#ifdef FILE_BUNDLER_TRANSFORM_SSE2
+            for (; end_ - begin_ >= 16; begin_ += 16) {
+                const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin_));
+                __m128i hit = _mm_cmpeq_epi8(block, _vectors[0]);
+                for (size_t i = 1; i < _count; ++i) hit = _mm_or_si128(hit, _mm_cmpeq_epi8(block, _vectors[i]));
+                if (const auto mask = static_cast<unsigned>(_mm_movemask_epi8(hit)); mask != 0)
+                    return begin_ + std::countr_zero(mask);
+            }
+#endif
+            for (; begin_ < end_; ++begin_)
+                if (_table[static_cast<unsigned char>(*begin_)]) return begin_;
+            return end_;
+        }
+
+    private:
+        std::array<bool, 256> _table{};
+#ifdef FILE_BUNDLER_TRANSFORM_SSE2
+        __m128i _vectors[MAX_DELIMITERS]{};
+        size_t _count = 0;
+#endif
+    };
+
+    /**
+     * @brief ブロックコメントと行コメントの除去
+     * @details 引用符で囲まれた文字列リテラル内のコメントの開始は、コメントとして扱いません。
+     *          文字列リテラルは対応する引用符か改行で終わるものとします。(JavaScriptのテンプレートリテラル(`)は改行を含む。)
+     *          行コメントを取り除かない場合も、行コメント内のブロックコメントの開始を無視するよう、行末までをそのまま書き込みます。
+     */
+    class CommentStripper final : public Transform {
+    public:
+        /**
+         * @param line_comments_ 行コメントも取り除く。
+         * @param quotes_ 文字列リテラルを認識する。
+         * @param separate_ 取り除いたブロックコメントを空白1つに置き換える。(前後の字句の連結を防ぐ。)
+         */
+        CommentStripper(const bool line_comments_, const bool quotes_, const bool separate_)
+            : _line_comments(line_comments_), _separate(separate_), _normal(quotes_ ? "/\"'`" : "/")
+        {
+        }
+
+        void process(const std::string_view chunk_, std::string& out_) override
+        {
+            const char* p = chunk_.data();
+            const char* const end = p + chunk_.size();
+            while (p < end) {
+                switch (_state) {
+                case State::NORMAL: {
+                    const char* next = _normal.find(p, end);
+                    out_.append(p, next);
+                    p = next;
+                    if (p == end) break;
+                    if (*p == '/') { _state = State::SLASH; }
+                    else {
+                        _quote = *p;
+                        out_ += *p;
+                        _state = State::STRING;
+                    }
+                    ++p;
+                    break;
+                }
+                case State::SLASH:
+                    if (*p == '*') {
+                        _state = State::BLOCK;
+                        ++p;
+                    }
+                    else if (*p == '/') {
+                        if (!_line_comments) out_ += "//";
+                        _state = _line_comments ? State::LINE : State::LINE_KEEP;
+                        ++p;
+                    }
+                    else {
+                        // コメントではなかった"/"は、次の文字をNORMALとして処理する。
+                        out_ += '/';
+                        _state = State::NORMAL;
+                    }
+                    break;
+                case State::BLOCK:
+                    p = _star.find(p, end);
+                    if (p == end) break;
+                    _state = State::BLOCK_STAR;
+                    ++p;
+                    break;
+                case State::BLOCK_STAR:
+                    if (*p == '/') {
+                        if (_separate) out_ += ' ';
+                        _state = State::NORMAL;
+                        ++p;
+                    }
+                    else if (*p == '*') { ++p; }
+                    else { _state = State::BLOCK; }
+                    break;
+                case State::LINE:
+                    // 改行はコメントに含めず、NORMALとして書き込む。
+                    p = _newline.find(p, end);
+                    if (p != end) _state = State::NORMAL;
+                    break;
+                case State::LINE_KEEP: {
+                    const char* next = _newline.find(p, end);
+                    out_.append(p, next);
+                    p = next;
+                    if (p != end) _state = State::NORMAL;
+                    break;
+                }
+                case State::STRING: {
+                    const char* next = _string.find(p, end);
+                    out_.append(p, next);
+                    p = next;
+                    if (p == end) break;
+                    out_ += *p;
+                    if (*p == '\\') _state = State::ESCAPE;
+                    else if (*p == _quote || (*p == '\n' && _quote != '`')) _state = State::NORMAL;
+                    ++p;
+                    break;
+                }
+                case State::ESCAPE:
+                    out_ += *p++;
+                    _state = State::STRING;
+                    break;
+                }
+            }
+        }
+
+        void finish(std::string& out_) override
+        {
+            // 閉じていないブロックコメントは終端までをコメントとする。
+            if (_state == State::SLASH) out_ += '/';
+            _state = State::NORMAL;
+        }
+
+    private:
+        enum class State { NORMAL, SLASH, BLOCK, BLOCK_STAR, LINE, LINE_KEEP, STRING, ESCAPE };
+
+        const bool _line_comments;
+        const bool _separate;
+        const DelimiterSet _normal;
+        const DelimiterSet _string{"\"'`\\\n"};
+        const DelimiterSet _star{"*"};
+        const DelimiterSet _newline{"\n"};
+        State _state = State::NORMAL;
+        char _quote = 0;
+    };
+
+    /**
+     * @brief JSONの文字列の外側の空白(スペース・タブ・改行)の除去
+     */
+    class JsonMinifier final : public Transform {
+    public:
+        void process(const std::string_view chunk_, std::string& out_) override
+        {
+            const char* p = chunk_.data();
+            const char* const end = p + chunk_.size();
+            while (p < end) {
+                if (_escape) {
+                    out_ += *p++;
+                    _escape = false;
+                    continue;
+                }
+                const char* next = (_in_string ? _string : _normal).find(p, end);
+                out_.append(p, next);
+                p = next;
+                if (p == end) break;
+                if (_in_string) {
+                    out_ += *p;
+                    if (*p == '\\') _escape = true;
+                    else _in_string = false;
+                }
+                else if (*p == '"') {
+                    out_ += *p;
+                    _in_string = true;
+                }
+                ++p;
+            }
+        }
+
+        void finish(std::string&) override {}
+
+    private:
+        const DelimiterSet _normal{"\" \t\r\n"};
+        const DelimiterSet _string{"\"\\"};
+        bool _in_string = false;
+        bool _escape = false;
+    };
+
+    /**
+     * @brief GLSLのコメントの除去と空白の圧縮
+     * @details 連続する空白は1つにまとめ、行頭と空行の空白は取り除きます。
+     *          改行はプリプロセッサの指令(#から始まる行と、その"\"による継続行)の終わりでのみ保ち、
+     *          その他の改行は空白1つに置き換えます。
+     */
+    class GlslMinifier final : public Transform {
+    public:
+        void process(const std::string_view chunk_, std::string& out_) override
+        {
+            _stripped.clear();
+            _comments.process(chunk_, _stripped);
+            collapse(_stripped, out_);
+        }
+
+        void finish(std::string& out_) override
+        {
+            _stripped.clear();
+            _comments.finish(_stripped);
+            collapse(_stripped, out_);
+            // 最後の指令の行を改行で終える。
+            if (_pending == Pending::NEWLINE && _directive) out_ += '\n';
+            _pending = Pending::NONE;
+        }
+
+    private:
+        enum class Pending { NONE, SPACE, NEWLINE };
+
+        void collapse(const std::string_view text_, std::string& out_)
+        {
+            const char* p = text_.data();
+            const char* const end = p + text_.size();
+            while (p < end) {
+                const char* next = _whitespace.find(p, end);
+                if (next != p) {
+                    flush(*p, out_);
+                    if (_line_start && *p == '#') _directive = true;
+                    out_.append(p, next);
+                    _last = *(next - 1);
+                    _line_start = false;
+                    p = next;
+                }
+                if (p == end) break;
+                if (*p == '\n') _pending = Pending::NEWLINE;
+                else if (_pending == Pending::NONE) _pending = Pending::SPACE;
+                ++p;
+            }
+        }
+
+        /// 保留している空白を、次に書き込む文字nextに合わせて書き込む。
+        void flush(const char next_, std::string& out_)
+        {
+            if (_pending == Pending::NEWLINE && (_directive || next_ == '#')) {
+                if (!_line_start) out_ += '\n';
+                _line_start = true;
+                // "\"で終わる指令の行は次の行に続く。
+                _directive = _directive && _last == '\\';
+            }
+            else if (_pending != Pending::NONE && !_line_start) { out_ += ' '; }
+            _pending = Pending::NONE;
+        }
+
+        CommentStripper _comments{true, false, true};
+        const DelimiterSet _whitespace{" \t\r\n\f\v"};
+        std::string _stripped;
+        Pending _pending = Pending::NONE;
+        bool _line_start = true;
+        bool _directive = false;
+        char _last = 0;
+    };
+}
+
+std::unique_ptr<Transform> Transform::create(const Kind kind_)
+{
+    switch (kind_) {
+    case Kind::COMMENTS:
+        return std::make_unique<CommentStripper>(true, true, true);
+    case Kind::JSON:
+        return std::make_unique<JsonMinifier>();
+    case Kind::GLSL:
+        return std::make_unique<GlslMinifier>();
+    default:
+        return std::make_unique<CommentStripper>(false, true, false);
+    }
+}
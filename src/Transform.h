@@ -0,0 +1,60 @@
+/**
+ * @file Transform.h
+ * @date 26/10/17
+ * @brief エンコードの前にファイルの内容を変換するテキスト変換
+ * @details コメントの除去や空白の除去などの変換を、任意の位置で区切ったチャンクごとに行います。
+ *          チャンクの境界をまたぐコメントや文字列リテラルは、状態を引き継いで処理します。
+ *          区切り文字(コメントや引用符の開始など)の検索は、SSE2が利用できる場合は16バイト単位で行います。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+#include <memory>
+#include <string>
+#include <string_view>
+
+
+class Transform {
+public:
+    enum class Kind {
+        /// ブロックコメント(/*～*/)を取り除く。入れ子のコメントは処理できない。行コメント(//～改行の前)はそのまま残す。
+        BLOCK_COMMENT,
+        /// ブロックコメントと行コメント(//～改行の前)を取り除く。行コメントのない言語(CSSなど)には使用できない。
+        COMMENTS,
+        /// 文字列の外側の空白を取り除く。
+        JSON,
+        /// コメントを取り除き、空白を詰める。プリプロセッサの指令の行は改行を保つ。
+        GLSL
+    };
+
+    /**
+     * @brief kindの変換を行うインスタンスを作成します。インスタンスは1つのファイルの変換にのみ使用します。
+     */
+    static std::unique_ptr<Transform> create(Kind kind_);
+
+    virtual ~Transform() = default;
+
+    /**
+     * @brief chunkを変換した結果をoutに追加します。
+     * @details ファイルの内容を先頭から順に、任意の長さで区切って渡します。
+     *          チャンクの末尾で判定できない文字(コメントの開始となり得る"/"など)は、次のチャンクまで保留します。
+     */
+    virtual void process(std::string_view chunk_, std::string& out_) = 0;
+
+    /**
+     * @brief 入力の終端で、保留している内容をoutに追加します。
+     */
+    virtual void finish(std::string& out_) = 0;
+
+    Transform(const Transform&) = delete;
+    Transform(Transform&&) = delete;
+    Transform& operator=(const Transform&) = delete;
+    Transform& operator=(Transform&&) = delete;
+
+protected:
+    Transform() = default;
+};
+
+
+#endif //TRANSFORM_H
@@ -0,0 +1,113 @@
+/**
+ * @file Watcher.cpp
+ * @date 26/10/17
+ * @brief ディレクトリ内のファイルの変更の監視
+ * @details Linuxのinotifyにより、登録したディレクトリの直下のファイルの変更を待ちます。
+ *          連続した変更(エディタの保存やファイルの一括コピーなど)は、変更が一定時間途切れるまで1回にまとめます。
+ *          Linux以外の環境では監視を開始できません。(valid()がfalseを返します。)
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "Watcher.h"
+
+#include <set>
+
+#ifdef __linux__
+#include <cerrno>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+#ifdef __linux__
+namespace {
+    /// 内容の変更(touchによる更新日時の変更を含む)
+    constexpr uint32_t content_mask = IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB;
+    /// ファイルの作成・削除・移動 (エディタによる置き換えの保存を含む)
+    constexpr uint32_t structure_mask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF |
+        IN_MOVE_SELF;
+}
+
+Watcher::Watcher() : _fd(::inotify_init1(IN_CLOEXEC | IN_NONBLOCK)) {}
+
+Watcher::~Watcher()
+{
+    if (_fd >= 0) ::close(_fd);
+}
+
+void Watcher::setDirectories(const std::vector<fs::path>& directories_)
+{
+    if (_fd < 0) return;
+    std::set<fs::path> wanted;
+    for (const auto& directory : directories_) wanted.insert(directory.lexically_normal());
+    for (auto it = _directories.begin(); it != _directories.end();) {
+        if (wanted.erase(it->second) == 0) {
+            ::inotify_rm_watch(_fd, it->first);
+            it = _directories.erase(it);
+        }
+        else { ++it; }
+    }
+    for (const auto& directory : wanted) {
+        // 同じディレクトリを別のパスで登録した場合は、同じ監視記述子が返される。
+        if (const int wd = ::inotify_add_watch(_fd, directory.c_str(), content_mask | structure_mask | IN_ONLYDIR);
+            wd >= 0)
+            _directories.try_emplace(wd, directory);
+    }
+}
+
+bool Watcher::wait(const std::chrono::milliseconds debounce_, std::vector<Event>& events_)
+{
+    if (_fd < 0) return false;
+    pollfd pfd{_fd, POLLIN, 0};
+    // 最初の変更は無期限に、以降は変更がdebounceの間途切れるまで待つ。
+    for (int timeout = -1;; timeout = static_cast<int>(debounce_.count())) {
+        const int ready = ::poll(&pfd, 1, timeout);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        if (ready == 0) return true;
+        if (!readEvents(events_)) return false;
+    }
+}
+
+bool Watcher::readEvents(std::vector<Event>& events_)
+{
+    alignas(inotify_event) char buffer[64 * 1024];
+    while (true) {
+        const ssize_t length = ::read(_fd, buffer, sizeof(buffer));
+        if (length < 0) return errno == EAGAIN || errno == EINTR;
+        for (ssize_t offset = 0; offset < length;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+            if (event->mask & IN_Q_OVERFLOW) {
+                events_.push_back({{}, true});
+                continue;
+            }
+            const auto directory = _directories.find(event->wd);
+            if (directory == _directories.end()) continue;
+            // 削除・移動されたディレクトリの監視は解除される。
+            if (event->mask & IN_IGNORED) {
+                _directories.erase(directory);
+                continue;
+            }
+            events_.push_back({
+                event->len > 0 ? directory->second / event->name : directory->second,
+                (event->mask & structure_mask) != 0
+            });
+        }
+    }
+}
+#else
+Watcher::Watcher() = default;
+
+Watcher::~Watcher() = default;
+
+void Watcher::setDirectories(const std::vector<fs::path>&) {}
+
+bool Watcher::wait(std::chrono::milliseconds, std::vector<Event>&) { return false; }
+
+bool Watcher::readEvents(std::vector<Event>&) { return false; }
+#endif
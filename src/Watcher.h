@@ -0,0 +1,63 @@
+/**
+ * @file Watcher.h
+ * @date 26/10/17
+ * @brief ディレクトリ内のファイルの変更の監視
+ * @details Linuxのinotifyにより、登録したディレクトリの直下のファイルの変更を待ちます。
+ *          連続した変更(エディタの保存やファイルの一括コピーなど)は、変更が一定時間途切れるまで1回にまとめます。
+ *          Linux以外の環境では監視を開始できません。(valid()がfalseを返します。)
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef WATCHER_H
+#define WATCHER_H
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <vector>
+
+
+class Watcher {
+public:
+    struct Event {
+        /// 変更されたファイル。イベントが失われた場合は空になります。
+        std::filesystem::path path;
+        /// ファイルの作成・削除・移動、監視するディレクトリ自体の削除・移動、またはイベントの喪失
+        bool structural = false;
+    };
+
+    Watcher();
+    ~Watcher();
+
+    [[nodiscard]] bool valid() const { return _fd >= 0; }
+
+    /**
+     * @brief 監視するディレクトリを置き換えます。
+     * @details 既に監視しているディレクトリの監視は継続するため、呼び出しの前後の変更は失われません。
+     */
+    void setDirectories(const std::vector<std::filesystem::path>& directories_);
+
+    /**
+     * @brief 変更を待ち、変更がdebounceの間途切れるまでの変更をeventsに追加します。
+     * @return 変更を読み込めなかった場合はfalse
+     */
+    [[nodiscard]] bool wait(std::chrono::milliseconds debounce_, std::vector<Event>& events_);
+
+    Watcher(const Watcher&) = delete;
+    Watcher(Watcher&&) = delete;
+    Watcher& operator=(const Watcher&) = delete;
+    Watcher& operator=(Watcher&&) = delete;
+
+private:
+    /**
+     * @brief 読み込めるイベントをすべて読み込みます。
+     * @return 読み込みに失敗した場合はfalse
+     */
+    bool readEvents(std::vector<Event>& events_);
+
+    int _fd = -1;
+    /// 監視記述子と、監視しているディレクトリ
+    std::map<int, std::filesystem::path> _directories;
+};
+
+
+#endif //WATCHER_H
@@ -0,0 +1,86 @@
+/**
+ * @file WorkerPool.cpp
+ * @date 26/10/17
+ * @brief ワークスティーリングを行うスレッドプール
+ * @details スレッドごとにタスクキューを持ち、自身のキューが空になったスレッドは他のスレッドのキューから
+ *          タスクを奪って実行します。タスクは登録したスレッドのRunContextを引き継いで実行されます。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(unsigned thread_count_)
+{
+    if (thread_count_ == 0) thread_count_ = 1;
+    for (unsigned i = 0; i < thread_count_; ++i)
+        _queues.emplace_back(std::make_unique<Queue>());
+    for (unsigned i = 0; i < thread_count_; ++i)
+        _threads.emplace_back(&WorkerPool::run, this, i);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard lock(_wake_mutex);
+        _stopping = true;
+    }
+    _wake.notify_all();
+    for (auto& thread : _threads) thread.join();
+}
+
+void WorkerPool::push(std::function<void()> task_)
+{
+    // 登録されたタスクは各スレッドのキューへ順番に振り分ける。
+    Queue& queue = *_queues[_next_queue++ % _queues.size()];
+    {
+        // 取り出し側が_pendingを減らすより先に加算されるよう、キューへの追加もこのロック内で行う。
+        std::lock_guard wake_lock(_wake_mutex);
+        ++_pending;
+        std::lock_guard lock(queue.mutex);
+        queue.tasks.push_back(std::move(task_));
+    }
+    _wake.notify_one();
+}
+
+bool WorkerPool::tryPop(const unsigned index_, std::function<void()>& task_)
+{
+    // 自身のキューは登録順に取り出す。
+    {
+        Queue& own = *_queues[index_];
+        std::lock_guard lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task_ = std::move(own.tasks.front());
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+    // 他のスレッドのキューからは、そのスレッドが最後に処理する予定のタスクを奪う。
+    for (size_t i = 1; i < _queues.size(); ++i) {
+        Queue& victim = *_queues[(index_ + i) % _queues.size()];
+        std::lock_guard lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task_ = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkerPool::run(const unsigned index_)
+{
+    while (true) {
+        std::function<void()> task;
+        if (tryPop(index_, task)) {
+            {
+                std::lock_guard lock(_wake_mutex);
+                --_pending;
+            }
+            task();
+            continue;
+        }
+        std::unique_lock lock(_wake_mutex);
+        _wake.wait(lock, [this] { return _pending > 0 || _stopping; });
+        if (_stopping && _pending == 0) return;
+    }
+}
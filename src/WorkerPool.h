@@ -0,0 +1,77 @@
+/**
+ * @file WorkerPool.h
+ * @date 26/10/17
+ * @brief ワークスティーリングを行うスレッドプール
+ * @details スレッドごとにタスクキューを持ち、自身のキューが空になったスレッドは他のスレッドのキューから
+ *          タスクを奪って実行します。タスクは登録したスレッドのRunContextを引き継いで実行されます。
+ * @author saku shirakura (saku@sakushira.com)
+ */
+
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "RunContext.h"
+
+
+class WorkerPool {
+public:
+    explicit WorkerPool(unsigned thread_count_);
+    ~WorkerPool();
+
+    /**
+     * @brief タスクを登録し、その結果を受け取るfutureを返します。
+     * @details タスク内で送出された例外はfuture::getで再送出されます。
+     *          タスクの集計・記録は、登録したスレッドのRunContextに対して行われます。
+     */
+    template <typename F>
+    std::future<std::invoke_result_t<F>> submit(F&& task_)
+    {
+        using R = std::invoke_result_t<F>;
+        auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(task_));
+        std::future<R> result = task->get_future();
+        push([task, context = RunContext::current()] {
+            const RunContext::Scope scope(context);
+            (*task)();
+        });
+        return result;
+    }
+
+    [[nodiscard]] unsigned size() const { return static_cast<unsigned>(_threads.size()); }
+
+    WorkerPool() = delete;
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool(WorkerPool&&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    WorkerPool& operator=(WorkerPool&&) = delete;
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void push(std::function<void()> task_);
+    bool tryPop(unsigned index_, std::function<void()>& task_);
+    void run(unsigned index_);
+
+    std::vector<std::unique_ptr<Queue>> _queues;
+    std::vector<std::thread> _threads;
+    std::atomic<unsigned> _next_queue{0};
+    std::mutex _wake_mutex;
+    std::condition_variable _wake;
+    size_t _pending = 0;
+    bool _stopping = false;
+};
+
+
+#endif //WORKERPOOL_H
@@ -2,11 +2,21 @@
 #include <net_ln3/cpp_lib/ArgumentParser.h>
 #include <net_ln3/cpp_lib/multi_platform_util.h>
 #include <net_ln3/cpp_lib/PrintHelper.h>
+#include <algorithm>
+#include <charconv>
 #include <filesystem>
 #include <format>
+#include <memory>
+#include <optional>
+#include <ranges>
+#include <set>
+#include <thread>
 
+#include "BundleCache.h"
 #include "constants.h"
 #include "FileBundler.h"
+#include "JobsFile.h"
+#include "PackedLayout.h"
 #include "resource.h"
 
 using ph = net_ln3::cpp_lib::PrintHelper;
@@ -27,6 +37,8 @@ void printHelp()
         "\t半角スペースについては、アンダーバーに置換されます。\n"
         "\t配列のサイズの定数はSIZE_{FILE_NAME}_{EXTENSION}の形で命名されます。\n"
         "\tここで生成される定数名が競合する場合は、警告とともに無視されます。\n"
+        "\t内容が同一のファイルは1度だけ出力され、2つ目以降(定数名の順)は最初のファイルの定数を参照する\n"
+        "\t\t#defineによる別名となります。\n"
         "\tこのソフトウェアは、C言語標準機能となるembedディレクティブまでの繋ぎです。\n"
         "\n\t--output-dir, -o" << ph::Color("*(必須)", ERROR_COLOR) << ":\n"
         "\t\t出力先ディレクトリを指定します。\n"
@@ -34,15 +46,29 @@ void printHelp()
         "\n\t--input-dir, -i" << ph::Color("*(1つ必須, 併用可能)", "#00a381") << ":\n"
         "\t\t入力ディレクトリを指定します。\n"
         "\t\t指定したディレクトリに存在するファイルが全てバンドルされます。\n"
+        "\t\tサブディレクトリ内のファイルは、recursive引数を指定した場合のみ処理されます。\n"
         "\t\t== 制約 ==\n"
-        "\t\t・サブディレクトリ内のファイルは処理されません。\n"
         "\t\t・output-dirと同じディレクトリは指定できません。\n"
+        "\t\t\trecursive引数を指定する場合、output-dirが内部にあるときはexclude引数で除外してください。\n"
         "\t\t・target-filelist引数により指定されているファイルと\n"
         "\t\t\t同一の名称(拡張子を含む)を持つファイルについては処理されません。\n"
         "\n\t--target-filelist, -t" << ph::Color("*(1つ必須, 併用可能)", "#00a381") << ":\n"
         "\t\tファイルリストを使用します。\n"
         "\t\tこの引数により指定するファイルリストファイルには１行につき１ファイルのパスを記述します。\n"
         "\t\tこの引数は、input-dirの代わりに指定することができ、両方を指定した場合はそれぞれをバンドルします。\n"
+        "\n\t--recursive, -r:\n"
+        "\t\tinput-dirのサブディレクトリも再帰的に走査します。\n"
+        "\t\tサブディレクトリ内のファイルの定数名には、input-dirからのディレクトリ名が前に付きます。\n"
+        "\t\t\t例: a/logo.png -> F_A_LOGO_PNG, b/logo.png -> F_B_LOGO_PNG\n"
+        "\t\tディレクトリへのシンボリックリンクは辿りません。\n"
+        "\t\tサブディレクトリはjobs引数のスレッド数で並列に走査されます。\n"
+        "\n\t--include:\n"
+        "\t\tinput-dirから登録するファイルをglobのカンマ区切りの一覧で指定します。例(*.png,data/**/*.json)\n"
+        "\t\t\t*と?は/以外の文字に、**は/を含む任意の文字列に一致します。[a-z]などの文字クラスも使用できます。\n"
+        "\t\t\t/を含むglobはinput-dirからの相対パスと、含まないglobはファイル名と比較します。\n"
+        "\n\t--exclude:\n"
+        "\t\tinput-dirから除外するファイルとディレクトリをglobのカンマ区切りの一覧で指定します。\n"
+        "\t\t\t一致したディレクトリの内部は走査されません。\n"
         "\n\t--help, -?:\n"
         "\t\tヘルプテキストを表示します。\n"
         "\n\t--version, -v:\n"
@@ -51,11 +77,129 @@ void printHelp()
         "\t\tライセンス情報を表示します。"
         "\n\t--yes, -y:\n"
         "\t\t上書き保存などをスキップしyesを渡します。"
+        "\n\t--jobs, -j:\n"
+        "\t\tエンコードを並列に行うスレッド数を指定します。(既定値: 1)\n"
+        "\t\t0を指定した場合は、CPUのスレッド数を使用します。\n"
+        "\t\t出力される内容はスレッド数によらず同一です。\n"
+        "\n\t--input-engine:\n"
+        "\t\t入力ファイルの状態の取得と、小さな(8KiB以下の)入力ファイルの読み込みの方式を指定します。(既定値: auto)\n"
+        "\t\tauto: io_uringでstatx・open・read・closeをまとめて発行し、エンコードに先行して読み込みます。\n"
+        "\t\t\tio_uringが使用できない環境(Linux以外を含む)ではthreadsとなります。\n"
+        "\t\tthreads: 読み込み用のスレッドで並列に先行して読み込みます。\n"
+        "\t\tsync: 先読みせず、ファイルごとに順に読み込みます。\n"
+        "\t\t多数の小さなファイルを入力とする場合に、ファイルごとのシステムコールの待ち時間を削減します。\n"
+        "\t\t\t出力される内容は方式によらず同一です。\n"
+        "\n\t--incremental:\n"
+        "\t\t前回の出力を再利用し、変更されたファイルのみをエンコードします。\n"
+        "\t\t入力ファイルの情報は出力先ディレクトリの.file-bundler-manifestに記録されます。\n"
+        "\t\tこの引数の有無にかかわらず、出力ファイルは内容が変化した場合のみ更新されます。\n"
+        "\n\t--watch:\n"
+        "\t\t出力した後も常駐し、入力の変更を検出するたびに再出力します。Ctrl+Cで終了します。\n"
+        "\t\t\t登録したファイルの変更と、input-dir内のファイルの作成・削除、target-filelistの変更を監視します。\n"
+        "\t\t\t連続した変更は、変更が途切れてから(200ms)まとめて1回再出力します。\n"
+        "\t\tincremental引数を含み、再出力では変更されたファイルのみをエンコードします。\n"
+        "\t\t上書きの確認は初回の出力でのみ行います。\n"
+        "\t\t== 制約 ==\n"
+        "\t\t・Linux(inotify)でのみ使用できます。\n"
+        "\n\t--jobs-file:\n"
+        "\t\t複数の出力(ジョブ)を記述したファイルを指定し、1つのプロセスで記述の順に出力します。\n"
+        "\t\t\t1行に1つのジョブを、file-bundlerの引数と同じ形式で記述します。例(-i assets/common -o out/ui --format string)\n"
+        "\t\t\t空白を含む引数は\"または'で囲みます。空行と#から始まる行は無視されます。\n"
+        "\t\tスレッドプールと入力ディレクトリの走査結果、入力ファイルの状態・内容ハッシュ・エンコード結果を\n"
+        "\t\t\tジョブの間で共有するため、複数のジョブで共通の入力は1度だけ読み込み・エンコードされます。\n"
+        "\t\tコマンドラインで指定したjobs(共有するスレッド数)、yes、statsはすべてのジョブに適用されます。\n"
+        "\t\t\tstatsを指定した場合は、最後に共有キャッシュの利用状況を表示します。\n"
+        "\t\t== 制約 ==\n"
+        "\t\t・ジョブにはwatch、jobs-fileを指定できません。ジョブのjobsは無視されます。\n"
+        "\t\t・各ジョブの出力先ディレクトリは異なる必要があります。ジョブの出力は、後に記述したジョブの入力とすることができます。\n"
+        "\n\t--shard:\n"
+        "\t\t定義をresource.hではなく、複数のソースファイルに分割して出力します。\n"
+        "\t\tper-fileを指定した場合は、ファイルごとにresource_{FILE_NAME}_{EXTENSION}.cを生成します。\n"
+        "\t\t整数Nを指定した場合は、サイズの合計が均等になるようresource_0.c～resource_{N-1}.cに振り分けます。\n"
+        "\t\t生成したソースファイルの一覧は、resource_sources.cmakeに\n"
+        "\t\t\tFILE_BUNDLER_RESOURCE_SOURCES変数として書き込まれます。\n"
+        "\n\t--backend:\n"
+        "\t\t定義を書き込むソースファイルの形式を指定します。(既定値: c)\n"
+        "\t\tc: 配列初期化子としてresource.cに書き込みます。\n"
+        "\t\tasm: .incbin指示子でファイルを取り込むアセンブリソースresource.Sを生成します。\n"
+        "\t\t\tCコンパイラによる解析が不要になるため、ビルドが大幅に高速になります。\n"
+        "\t\t\tresource.hの宣言は共通のため、利用側のコードを変更する必要はありません。\n"
+        "\t\t\t== 制約 ==\n"
+        "\t\t\t・GNU互換のアセンブラ(gcc/clang)が必要です。CMakeではASM言語を有効にしてください。\n"
+        "\t\t\t・取り込むファイルは絶対パスで参照されます。\n"
+        "\n\t--format:\n"
+        "\t\tbackendがcの場合に、データ部分の形式を指定します。(既定値: decimal)\n"
+        "\t\tdecimal: 符号付き10進数の配列初期化子 例({77, 73, -1})\n"
+        "\t\thex: 符号付き16進数の配列初期化子 例({0x4d, 0x49, -0x01})\n"
+        "\t\tstring: 4000バイトごとに分割した文字列リテラル。コンパイラの解析が最も高速です。\n"
+        "\t\t\t配列の末尾にはNUL文字が1つ付加されますが、SIZE_には含まれません。\n"
+        "\t\t\tMSVCでは連結後の文字列リテラルが65535バイトを超えるファイルはコンパイルできません。\n"
+        "\t\tembed: #embedディレクティブでファイルを取り込みます。\n"
+        "\t\t\tC23またはC++26の#embedに対応したコンパイラ(GCC 15, Clang 19以降)が必要です。\n"
+        "\t\t\t取り込むファイルは絶対パスで参照されます。\n"
+        "\n\t--compress:\n"
+        "\t\tファイルをLZ4形式で圧縮して格納します。\n"
+        "\t\tallを指定した場合はすべてのファイルを、拡張子のカンマ区切りの一覧(例: json,txt)を指定した場合は\n"
+        "\t\t\tその拡張子のファイルを圧縮の対象とします。\n"
+        "\t\t圧縮の対象のファイルにはF_～の代わりに、内容を返すアクセサconst char* R_～(char* buffer)が生成されます。\n"
+        "\t\t\tbufferを指定した場合は、SIZE_～バイト以上のbufferに展開してbufferを返します。\n"
+        "\t\t\tNULLを指定した場合は、初回の呼び出し時にfile_bundler_set_arenaで登録した領域に展開し、\n"
+        "\t\t\t以降は同じ結果を返します。必要な領域のサイズはFILE_BUNDLER_ARENA_SIZEに定義されます。\n"
+        "\t\t\t展開に失敗した場合(領域の不足など)はNULLを返します。\n"
+        "\t\t圧縮後のサイズが元のサイズの7/8以上となるファイルは、圧縮せずに格納されます。\n"
+        "\t\t\tこの場合もR_～から内容を取得できます。\n"
+        "\t\t展開処理とアクセサの定義はresource.cに書き込まれます。(ヘッダのみの出力は解除されます。)\n"
+        "\t\t== 制約 ==\n"
+        "\t\t・backendがasm、formatがembedの場合は指定できません。\n"
+        "\t\t・R_～はスレッドセーフではありません。\n"
+        "\n\t--pack:\n"
+        "\t\tファイルごとの配列の代わりに、すべてのファイルを定数名の順に連結した配列file_bundler_blobを生成します。\n"
+        "\t\t\t各ファイルは指定した境界(1以上4096以下の2のべき乗。例: 16)に揃えて配置され、間は0で埋められます。\n"
+        "\t\tF_～はfile_bundler_blob内を指すマクロ、SIZE_～はサイズのマクロとなるため、\n"
+        "\t\t\tファイル数によらずシンボルは2つのみとなり、リンクが高速になります。\n"
+        "\t\t各ファイルのオフセットとサイズは、定数名の順にfile_bundler_pack_table[i][0], [i][1]から取得できます。\n"
+        "\t\t\t配列の要素数はFILE_BUNDLER_PACK_LENGTH、ファイル数はFILE_BUNDLER_PACK_COUNTに定義されます。\n"
+        "\t\t== 制約 ==\n"
+        "\t\t・shard、compressと併用できません。formatがembedの場合は指定できません。\n"
+        "\t\t・F_～はマクロのため、sizeofで配列のサイズを取得することはできません。SIZE_～を使用してください。\n"
+        "\n\t--index:\n"
+        "\t\tファイル名からリソースを検索する関数resource_find(const char* name, size_t length)を生成します。\n"
+        "\t\t\t生成時に構築した最小完全ハッシュにより、ファイル数によらず定数時間で検索します。\n"
+        "\t\t\tfile_bundler_resource(name, name_length, data, size, load)へのポインタを返し、\n"
+        "\t\t\t見つからない場合はNULLを返します。圧縮の対象のファイルはdataがNULLとなり、loadにR_～が設定されます。\n"
+        "\t\tC++(C++14以降)ではconstexpr関数となるため、リテラルのファイル名による検索をコンパイル時に解決できます。\n"
+        "\n\t--hash:\n"
+        "\t\t各ファイルの内容のCRC32C(Castagnoli多項式)をHASH_～に、すべてのファイルの内容を定数名の順に連結した\n"
+        "\t\t\tデータのCRC32CをFILE_BUNDLER_BUNDLE_HASHに、resource.hのマクロとして定義します。\n"
+        "\t\tCRC32Cはエンコードの際に計算するため(SSE4.2が使用できる場合はcrc32命令を使用します)、\n"
+        "\t\t\t実行時に内容をハッシュし直さずに、整合性の確認やキャッシュのキーに使用できます。\n"
+        "\t\tSIZE_～と同じく、圧縮やテキスト変換の対象のファイルは展開後・変換後の内容の値となります。\n"
+        "\n\t--stats:\n"
+        "\t\t入出力の統計を表示します。\n"
+        "\t\t入力・出力それぞれのシステムコールの回数と、ユーザー空間のバッファへ複製したバイト数を\n"
+        "\t\t\t入力1MBあたりの値とともに表示します。\n"
+        "\t\t処理段階(登録・サイズの取得・ハッシュ・エンコードの待機・書き込み)ごとの時間と、\n"
+        "\t\t\t全体のスループット(MB/s, files/s)、書き込みに時間のかかったファイルも表示します。\n"
+        "\n\t--trace:\n"
+        "\t\t処理区間の記録をChrome trace-event形式のJSONとして指定したファイルに書き込みます。\n"
+        "\t\t\tchrome://tracingやPerfettoで読み込めます。\n"
+        "\t\t\t各区間にはファイル名と入出力のバイト数、スループット(MB/s)が記録されます。\n"
+        "\n\t--transform:\n"
+        "\t\t拡張子ごとに、エンコードの前に行うテキスト変換を指定します。例(glsl=glsl,json=json,js=comments)\n"
+        "\t\tblock-comment: ブロックコメントを取り除きます。行コメント(//)内の/*はコメントの開始としません。CSSにはこちらを用います。\n"
+        "\t\tcomments: ブロックコメントと行コメント(//)を取り除きます。文字列・文字リテラル、テンプレートリテラル(`)内は変更しません。\n"
+        "\t\tjson: 文字列の外側の空白を取り除きます。\n"
+        "\t\tglsl: コメントを取り除き、空白を詰めます。改行はプリプロセッサディレクティブの終端にのみ残します。\n"
+        "\t\t変換後のファイルは出力先ディレクトリの.file-bundler-transformedに書き込まれ、\n"
+        "\t\t\tSIZE_～は変換後のサイズとなります。\n"
         "\n\t--truncate-block-comment\n"
         "\t\tブロックコメントを成果物に含めないようにします。\n"
         "\t\tブロックコメントは、/*から始まり*/までの文字列のことです。例(/*ここがコメント*/)\n"
-        "\t\t制約"
-        "\t\t- コメントの入れ子は処理できません。" << std::endl;
+        "\t\t--transformで変換を指定していない拡張子のファイルが対象となります。\n"
+        "\t\t制約\n"
+        "\t\t- コメントの入れ子は処理できません。\n"
+        "\t\t- 行コメント(//)から行末までは、その中の/*を含めてそのまま残します。\n"
+        "\t\t- バイナリファイルも変換の対象となるため、テキストファイルのみを入力とする場合に指定してください。" << std::endl;
 }
 
 void printVersion()
@@ -70,12 +214,13 @@ void printLicense()
     std::cout << license_body << std::endl;
 }
 
-int main(const int argc_, char* argv_[])
+/**
+ * @brief コマンドラインとジョブファイルの引数を解析するパーサーを作成します。
+ */
+net_ln3::cpp_lib::ArgumentParser createArgumentParser()
 {
-    net_ln3::cpp_lib::multi_platform::CodePageGuard cp;
-    net_ln3::cpp_lib::multi_platform::EnableAnsiEscapeSequence::enable();
     using ap = net_ln3::cpp_lib::ArgumentParser;
-    ap argument_parser{
+    return ap{
         ap::OptionNames({
             {"output-dir", ap::OptionType::STRING},
             {"input-dir", ap::OptionType::STRING},
@@ -84,7 +229,25 @@ int main(const int argc_, char* argv_[])
             {"version", ap::OptionType::BOOLEAN},
             {"show-license", ap::OptionType::BOOLEAN},
             {"yes", ap::OptionType::BOOLEAN},
-            {"truncate-block-comment", ap::OptionType::BOOLEAN}
+            {"truncate-block-comment", ap::OptionType::BOOLEAN},
+            {"jobs", ap::OptionType::STRING},
+            {"incremental", ap::OptionType::BOOLEAN},
+            {"shard", ap::OptionType::STRING},
+            {"backend", ap::OptionType::STRING},
+            {"format", ap::OptionType::STRING},
+            {"compress", ap::OptionType::STRING},
+            {"stats", ap::OptionType::BOOLEAN},
+            {"index", ap::OptionType::BOOLEAN},
+            {"hash", ap::OptionType::BOOLEAN},
+            {"trace", ap::OptionType::STRING},
+            {"recursive", ap::OptionType::BOOLEAN},
+            {"include", ap::OptionType::STRING},
+            {"exclude", ap::OptionType::STRING},
+            {"watch", ap::OptionType::BOOLEAN},
+            {"pack", ap::OptionType::STRING},
+            {"transform", ap::OptionType::STRING},
+            {"jobs-file", ap::OptionType::STRING},
+            {"input-engine", ap::OptionType::STRING}
         }),
         ap::OptionAlias({
             {"?", "help"},
@@ -92,14 +255,373 @@ int main(const int argc_, char* argv_[])
             {"i", "input-dir"},
             {"o", "output-dir"},
             {"t", "target-filelist"},
-            {"y", "yes"}
+            {"y", "yes"},
+            {"j", "jobs"},
+            {"r", "recursive"}
         })
     };
+}
+
+/// 1つの出力の引数を読み取った結果
+struct BundleArguments {
+    std::string input_dir;
+    std::string output_dir;
+    std::string filelist_path;
+    int option;
+    FileBundler::Parameters parameters;
+    /// 出力した後も常駐し、入力の変更を検出するたびに再出力する。
+    bool watch;
+};
+
+/**
+ * @brief 引数の値をスレッド数に変換します。0はCPUのスレッド数とします。
+ * @return 0以上の整数でない場合はfalse
+ */
+bool parseThreadCount(const std::string& value_, unsigned& count_)
+{
+    unsigned value{};
+    if (const auto [ptr, ec] = std::from_chars(value_.data(), value_.data() + value_.size(), value);
+        ec != std::errc() || ptr != value_.data() + value_.size())
+        return false;
+    count_ = value == 0 ? std::max(1u, std::thread::hardware_concurrency()) : value;
+    return true;
+}
+
+/**
+ * @brief 1つの出力の引数を検証して読み取ります。不正な引数がある場合は、エラーを表示します。
+ * @details 出力先ディレクトリが存在しない場合は作成します。
+ * @return 必須の引数がないか、不正な引数がある場合はstd::nullopt
+ */
+std::optional<BundleArguments> readBundleArguments(const net_ln3::cpp_lib::ArgumentParser& argument_parser_)
+{
+    int invalid_args{};
+    int missing_args{};
+    // id: 1
+    if (!(argument_parser_.isExistOption("input-dir") || argument_parser_.isExistOption("target-filelist")))
+        missing_args |= 0b0001;
+    else if (argument_parser_.isExistOption("input-dir") && !fs::is_directory(
+        argument_parser_.getOption("input-dir").getString()))
+        invalid_args |= 0b0001;
+    // id: 2
+    if (!argument_parser_.isExistOption("output-dir"))
+        missing_args |= 0b0010;
+    else if (
+        !fs::create_directories(argument_parser_.getOption("output-dir").getString()) &&
+        !fs::is_directory(argument_parser_.getOption("output-dir").getString())
+    )
+        invalid_args |= 0b0010;
+    // id: 4
+    if (argument_parser_.isExistOption("target-filelist") &&
+        !fs::is_regular_file(argument_parser_.getOption("target-filelist").getString())
+    ) { invalid_args |= 0b100; }
+    // id: 8
+    FileBundler::Parameters parameters;
+    if (argument_parser_.isExistOption("jobs") &&
+        !parseThreadCount(argument_parser_.getOption("jobs").getString(), parameters.jobs))
+        invalid_args |= 0b1000;
+    // id: 16
+    if (argument_parser_.isExistOption("shard")) {
+        const std::string shard = argument_parser_.getOption("shard").getString();
+        unsigned value{};
+        if (shard == "per-file")
+            parameters.shard_per_file = true;
+        else if (const auto [ptr, ec] = std::from_chars(shard.data(), shard.data() + shard.size(), value);
+            ec != std::errc() || ptr != shard.data() + shard.size() || value == 0)
+            invalid_args |= 0b10000;
+        else
+            parameters.shard_count = value;
+    }
+    // id: 32
+    if (argument_parser_.isExistOption("backend")) {
+        const std::string backend = argument_parser_.getOption("backend").getString();
+        if (backend == "c")
+            parameters.backend = FileBundler::Backend::C;
+        else if (backend == "asm")
+            parameters.backend = FileBundler::Backend::ASSEMBLY;
+        else
+            invalid_args |= 0b100000;
+    }
+    // id: 64
+    if (argument_parser_.isExistOption("format")) {
+        const std::string format = argument_parser_.getOption("format").getString();
+        if (format == "decimal")
+            parameters.format = FileBundler::Format::DECIMAL;
+        else if (format == "hex")
+            parameters.format = FileBundler::Format::HEX;
+        else if (format == "string")
+            parameters.format = FileBundler::Format::STRING;
+        else if (format == "embed")
+            parameters.format = FileBundler::Format::EMBED;
+        else
+            invalid_args |= 0b1000000;
+    }
+    // id: 128
+    if (argument_parser_.isExistOption("compress")) {
+        const std::string compress = argument_parser_.getOption("compress").getString();
+        if (compress == "all") { parameters.compress_all = true; }
+        else {
+            for (const auto part : std::views::split(compress, ',')) {
+                std::string extension(part.begin(), part.end());
+                if (extension.starts_with(".")) extension.erase(0, 1);
+                std::ranges::transform(extension, extension.begin(), tolower);
+                if (extension.empty()) invalid_args |= 0b10000000;
+                else parameters.compress_extensions.insert(extension);
+            }
+        }
+        // データ部分を書き込まない形式では圧縮できない。
+        if (parameters.backend == FileBundler::Backend::ASSEMBLY ||
+            parameters.format == FileBundler::Format::EMBED)
+            invalid_args |= 0b10000000;
+    }
+    // id: 256
+    if (argument_parser_.isExistOption("pack")) {
+        const std::string pack = argument_parser_.getOption("pack").getString();
+        unsigned value{};
+        if (const auto [ptr, ec] = std::from_chars(pack.data(), pack.data() + pack.size(), value);
+            ec != std::errc() || ptr != pack.data() + pack.size() || !PackedLayout::isValidAlignment(value))
+            invalid_args |= 0b100000000;
+        else
+            parameters.pack_alignment = value;
+        // 連結した配列は1つのソースファイルに書き込み、F_～は配列内を指すため、分割出力・圧縮・#embedとは併用できない。
+        if (parameters.shard_per_file || parameters.shard_count > 0 || argument_parser_.isExistOption("compress") ||
+            parameters.format == FileBundler::Format::EMBED)
+            invalid_args |= 0b100000000;
+    }
+    // id: 512
+    if (argument_parser_.isExistOption("transform")) {
+        const std::string transform = argument_parser_.getOption("transform").getString();
+        for (const auto part : std::views::split(transform, ',')) {
+            const std::string entry(part.begin(), part.end());
+            const size_t separator = entry.find('=');
+            std::string extension = entry.substr(0, separator);
+            const std::string kind = separator == std::string::npos ? "" : entry.substr(separator + 1);
+            if (extension.starts_with(".")) extension.erase(0, 1);
+            std::ranges::transform(extension, extension.begin(), tolower);
+            if (extension.empty()) invalid_args |= 0b1000000000;
+            else if (kind == "block-comment")
+                parameters.transforms[extension] = FileBundler::TextTransform::BLOCK_COMMENT;
+            else if (kind == "comments")
+                parameters.transforms[extension] = FileBundler::TextTransform::COMMENTS;
+            else if (kind == "json")
+                parameters.transforms[extension] = FileBundler::TextTransform::JSON;
+            else if (kind == "glsl")
+                parameters.transforms[extension] = FileBundler::TextTransform::GLSL;
+            else
+                invalid_args |= 0b1000000000;
+        }
+    }
+    // id: 1024
+    if (argument_parser_.isExistOption("input-engine")) {
+        const std::string input_engine = argument_parser_.getOption("input-engine").getString();
+        if (input_engine == "auto")
+            parameters.input_engine = FileBundler::InputEngine::AUTO;
+        else if (input_engine == "threads")
+            parameters.input_engine = FileBundler::InputEngine::THREADS;
+        else if (input_engine == "sync")
+            parameters.input_engine = FileBundler::InputEngine::SYNC;
+        else
+            invalid_args |= 0b10000000000;
+    }
+    if (argument_parser_.getOption("truncate-block-comment"))
+        parameters.default_transform = FileBundler::TextTransform::BLOCK_COMMENT;
+    if (argument_parser_.isExistOption("trace"))
+        parameters.trace_path = argument_parser_.getOption("trace").getString();
+    // globのカンマ区切りの一覧を分割する。
+    auto split_patterns = [&](const std::string& name_, std::vector<std::string>& patterns_) {
+        if (!argument_parser_.isExistOption(name_)) return;
+        const std::string patterns = argument_parser_.getOption(name_).getString();
+        for (const auto part : std::views::split(patterns, ',')) {
+            if (std::string pattern(part.begin(), part.end()); !pattern.empty())
+                patterns_.push_back(std::move(pattern));
+        }
+    };
+    split_patterns("include", parameters.include_patterns);
+    split_patterns("exclude", parameters.exclude_patterns);
+    // 同一ディレクトリ制約のエラーを表示する。
+    if (missing_args == 0 && argument_parser_.getOption("input-dir").getString() == argument_parser_.
+        getOption("output-dir").getString()) {
+        std::cout << ph::Color("エラー", ERROR_COLOR) << ": 入力ディレクトリと出力先ディレクトリは異なるディレクトリを指定してください。" << std::endl;
+    }
+    // 引数エラーを表示する。
+    if (missing_args > 0) {
+        std::cout << ph::Color("エラー", ERROR_COLOR);
+        std::cout << ": 必須の引数が指定されていません。\n不足している引数:\n";
+        if (missing_args & 0b0001)
+            std::cout << "・input-dir または target-filelist\n";
+        if (missing_args & 0b0010)
+            std::cout << "・output-dir\n";
+        std::cout << "\n詳細な用法はヘルプを参照してください。 file-bundler --help" << std::endl;
+        return std::nullopt;
+    }
+    if (invalid_args > 0) {
+        std::cout << ph::Color("エラー", ERROR_COLOR);
+        std::cout << ": 引数に指定された値が不正です。\n"
+            "指定されたパスは有効なパスではありません。\n無効な引数:\n";
+        if (invalid_args & 0b0001)
+            std::cout << "・input-dir\n";
+        if (invalid_args & 0b0010)
+            std::cout << "・output-dir (ディレクトリを作成できませんでした。)\n";
+        if (invalid_args & 0b0100)
+            std::cout << "・target-filelist\n";
+        if (invalid_args & 0b1000)
+            std::cout << "・jobs (0以上の整数を指定してください。)\n";
+        if (invalid_args & 0b10000)
+            std::cout << "・shard (1以上の整数またはper-fileを指定してください。)\n";
+        if (invalid_args & 0b100000)
+            std::cout << "・backend (cまたはasmを指定してください。)\n";
+        if (invalid_args & 0b1000000)
+            std::cout << "・format (decimal, hex, string, embedのいずれかを指定してください。)\n";
+        if (invalid_args & 0b10000000)
+            std::cout << "・compress (allまたは拡張子のカンマ区切りの一覧を指定してください。"
+                "backendがasm、formatがembedの場合は指定できません。)\n";
+        if (invalid_args & 0b100000000)
+            std::cout << "・pack (1以上4096以下の2のべき乗を指定してください。"
+                "shard、compressと併用できず、formatがembedの場合は指定できません。)\n";
+        if (invalid_args & 0b1000000000)
+            std::cout << "・transform (拡張子=変換のカンマ区切りの一覧を指定してください。"
+                "変換はblock-comment, comments, json, glslのいずれかです。)\n";
+        if (invalid_args & 0b10000000000)
+            std::cout << "・input-engine (auto, threads, syncのいずれかを指定してください。)\n";
+        std::cout << "\n詳細な用法はヘルプを参照してください。 file-bundler --help" << std::endl;
+        return std::nullopt;
+    }
+    int option = 1;
+    option |= argument_parser_.getOption("yes")?FileBundler::Options::ALL_YES : 0;
+    option |= argument_parser_.getOption("incremental") ? FileBundler::Options::INCREMENTAL : 0;
+    option |= argument_parser_.getOption("stats") ? FileBundler::Options::STATS : 0;
+    option |= argument_parser_.getOption("index") ? FileBundler::Options::INDEX : 0;
+    option |= argument_parser_.getOption("hash") ? FileBundler::Options::HASH : 0;
+    option |= argument_parser_.getOption("recursive") ? FileBundler::Options::RECURSIVE : 0;
+    // 常駐する場合は、変更されたファイルのみを再エンコードする。
+    const bool watch = static_cast<bool>(argument_parser_.getOption("watch"));
+    option |= watch ? FileBundler::Options::INCREMENTAL : 0;
+    // 分割出力・アセンブリソース・圧縮を指定した場合のヘッダのみの出力の解除は、FileBundlerが行う。
+
+    return BundleArguments{
+        argument_parser_.getOption("input-dir").getString(),
+        argument_parser_.getOption("output-dir").getString(),
+        argument_parser_.getOption("target-filelist").getString(),
+        option,
+        parameters,
+        watch
+    };
+}
+
+/**
+ * @brief --jobs-fileに記述された出力を、キャッシュを共有して記述の順に行います。
+ * @details コマンドラインで指定したjobs(共有するスレッド数)・yes・statsはすべてのジョブに適用します。
+ *          不正なジョブがある場合は、いずれのジョブも実行しません。
+ *          失敗したジョブがあっても残りのジョブは実行し、最初に失敗したジョブの終了コードを返します。
+ */
+int runJobs(const net_ln3::cpp_lib::ArgumentParser& argument_parser_)
+{
+    const std::string jobs_path = argument_parser_.getOption("jobs-file").getString();
+    std::vector<JobsFile::Job> jobs;
+    size_t error_line{};
+    if (!JobsFile::load(jobs_path, jobs, error_line)) {
+        std::cout << ph::Color("エラー", ERROR_COLOR) << ": "
+            << (error_line == 0
+                    ? std::format("ジョブファイル\"{}\"を読み込めませんでした。", jobs_path)
+                    : std::format("ジョブファイルの{}行目の引用符が閉じられていません。", error_line)) << std::endl;
+        return 1;
+    }
+    if (jobs.empty()) {
+        std::cout << ph::Color("エラー", ERROR_COLOR) << ": ジョブファイルに出力が記述されていません。" << std::endl;
+        return 1;
+    }
+    unsigned thread_count = 1;
+    if (argument_parser_.isExistOption("jobs") &&
+        !parseThreadCount(argument_parser_.getOption("jobs").getString(), thread_count)) {
+        std::cout << ph::Color("エラー", ERROR_COLOR) << ": jobsには0以上の整数を指定してください。" << std::endl;
+        return 1;
+    }
+
+    // 各ジョブの引数を読み取る。
+    std::vector<BundleArguments> job_arguments;
+    std::set<fs::path> output_dirs;
+    bool valid = true;
+    for (const auto& job : jobs) {
+        std::vector<std::string> tokens{app_name};
+        tokens.insert(tokens.end(), job.arguments.begin(), job.arguments.end());
+        std::vector<char*> argv;
+        for (auto& token : tokens) argv.push_back(token.data());
+        auto parser = createArgumentParser();
+        parser.parse(static_cast<int>(argv.size()), argv.data());
+        std::optional<BundleArguments> arguments;
+        if (parser.getOption("watch") || parser.isExistOption("jobs-file") || parser.getOption("help") ||
+            parser.getOption("version") || parser.getOption("show-license")) {
+            std::cout << ph::Color("エラー", ERROR_COLOR)
+                << ": ジョブにはwatch, jobs-file, help, version, show-licenseを指定できません。" << std::endl;
+        }
+        // 末尾の区切り文字の有無によらず比較できるよう、区切り文字を付けて正規化する。
+        else if ((arguments = readBundleArguments(parser)) &&
+            !output_dirs.insert((fs::absolute(arguments->output_dir) / "").lexically_normal()).second) {
+            std::cout << ph::Color("エラー", ERROR_COLOR) << ": 出力先ディレクトリが他のジョブと同じです。" << std::endl;
+            arguments.reset();
+        }
+        if (!arguments) {
+            std::cout << std::format("(ジョブファイルの{}行目)", job.line) << std::endl;
+            valid = false;
+            continue;
+        }
+        job_arguments.push_back(std::move(*arguments));
+    }
+    if (!valid) return 1;
+
+    const bool stats = static_cast<bool>(argument_parser_.getOption("stats"));
+    BundleCache cache(thread_count);
+    std::vector<std::unique_ptr<FileBundler>> bundlers;
+    for (auto& [input_dir, output_dir, filelist_path, option, parameters, watch] : job_arguments) {
+        parameters.cache = &cache;
+        option |= argument_parser_.getOption("yes") ? FileBundler::Options::ALL_YES : 0;
+        option |= stats ? FileBundler::Options::STATS : 0;
+        bundlers.push_back(std::make_unique<FileBundler>(input_dir, output_dir, filelist_path, option, parameters));
+    }
+    // 複数のジョブから参照される入力のみ処理結果を保持するよう、各ジョブの入力を登録する。
+    std::vector<std::vector<fs::path>> job_inputs;
+    job_inputs.reserve(bundlers.size());
+    for (const auto& bundler : bundlers) {
+        job_inputs.push_back(bundler->inputPaths());
+        for (const auto& path : job_inputs.back()) cache.retain(path);
+    }
+
+    int result = 0;
+    size_t failed = 0;
+    for (size_t i = 0; i < bundlers.size(); ++i) {
+        std::cout << std::format("[{}/{}] {}", i + 1, bundlers.size(), job_arguments[i].output_dir) << std::endl;
+        const int code = bundlers[i]->bundle();
+        for (const auto& path : job_inputs[i]) cache.release(path);
+        // 後のジョブが出力を入力とする場合に備え、出力先ディレクトリの走査結果とファイルの記録を破棄する。
+        cache.invalidate(job_arguments[i].output_dir);
+        if (code == 0) continue;
+        ++failed;
+        if (result == 0) result = code;
+    }
+    if (stats) {
+        const BundleCache::Stats cache_stats = cache.stats();
+        std::cout << std::format("共有キャッシュ: 走査 {}回 (再利用 {}回), ファイルの状態の再利用 {}件, "
+                                 "内容ハッシュの再利用 {}件, セグメントの保持 {}個 (再利用 {}回)",
+                                 cache_stats.scans, cache_stats.scan_hits, cache_stats.status_hits,
+                                 cache_stats.hash_hits, cache_stats.segments, cache_stats.segment_hits) << std::endl;
+    }
+    if (failed > 0) {
+        std::cout << ph::Color("エラー", ERROR_COLOR)
+            << std::format(": {}個のジョブのうち{}個が失敗しました。", bundlers.size(), failed) << std::endl;
+    }
+    return result;
+}
+
+int main(const int argc_, char* argv_[])
+{
+    net_ln3::cpp_lib::multi_platform::CodePageGuard cp;
+    net_ln3::cpp_lib::multi_platform::EnableAnsiEscapeSequence::enable();
+    auto argument_parser = createArgumentParser();
     argument_parser.parse(argc_, argv_);
     if (argument_parser.getOption("help"))
         printHelp(); // NOLINT(*-branch-clone)
     else if (argument_parser.getOption("version")) { printVersion(); }
     else if (argument_parser.getOption("show-license")) { printLicense(); }
+    else if (argument_parser.isExistOption("jobs-file")) { return runJobs(argument_parser); }
     // 処理に必要なファイル・ディレクトリのパスを指定する引数が存在しないなら、ヘルプを表示する。
     else if (!(
             argument_parser.isExistOption("input-dir") ||
@@ -107,65 +629,16 @@ int main(const int argc_, char* argv_[])
             argument_parser.isExistOption("output-dir"))
     ) { printHelp(); }
     else {
-        int invalid_args{};
-        int missing_args{};
-        // id: 1
-        if (!(argument_parser.isExistOption("input-dir") || argument_parser.isExistOption("target-filelist")))
-            missing_args |= 0b0001;
-        else if (argument_parser.isExistOption("input-dir") && !fs::is_directory(
-            argument_parser.getOption("input-dir").getString()))
-            invalid_args |= 0b0001;
-        // id: 2
-        if (!argument_parser.isExistOption("output-dir"))
-            missing_args |= 0b0010;
-        else if (
-            !fs::create_directories(argument_parser.getOption("output-dir").getString()) &&
-            !fs::is_directory(argument_parser.getOption("output-dir").getString())
-        )
-            invalid_args |= 0b0010;
-        // id: 4
-        if (argument_parser.isExistOption("target-filelist") &&
-            !fs::is_regular_file(argument_parser.getOption("target-filelist").getString())
-        ) { invalid_args |= 0b100; }
-        // 同一ディレクトリ制約のエラーを表示する。
-        if (missing_args == 0 && argument_parser.getOption("input-dir").getString() == argument_parser.
-            getOption("output-dir").getString()) {
-            std::cout << ph::Color("エラー", ERROR_COLOR) << ": 入力ディレクトリと出力先ディレクトリは異なるディレクトリを指定してください。" << std::endl;
-        }
-        // 引数エラーを表示する。
-        if (missing_args > 0) {
-            std::cout << ph::Color("エラー", ERROR_COLOR);
-            std::cout << ": 必須の引数が指定されていません。\n不足している引数:\n";
-            if (missing_args & 0b0001)
-                std::cout << "・input-dir または target-filelist\n";
-            if (missing_args & 0b0010)
-                std::cout << "・output-dir\n";
-            std::cout << "\n詳細な用法はヘルプを参照してください。 file-bundler --help" << std::endl;
-            return 1;
-        }
-        if (invalid_args > 0) {
-            std::cout << ph::Color("エラー", ERROR_COLOR);
-            std::cout << ": 引数に指定された値が不正です。\n"
-                "指定されたパスは有効なパスではありません。\n無効な引数:\n";
-            if (invalid_args & 0b0001)
-                std::cout << "・input-dir\n";
-            if (invalid_args & 0b0010)
-                std::cout << "・output-dir (ディレクトリを作成できませんでした。)\n";
-            if (invalid_args & 0b0100)
-                std::cout << "・target-filelist\n";
-            std::cout << "\n詳細な用法はヘルプを参照してください。 file-bundler --help" << std::endl;
-            return 1;
-        }
-        int option = 1;
-        option |= argument_parser.getOption("yes")?FileBundler::Options::ALL_YES : 0;
-
+        const std::optional<BundleArguments> arguments = readBundleArguments(argument_parser);
+        if (!arguments) return 1;
         const FileBundler bundler{
-            argument_parser.getOption("input-dir").getString(),
-            argument_parser.getOption("output-dir").getString(),
-            argument_parser.getOption("target-filelist").getString(),
-            option
+            arguments->input_dir,
+            arguments->output_dir,
+            arguments->filelist_path,
+            arguments->option,
+            arguments->parameters
         };
-        return bundler.bundle();
+        return arguments->watch ? bundler.watch() : bundler.bundle();
     }
     return 0;
 }